@@ -0,0 +1,443 @@
+// Микробенчмарки горячих путей клиента.
+//
+// Запуск с машиночитаемым результатом:
+//   ./obsidian_bench --benchmark_format=json --benchmark_out=bench.json
+// Сравнение двух сборок:
+//   compare.py benchmarks before.json after.json   (из Google Benchmark)
+
+#include <benchmark/benchmark.h>
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+
+#include "ApiClient.h"
+#include "Blake2s.h"
+#include "ChaCha20Poly1305.h"
+#include "ConfigManager.h"
+#include "JsonArrayStream.h"
+#include "LatencyHistogram.h"
+#include "PeerListModel.h"
+#include "PeerTable.h"
+#include "WireGuardHandshake.h"
+#include "WireGuardKeys.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+
+// Счётчик выделений кучи для allocs_per_peer. Подменяется malloc, а не
+// operator new: QString, QByteArray, QList и QJsonDocument берут память
+// через malloc. Только glibc; на других платформах счётчик не выводится
+#if defined(__GLIBC__)
+#define OBSIDIAN_BENCH_COUNT_ALLOCATIONS
+
+namespace {
+std::atomic<uint64_t> heapAllocationCount{0};
+} // anonymous namespace
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+
+void* malloc(size_t size) noexcept {
+    heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+    heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) noexcept {
+    heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+} // extern "C"
+#endif
+
+using namespace obsidian;
+
+namespace {
+
+using Key = std::array<uint8_t, KEY_SIZE>;
+
+// allocs_per_peer: выделения кучи за весь цикл на один пир
+void reportAllocations([[maybe_unused]] benchmark::State& state, [[maybe_unused]] uint64_t before) {
+#ifdef OBSIDIAN_BENCH_COUNT_ALLOCATIONS
+    const uint64_t allocations = heapAllocationCount.load(std::memory_order_relaxed) - before;
+    state.counters["allocs_per_peer"] = static_cast<double>(allocations)
+        / static_cast<double>(state.iterations() * state.range(0));
+#endif
+}
+
+uint64_t heapAllocations() {
+#ifdef OBSIDIAN_BENCH_COUNT_ALLOCATIONS
+    return heapAllocationCount.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+KeyPair fixedKeyPair() {
+    static const KeyPair keyPair = *WireGuardKeys::generateKeyPair();
+    return keyPair;
+}
+
+// ---------------------------------------------------------------------------
+// WireGuardKeys
+
+void BM_GenerateKeyPair(benchmark::State& state) {
+    for (auto _ : state) {
+        auto keyPair = WireGuardKeys::generateKeyPair();
+        benchmark::DoNotOptimize(keyPair);
+    }
+}
+BENCHMARK(BM_GenerateKeyPair);
+
+void BM_GenerateKeyPairsBatch(benchmark::State& state) {
+    std::vector<KeyPair> pairs(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(WireGuardKeys::generateKeyPairs(pairs));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GenerateKeyPairsBatch)->Arg(64)->Arg(1024)->UseRealTime();
+
+void BM_DerivePublicKey(benchmark::State& state) {
+    Key privateKey = fixedKeyPair().privateKey;
+    for (auto _ : state) {
+        auto publicKey = WireGuardKeys::derivePublicKey(privateKey);
+        benchmark::DoNotOptimize(publicKey);
+        // Следующая итерация зависит от предыдущей
+        privateKey[0] ^= publicKey[0];
+    }
+}
+BENCHMARK(BM_DerivePublicKey);
+
+// Тот же публичный ключ лестницей Монтгомери от u = 9, для сравнения с
+// таблицей fixed-base
+void BM_DerivePublicKeyLadder(benchmark::State& state) {
+    const Key basePoint{9};
+    Key privateKey = fixedKeyPair().privateKey;
+    for (auto _ : state) {
+        auto publicKey = WireGuardKeys::sharedSecret(privateKey, basePoint);
+        benchmark::DoNotOptimize(publicKey);
+        privateKey[0] ^= (*publicKey)[0];
+    }
+}
+BENCHMARK(BM_DerivePublicKeyLadder);
+
+void BM_SharedSecret(benchmark::State& state) {
+    const KeyPair a = fixedKeyPair();
+    const Key peer = WireGuardKeys::derivePublicKey(Key{1});
+    for (auto _ : state) {
+        auto secret = WireGuardKeys::sharedSecret(a.privateKey, peer);
+        benchmark::DoNotOptimize(secret);
+    }
+}
+BENCHMARK(BM_SharedSecret);
+
+void BM_SharedSecretsBatch(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    const KeyPair a = fixedKeyPair();
+    auto peers = WireGuardKeys::generateKeyPairs(count);
+    std::vector<Key> publicKeys(count);
+    for (size_t i = 0; i < count; ++i) {
+        publicKeys[i] = peers[i].publicKey;
+    }
+    std::vector<Key> out(count);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(WireGuardKeys::sharedSecrets(a.privateKey, publicKeys, out));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SharedSecretsBatch)->RangeMultiplier(4)->Range(1, 4096)->UseRealTime();
+
+void BM_ToBase64(benchmark::State& state) {
+    const Key key = fixedKeyPair().publicKey;
+    for (auto _ : state) {
+        std::string encoded = WireGuardKeys::toBase64(key);
+        benchmark::DoNotOptimize(encoded);
+    }
+}
+BENCHMARK(BM_ToBase64);
+
+void BM_ToBase64NoAlloc(benchmark::State& state) {
+    const Key key = fixedKeyPair().publicKey;
+    char out[KEY_BASE64_SIZE];
+    for (auto _ : state) {
+        WireGuardKeys::toBase64(key, out);
+        benchmark::DoNotOptimize(out);
+    }
+}
+BENCHMARK(BM_ToBase64NoAlloc);
+
+void BM_FromBase64(benchmark::State& state) {
+    const std::string encoded = WireGuardKeys::toBase64(fixedKeyPair().publicKey);
+    for (auto _ : state) {
+        auto key = WireGuardKeys::fromBase64(encoded);
+        benchmark::DoNotOptimize(key);
+    }
+}
+BENCHMARK(BM_FromBase64);
+
+void BM_FromBase64NoAlloc(benchmark::State& state) {
+    const std::string encoded = WireGuardKeys::toBase64(fixedKeyPair().publicKey);
+    Key key;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(WireGuardKeys::fromBase64(std::string_view(encoded), key));
+    }
+}
+BENCHMARK(BM_FromBase64NoAlloc);
+
+// ---------------------------------------------------------------------------
+// Симметричная криптография и рукопожатие
+
+void BM_ChaCha20Poly1305Seal(benchmark::State& state) {
+    const Key key = fixedKeyPair().privateKey;
+    std::vector<uint8_t> buffer(static_cast<size_t>(state.range(0)) + ChaCha20Poly1305::TAG_SIZE);
+    uint64_t counter = 0;
+    for (auto _ : state) {
+        ChaCha20Poly1305::seal(buffer, {}, ChaCha20Poly1305::counterNonce(counter++), key);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+    state.SetLabel(ChaCha20Poly1305::chachaKernelName());
+}
+BENCHMARK(BM_ChaCha20Poly1305Seal)->Arg(64)->Arg(1420)->Arg(65536);
+
+void BM_ChaCha20Poly1305Open(benchmark::State& state) {
+    const Key key = fixedKeyPair().privateKey;
+    const auto nonce = ChaCha20Poly1305::counterNonce(0);
+    std::vector<uint8_t> sealed(static_cast<size_t>(state.range(0)) + ChaCha20Poly1305::TAG_SIZE);
+    ChaCha20Poly1305::seal(sealed, {}, nonce, key);
+    std::vector<uint8_t> buffer(sealed.size());
+
+    for (auto _ : state) {
+        std::copy(sealed.begin(), sealed.end(), buffer.begin());
+        benchmark::DoNotOptimize(ChaCha20Poly1305::open(buffer, {}, nonce, key));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ChaCha20Poly1305Open)->Arg(64)->Arg(1420)->Arg(65536);
+
+void BM_Blake2s(benchmark::State& state) {
+    std::vector<uint8_t> data(static_cast<size_t>(state.range(0)), 0x5a);
+    for (auto _ : state) {
+        auto hash = Blake2s::hash(data);
+        benchmark::DoNotOptimize(hash);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Blake2s)->Arg(64)->Arg(1420)->Arg(65536);
+
+void BM_HandshakeInitiation(benchmark::State& state) {
+    const KeyPair server = *WireGuardKeys::generateKeyPair();
+    WireGuardHandshake handshake(fixedKeyPair().privateKey, server.publicKey);
+    std::array<uint8_t, WireGuardHandshake::INITIATION_SIZE> message;
+    uint32_t index = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(handshake.createInitiation(index++, message));
+    }
+}
+BENCHMARK(BM_HandshakeInitiation);
+
+// ---------------------------------------------------------------------------
+// ApiClient: разбор списка пиров
+
+QByteArray peerListJson(int count) {
+    QJsonArray array;
+    for (int i = 0; i < count; ++i) {
+        QJsonObject peer;
+        peer["id"] = QString("6f1c2a4e-0000-4000-8000-%1").arg(i, 12, 10, QChar('0'));
+        peer["device_name"] = QString("device-%1").arg(i);
+        peer["protocol"] = "wireguard";
+        peer["wg_ip_address"] = QString("10.8.%1.%2/32").arg((i >> 8) & 0xff).arg(i & 0xff);
+        peer["wg_public_key"] = QString::fromStdString(WireGuardKeys::toBase64(fixedKeyPair().publicKey));
+        peer["is_active"] = (i % 3) != 0;
+        array.append(peer);
+    }
+    return QJsonDocument(array).toJson(QJsonDocument::Compact);
+}
+
+void BM_ParsePeerList(benchmark::State& state) {
+    const QByteArray json = peerListJson(static_cast<int>(state.range(0)));
+    const uint64_t allocations = heapAllocations();
+    for (auto _ : state) {
+        const QJsonDocument doc = QJsonDocument::fromJson(json);
+        QList<PeerInfo> peers = ApiClient::parsePeers(doc.array());
+        benchmark::DoNotOptimize(peers);
+    }
+    reportAllocations(state, allocations);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_ParsePeerList)->Arg(10)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+// Потоковый разбор, как в loadPeersPaged: чанки по 16 КБ, пир за пиром
+void BM_StreamPeerList(benchmark::State& state) {
+    const QByteArray json = peerListJson(static_cast<int>(state.range(0)));
+    constexpr qsizetype CHUNK = 16 * 1024;
+    const uint64_t allocations = heapAllocations();
+    for (auto _ : state) {
+        JsonArrayStream stream;
+        QList<PeerInfo> peers;
+        for (qsizetype offset = 0; offset < json.size(); offset += CHUNK) {
+            const qsizetype size = qMin(CHUNK, json.size() - offset);
+            stream.feed(std::string_view(json.constData() + offset, static_cast<size_t>(size)),
+                        [&peers](std::string_view element) {
+                const QByteArray object = QByteArray::fromRawData(element.data(),
+                                                                  static_cast<qsizetype>(element.size()));
+                peers.append(ApiClient::parsePeer(QJsonDocument::fromJson(object).object()));
+            });
+        }
+        benchmark::DoNotOptimize(peers);
+    }
+    reportAllocations(state, allocations);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_StreamPeerList)->Arg(10)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+// Только нарезка JsonArrayStream из BM_StreamPeerList, без разбора
+// элементов: сколько времени и выделений приходится на сам поток
+void BM_FramePeerList(benchmark::State& state) {
+    const QByteArray json = peerListJson(static_cast<int>(state.range(0)));
+    constexpr qsizetype CHUNK = 16 * 1024;
+    const uint64_t allocations = heapAllocations();
+    for (auto _ : state) {
+        JsonArrayStream stream;
+        size_t elements = 0;
+        for (qsizetype offset = 0; offset < json.size(); offset += CHUNK) {
+            const qsizetype size = qMin(CHUNK, json.size() - offset);
+            stream.feed(std::string_view(json.constData() + offset, static_cast<size_t>(size)),
+                        [&elements](std::string_view element) { elements += element.size(); });
+        }
+        benchmark::DoNotOptimize(elements);
+    }
+    reportAllocations(state, allocations);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_FramePeerList)->Arg(10)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+// Обновление модели списка, в котором изменился один пир: счётчик rows —
+// сколько строк затронули сигналы модели (ожидается 1)
+void BM_PeerListModelRefresh(benchmark::State& state) {
+    const QList<PeerInfo> peers = ApiClient::parsePeers(
+        QJsonDocument::fromJson(peerListJson(static_cast<int>(state.range(0)))).array());
+    QList<PeerInfo> changed = peers;
+    changed[changed.size() / 2].isActive = !changed[changed.size() / 2].isActive;
+
+    PeerListModel model;
+    model.setPeers(peers);
+    int rows = 0;
+    QObject::connect(&model, &QAbstractItemModel::dataChanged,
+                     [&rows](const QModelIndex& from, const QModelIndex& to) { rows += to.row() - from.row() + 1; });
+    QObject::connect(&model, &QAbstractItemModel::rowsInserted,
+                     [&rows](const QModelIndex&, int first, int last) { rows += last - first + 1; });
+    QObject::connect(&model, &QAbstractItemModel::rowsRemoved,
+                     [&rows](const QModelIndex&, int first, int last) { rows += last - first + 1; });
+
+    bool flip = false;
+    for (auto _ : state) {
+        model.setPeers((flip = !flip) ? changed : peers);
+    }
+    state.counters["rows"] = benchmark::Counter(rows, benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PeerListModelRefresh)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+// Упаковка списка в PeerTable; bytes_per_peer — память таблицы на пира
+// (QList<PeerInfo> с пятью QString держит порядка 500 байт)
+void BM_PeerTableBuild(benchmark::State& state) {
+    const QList<PeerInfo> peers = ApiClient::parsePeers(
+        QJsonDocument::fromJson(peerListJson(static_cast<int>(state.range(0)))).array());
+    size_t bytes = 0;
+    for (auto _ : state) {
+        PeerTable table(peers);
+        bytes = table.memoryUsage();
+        benchmark::DoNotOptimize(table);
+    }
+    state.counters["bytes_per_peer"] = static_cast<double>(bytes) / static_cast<double>(peers.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PeerTableBuild)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+// ---------------------------------------------------------------------------
+// Метрики запросов: запись в гистограмму на каждую фазу каждого запроса
+
+void BM_LatencyHistogramRecord(benchmark::State& state) {
+    static LatencyHistogram histogram;
+    uint64_t micros = 1;
+    for (auto _ : state) {
+        histogram.record(micros);
+        micros = (micros * 1103515245 + 12345) % 10000000;     // 0..10 с
+    }
+}
+BENCHMARK(BM_LatencyHistogramRecord)->Threads(1)->Threads(4);
+
+// ---------------------------------------------------------------------------
+// ConfigManager: запись и чтение конфигурации WireGuard
+
+const QString SAMPLE_CONFIG = QStringLiteral(
+    "[Interface]\n"
+    "PrivateKey = <ВСТАВЬТЕ_ВАШ_ПРИВАТНЫЙ_КЛЮЧ>\n"
+    "Address = 10.8.0.2/32\n"
+    "DNS = 1.1.1.1\n"
+    "\n"
+    "[Peer]\n"
+    "PublicKey = xTIBA5rboUvnH4htodjb6e697QjLERt1NAB4mZqp8Dg=\n"
+    "PresharedKey = 0nBRkSsp4p4LZSKFHDfgZaJIbn5XvP5xmeWmPvvKtPE=\n"
+    "Endpoint = vpn.example.com:51820\n"
+    "AllowedIPs = 0.0.0.0/0, ::/0\n"
+    "PersistentKeepalive = 25\n");
+
+void BM_SaveWireGuardConfig(benchmark::State& state) {
+    ConfigManager configManager;
+    const QString privateKey = QString::fromStdString(fixedKeyPair().privateKeyBase64());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(configManager.saveWireGuardConfig("bench", SAMPLE_CONFIG, privateKey));
+    }
+}
+BENCHMARK(BM_SaveWireGuardConfig)->Unit(benchmark::kMicrosecond);
+
+void BM_LoadWireGuardConfig(benchmark::State& state) {
+    ConfigManager configManager;
+    configManager.saveWireGuardConfig("bench", SAMPLE_CONFIG,
+                                      QString::fromStdString(fixedKeyPair().privateKeyBase64()));
+    for (auto _ : state) {
+        QString config = configManager.loadWireGuardConfig("bench");
+        benchmark::DoNotOptimize(config);
+    }
+}
+BENCHMARK(BM_LoadWireGuardConfig)->Unit(benchmark::kMicrosecond);
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+    app.setOrganizationName("ObsidianVPN");
+    app.setApplicationName("ObsidianClientBench");
+
+    // Конфиги и QSettings пишутся в тестовые каталоги, а не в настройки пользователя
+    QStandardPaths::setTestModeEnabled(true);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    ConfigManager().deleteWireGuardConfig("bench");
+    return 0;
+}
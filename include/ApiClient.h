@@ -5,11 +5,25 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QJsonObject>
+#include <QJsonArray>
+#include <QCache>
+#include <QTimer>
+#include <QVariantMap>
+#include <QElapsedTimer>
+#include "Resilience.h"
+#include "RequestMetrics.h"
+#include "RequestScheduler.h"
 #include <memory>
 #include <functional>
+#include <any>
+#include <map>
+#include <optional>
 
 namespace obsidian {
 
+class TlsSessionCache;
+class PeerStore;
+
 struct AuthTokens {
     Q_GADGET
     Q_PROPERTY(QString accessToken MEMBER accessToken)
@@ -36,6 +50,8 @@ public:
     QString ipAddress;
     QString publicKey;
     bool isActive = false;
+
+    bool operator==(const PeerInfo&) const = default;
 };
 
 struct ServerConfig {
@@ -47,46 +63,205 @@ struct ServerConfig {
     QString allowedIPs;
 };
 
+enum class HttpMethod {
+    Get,
+    Post,
+    Put,
+    Delete
+};
+
+enum class CachePolicy {
+    NoCache,
+    Conditional     // revalidated with If-None-Match / If-Modified-Since
+};
+
+enum class Auth {
+    Required,       // Bearer token; parked and replayed around a token refresh
+    None
+};
+
+// Endpoint description: HTTP method, path and the decoder of its response.
+// "%1" in the path is replaced with the request argument (e.g. peer id).
+// The priority decides the request's place in the RequestScheduler.
+// Decoders live in ApiClient.cpp and provide
+//   using Result = ...;
+//   static bool decode(const QByteArray& body, Result& out);
+template <typename Decoder>
+struct ApiEndpoint {
+    HttpMethod method;
+    const char* path;
+    CachePolicy cachePolicy = CachePolicy::NoCache;
+    Auth auth = Auth::Required;
+    ResiliencePolicy resilience{};
+    RequestPriority priority = RequestPriority::Normal;
+};
+
 class ApiClient : public QObject {
     Q_OBJECT
 
     Q_PROPERTY(QString serverUrl READ serverUrl WRITE setServerUrl NOTIFY serverUrlChanged)
     Q_PROPERTY(bool isAuthenticated READ isAuthenticated NOTIFY authenticationChanged)
     Q_PROPERTY(bool loading READ isLoading NOTIFY loadingChanged)
+    Q_PROPERTY(bool http2Enabled READ http2Enabled WRITE setHttp2Enabled RESET resetHttp2 NOTIFY http2EnabledChanged)
+    Q_PROPERTY(double firstByteTimeMs READ firstByteTimeMs NOTIFY firstByteTimeMeasured)
+    Q_PROPERTY(int cacheHits READ cacheHits NOTIFY responseCacheChanged)
+    Q_PROPERTY(int cacheMisses READ cacheMisses NOTIFY responseCacheChanged)
+    Q_PROPERTY(qint64 cacheSize READ cacheSize NOTIFY responseCacheChanged)
+    Q_PROPERTY(int coalescedRequests READ coalescedRequests NOTIFY coalescedRequestsChanged)
+    Q_PROPERTY(bool serverAvailable READ serverAvailable NOTIFY serverAvailableChanged)
+    Q_PROPERTY(int pendingRequests READ pendingRequests NOTIFY pendingRequestsChanged)
+    Q_PROPERTY(QVariantMap pendingByEndpoint READ pendingByEndpoint NOTIFY pendingRequestsChanged)
+    Q_PROPERTY(int bulkConcurrency READ bulkConcurrency WRITE setBulkConcurrency NOTIFY bulkConcurrencyChanged)
 
 public:
     explicit ApiClient(QObject* parent = nullptr);
-    ~ApiClient() override = default;
+    ~ApiClient() override;
 
     QString serverUrl() const { return m_serverUrl; }
     void setServerUrl(const QString& url);
 
     bool isAuthenticated() const { return !m_accessToken.isEmpty(); }
-    bool isLoading() const { return m_loading; }
+    bool isLoading() const { return m_activeRequests > 0; }
+
+    // HTTP/2. Until set, Qt's default applies: h2 is offered through ALPN
+    // on https, plain http stays HTTP/1.1. Enabled adds prior knowledge
+    // (h2c) for plain http; disabled forces HTTP/1.1. Concurrent requests
+    // over HTTP/2 are multiplexed over one connection
+    bool http2Enabled() const { return m_http2.value_or(false); }
+    void setHttp2Enabled(bool enabled);
+    void resetHttp2();
+
+    // Time to first byte of the first request after startup or a server
+    // change, in ms; -1 until measured
+    double firstByteTimeMs() const { return m_firstByteTimeMs; }
+
+    // Pre-connects DNS + TCP (+ TLS) to the server so the first request
+    // does not pay for them; called automatically by setServerUrl
+    Q_INVOKABLE void warmUp();
 
-    // Token management
+    // Whether setServerUrl pre-connects (on by default). Off only to
+    // measure the cold start without the warm-up
+    bool warmUpEnabled() const { return m_warmUpEnabled; }
+    void setWarmUpEnabled(bool enabled) { m_warmUpEnabled = enabled; }
+
+    // Persistent TLS session tickets: loaded into every https request so the
+    // first request after launch resumes the previous session, updated after
+    // each handshake. Not owned; nullptr disables persistence
+    void setTlsSessionCache(TlsSessionCache* cache) { m_tlsSessionCache = cache; }
+
+    // Conditional-request cache of GET responses (peer list, peer configs).
+    // A 304 reply is answered from the cached decoded object; the limit is
+    // the total size of the cached response bodies, in bytes
+    int cacheHits() const { return m_cacheHits; }
+    int cacheMisses() const { return m_cacheMisses; }
+    qint64 cacheSize() const { return m_responseCache.totalCost(); }
+    qint64 cacheLimit() const { return m_responseCache.maxCost(); }
+    void setCacheLimit(qint64 bytes);
+    Q_INVOKABLE void clearResponseCache();
+
+    // Number of requests that were not sent because an identical GET was
+    // already in flight; their callers got the result of that request
+    int coalescedRequests() const { return m_coalescedRequests; }
+
+    // False while the circuit breaker is open: requests fail immediately
+    // instead of waiting for a server that is down
+    bool serverAvailable() const { return m_circuitBreaker.state() != CircuitBreaker::State::Open; }
+
+    // Requests whose result has not been delivered yet, in total and per
+    // endpoint ("GET /api/vpn/peers/%1/config" -> count)
+    int pendingRequests() const { return static_cast<int>(m_requests.size()); }
+    QVariantMap pendingByEndpoint() const;
+
+    // Phase timings of successful requests per endpoint (see RequestMetrics):
+    //   {endpoint: {phase: {count, mean, p50, p90, p99, max}}}, times in ms.
+    // writeMetrics stores the same data in the Prometheus text format
+    Q_INVOKABLE QVariantMap metricsSnapshot() const { return m_metrics.snapshot(); }
+    Q_INVOKABLE bool writeMetrics(const QString& path) const { return m_metrics.writePrometheusFile(path); }
+    Q_INVOKABLE void resetMetrics() { m_metrics.reset(); }
+
+    // Time requests waited in the scheduler per priority class, with the
+    // current load: {class: {count, mean, p50, p90, p99, max, active, queued}}
+    Q_INVOKABLE QVariantMap queueWaitSnapshot() const;
+
+    // Requests are admitted by priority (see RequestScheduler): interactive
+    // ones at once, at most backgroundConcurrency background ones at a time
+    int backgroundConcurrency() const { return m_scheduler.maxBackground(); }
+    void setBackgroundConcurrency(int concurrency);
+
+    // Every request method returns a request id. A cancelled request emits
+    // nothing; its reply is aborted unless a coalesced caller still needs it
+    Q_INVOKABLE void cancel(int requestId);
+
+    // Token management. The access token is refreshed REFRESH_MARGIN
+    // seconds (at most half its lifetime) before the "exp" of its JWT
+    // payload, no sooner than MIN_REFRESH_INTERVAL after the previous
+    // refresh; failed refreshes are retried with backoff. A 401 reply parks
+    // all authenticated requests until a single refresh completes
     void setTokens(const QString& accessToken, const QString& refreshToken) {
-        m_accessToken = accessToken;
         m_refreshToken = refreshToken;
+        setAccessToken(accessToken);
         emit authenticationChanged();
     }
 
+    // "exp" claim of a JWT in seconds since the epoch, 0 if there is none
+    static qint64 jwtExpiry(const QString& token);
+
     // Authentication
-    Q_INVOKABLE void login(const QString& username, const QString& password);
-    Q_INVOKABLE void registerUser(const QString& username, const QString& email, const QString& password);
+    Q_INVOKABLE int login(const QString& username, const QString& password);
+    Q_INVOKABLE int registerUser(const QString& username, const QString& email, const QString& password);
     Q_INVOKABLE void logout();
     Q_INVOKABLE void refreshToken();
 
     // Peers
-    Q_INVOKABLE void createPeer(const QString& deviceName, const QString& publicKey);
-    Q_INVOKABLE void getPeers();
-    Q_INVOKABLE void deletePeer(const QString& peerId);
-    Q_INVOKABLE void getPeerConfig(const QString& peerId);
+    Q_INVOKABLE int createPeer(const QString& deviceName, const QString& publicKey);
+    Q_INVOKABLE int getPeers();
+    // Peer list fetched in pages of pageSize and decoded while it downloads:
+    // every received chunk is delivered through peersBatchLoaded with the
+    // returned request id. The next page cursor comes in the X-Next-Cursor
+    // header; a server without pagination sends the whole list as one page.
+    // A page that is not an array of objects fails the load with apiError
+    Q_INVOKABLE int loadPeersPaged(int pageSize = 500);
+
+    // Delta sync of the local peer set: only peers changed since the last
+    // known revision are transferred (GET /api/vpn/peers/changes?since=)
+    // and applied, reported by peerAdded/peerUpdated/peerRemoved. A rejected
+    // revision (410) is followed by a full resync under the same request
+    // id; without the changes endpoint the full list is fetched and diffed
+    // locally
+    Q_INVOKABLE int syncPeers();
+    QList<PeerInfo> syncedPeers() const;
+    QString peerRevision() const { return m_peerRevision; }
+    Q_INVOKABLE int deletePeer(const QString& peerId);
+    Q_INVOKABLE int getPeerConfig(const QString& peerId);
+
+    // Bulk operations. The server bulk endpoint is used when it exists;
+    // otherwise (404/405/501, remembered per server) the items are sent as
+    // single requests, at most bulkConcurrency at a time (and as background
+    // requests no more than backgroundConcurrency). Progress comes in
+    // bulkProgress, the per-item outcome in one bulkFinished. The returned id
+    // can be passed to cancel()
+    //   devices - list of {deviceName, publicKey}
+    Q_INVOKABLE int createPeers(const QVariantList& devices);
+    Q_INVOKABLE int deletePeers(const QStringList& peerIds);
+
+    int bulkConcurrency() const { return m_bulkConcurrency; }
+    void setBulkConcurrency(int concurrency);
+
+    // JSON decoding of server responses
+    static PeerInfo parsePeer(const QJsonObject& obj);
+    static QList<PeerInfo> parsePeers(const QJsonArray& array);
 
 signals:
     void serverUrlChanged();
     void authenticationChanged();
     void loadingChanged();
+    void http2EnabledChanged();
+    void firstByteTimeMeasured(double ms, bool warmedUp, bool http2);
+    void responseCacheChanged();
+    void coalescedRequestsChanged();
+    void serverAvailableChanged();
+    void pendingRequestsChanged();
+    void bulkConcurrencyChanged();
 
     // Auth signals
     void loginSuccess(const AuthTokens& tokens);
@@ -99,30 +274,187 @@ signals:
     void peerCreated(const PeerInfo& peer, const ServerConfig& config);
     void peerCreateError(const QString& error);
     void peersLoaded(const QList<PeerInfo>& peers);
+    void peersBatchLoaded(int requestId, const QList<PeerInfo>& peers, bool last);
+    void peerAdded(const PeerInfo& peer);
+    void peerUpdated(const PeerInfo& peer);
+    void peerRemoved(const QString& peerId);
+    void peersSynced(int changes);
     void peerDeleted(const QString& peerId);
     void peerConfigLoaded(const QString& peerId, const QString& config);
     void apiError(const QString& error);
 
+    // Bulk signals. results[i] describes item i:
+    //   {ok, error, deviceName | peerId, peer (PeerInfo, created peers only)}
+    void bulkProgress(int bulkId, int completed, int total);
+    void bulkFinished(int bulkId, const QVariantList& results);
+
 private:
-    void sendRequest(const QString& endpoint,
-                     const QString& method,
-                     const QJsonObject& body,
-                     std::function<void(const QJsonObject&)> onSuccess,
-                     std::function<void(const QString&)> onError);
+    // Validators of a cached response and its decoded Decoder::Result
+    struct CachedResponse {
+        QByteArray etag;
+        QByteArray lastModified;
+        std::any value;
+    };
+
+    static constexpr int REFRESH_MARGIN = 60;   // seconds
+    static constexpr int MIN_REFRESH_INTERVAL = 10; // seconds
+
+    // Completion of one caller of send(); result is nullptr on error.
+    // status is the HTTP status of a failed reply, 0 without one
+    using ResultCallback = std::function<void(const std::any* result, const QString& error, int status)>;
+
+    // One logical request: shared by coalesced callers, kept across
+    // retries and replays
+    struct Operation {
+        QString coalescingKey;                  // null if not coalesced
+        QString endpointKey;                    // "GET /api/vpn/peers"
+        std::map<int, ResultCallback> callers;  // by request id
+        QNetworkReply* reply = nullptr;         // null while parked or backing off
+        bool cancelled = false;                 // every caller cancelled
+        QElapsedTimer started;                  // for the "total" phase
+        RequestPriority priority = RequestPriority::Normal;
+        RequestScheduler::Ticket queuedTicket = 0;  // while waiting in the scheduler
+    };
+    using OperationPtr = std::shared_ptr<Operation>;
+
+    // Single request path for every endpoint: the reply body is read once,
+    // decoded by Decoder and passed to onSuccess as Decoder::Result.
+    // Concurrent identical GETs share one reply and one decoded result.
+    // onError takes (const QString& error) or (const QString& error, int status).
+    // Returns the request id
+    template <typename Decoder, typename OnSuccess, typename OnError>
+    int send(const ApiEndpoint<Decoder>& endpoint,
+             const QString& pathArgument,
+             const QJsonObject& body,
+             OnSuccess onSuccess,
+             OnError onError);
+
+    // Sends the operation (again, when retried or replayed after a refresh)
+    // once the scheduler has a slot for its priority
+    template <typename Decoder>
+    void dispatch(ApiEndpoint<Decoder> endpoint, const QString& path, const QJsonObject& body,
+                  const OperationPtr& operation, bool replayed, int attempt);
+    template <typename Decoder>
+    void sendOperation(ApiEndpoint<Decoder> endpoint, const QString& path, const QJsonObject& body,
+                       const OperationPtr& operation, bool replayed, int attempt);
+
+    // Queues start in the scheduler; start holds the slot and must give it
+    // back with m_scheduler.finished(operation->priority)
+    void schedule(const OperationPtr& operation, std::function<void()> start);
+
+    // Delivers the result (nullptr on error) to every remaining caller
+    void completeOperation(const OperationPtr& operation, const std::any* result,
+                           const QString& error, int status = 0);
+
+    void fetchPeerPage(const OperationPtr& operation, int requestId, int pageSize, const QString& cursor,
+                       bool replayed);
+    void sendPeerPage(const OperationPtr& operation, int requestId, int pageSize, const QString& cursor,
+                      bool replayed);
+
+    // One createPeers/deletePeers call
+    struct BulkJob {
+        int id = 0;
+        bool create = true;
+        QVariantList items;         // {deviceName, publicKey} or peer ids
+        QVariantList results;
+        int next = 0;               // first item not sent yet
+        int completed = 0;
+        QHash<int, int> requests;   // item index (-1: bulk request) -> request id in flight
+    };
+    using BulkJobPtr = std::shared_ptr<BulkJob>;
 
-    void sendArrayRequest(const QString& endpoint,
-                          const QString& method,
-                          const QJsonObject& body,
-                          std::function<void(const QJsonArray&)> onSuccess,
-                          std::function<void(const QString&)> onError);
+    int startBulk(bool create, const QVariantList& items);
+    void sendBulkRequest(const BulkJobPtr& job);
+    void pumpBulk(const BulkJobPtr& job);
+    void completeBulkItem(const BulkJobPtr& job, int index, const QVariantMap& result);
+    void finishBulk(const BulkJobPtr& job);
 
-    void setLoading(bool loading);
+    void resetPeerSync();
+    // Sends the next request of a sync: the delta, a full resync after a
+    // 410, or the snapshot when the server has no changes endpoint. All of
+    // them answer to the id syncPeers() returned
+    void sendPeerSyncStep(int syncId);
+    int fetchPeerSnapshot(int syncId);
+    void publishPeerChanges(int changeCount, const QList<PeerInfo>& added,
+                            const QList<PeerInfo>& updated, const QStringList& removed);
+    void forgetRequest(int requestId, const QString& endpointKey);
+
+    QNetworkReply* startRequest(HttpMethod method, const QString& path, const QJsonObject& body,
+                                int transferTimeoutMs, RequestPriority priority,
+                                const CachedResponse* revalidate = nullptr);
+    void finishRequest(QNetworkReply* reply);
+
+    // Requests being sent or waiting for a retry; drives the loading property
+    void beginActivity();
+    void endActivity();
+
+    // Feeds the circuit breaker; serverFailure - connection error, timeout or 5xx
+    void recordServerOutcome(bool serverFailure);
+
+    // issuedNow: the token comes straight from the server (login, refresh)
+    // and its "iat" gives the offset of the local clock
+    void setAccessToken(const QString& accessToken, int expiresIn = 0, bool issuedNow = false);
+    static QJsonObject jwtClaims(const QString& token);
+    void scheduleTokenRefresh();
+    void startTokenRefresh();
+    void failParkedRequests(const QString& error);
+    void storeTlsSession(QNetworkReply* reply);
+    QString coalescingKeyFor(HttpMethod method, const QString& path, const QJsonObject& body) const;
+    void storeResponse(const QString& path, QNetworkReply* reply, qsizetype bodySize, std::any value);
 
     QNetworkAccessManager m_networkManager;
     QString m_serverUrl;
     QString m_accessToken;
     QString m_refreshToken;
-    bool m_loading = false;
+    QByteArray m_authorizationHeader;   // "Bearer <token>", rebuilt only when the token changes
+    qint64 m_accessTokenExpiry = 0;     // seconds since the epoch (local clock), 0 if unknown
+    qint64 m_accessTokenLifetime = 0;   // seconds
+    qint64 m_clockSkew = 0;             // server clock minus local clock, seconds
+    qint64 m_nextRefreshAllowed = 0;    // seconds since the epoch
+    int m_refreshFailures = 0;
+    QTimer m_refreshTimer;
+    bool m_refreshInProgress = false;
+
+    // Requests waiting for the token refresh
+    struct ParkedRequest {
+        std::function<void()> replay;
+        std::function<void(const QString&)> fail;
+    };
+    QList<ParkedRequest> m_parkedRequests;
+    int m_activeRequests = 0;
+
+    std::optional<bool> m_http2;        // unset: Qt's default
+    bool m_warmUpEnabled = true;
+    bool m_warmedUp = false;
+    QNetworkReply* m_firstRequest = nullptr;   // request whose TTFB is being measured
+    bool m_firstByteMeasured = false;
+    double m_firstByteTimeMs = -1.0;
+
+    TlsSessionCache* m_tlsSessionCache = nullptr;
+
+    static constexpr qint64 DEFAULT_CACHE_LIMIT = 4 * 1024 * 1024;
+    QCache<QString, CachedResponse> m_responseCache{DEFAULT_CACHE_LIMIT};   // key: request path
+    int m_cacheHits = 0;
+    int m_cacheMisses = 0;
+
+    CircuitBreaker m_circuitBreaker;
+    RequestScheduler m_scheduler;
+    RequestMetrics m_metrics;
+
+    std::map<int, OperationPtr> m_requests;          // by request id
+    QHash<QString, int> m_pendingByEndpoint;
+    QHash<QString, OperationPtr> m_pendingCalls;     // in-flight GETs, by coalescing key
+    int m_nextRequestId = 1;
+
+    std::map<int, BulkJobPtr> m_bulkJobs;
+    int m_bulkConcurrency = 4;
+    bool m_bulkEndpointMissing = false;     // for the current server
+
+    std::unique_ptr<PeerStore> m_peerStore;
+    std::map<int, int> m_peerSyncs;         // sync id -> request id of its current step
+    QString m_peerRevision;                 // empty: next sync is a full one
+    bool m_peerChangesMissing = false;      // for the current server
+    int m_coalescedRequests = 0;
 };
 
 } // namespace obsidian
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <cstdint>
+
+namespace obsidian {
+
+// BLAKE2s (RFC 7693) и построения поверх него, используемые WireGuard:
+// HASH, MAC (keyed BLAKE2s-128), HMAC-BLAKE2s и KDF1..KDF3 (HKDF).
+class Blake2s {
+public:
+    static constexpr size_t BLOCK_SIZE = 64;
+    static constexpr size_t HASH_SIZE = 32;
+    static constexpr size_t MAX_KEY_SIZE = 32;
+
+    using Hash = std::array<uint8_t, HASH_SIZE>;
+
+    // outSize 1..32, key до 32 байт (пустой - обычный хеш)
+    explicit Blake2s(size_t outSize = HASH_SIZE, std::span<const uint8_t> key = {});
+    ~Blake2s();
+
+    void update(std::span<const uint8_t> data);
+
+    // Записывает outSize байт; объект после этого не используется
+    void final(std::span<uint8_t> out);
+
+    static Hash hash(std::span<const uint8_t> data);
+    static void hash(std::span<uint8_t> out, std::span<const uint8_t> data,
+                     std::span<const uint8_t> key = {});
+
+    static Hash hmac(std::span<const uint8_t> key, std::span<const uint8_t> data);
+
+    // WireGuard KDF_n: T0 = HMAC(key, input), Ti = HMAC(T0, T(i-1) || i).
+    // out2/out3 вычисляются, только если не nullptr
+    static void hkdf(std::span<const uint8_t> key,
+                     std::span<const uint8_t> input,
+                     Hash& out1,
+                     Hash* out2 = nullptr,
+                     Hash* out3 = nullptr);
+
+private:
+    void compress(const uint8_t* block, bool last);
+
+    std::array<uint32_t, 8> m_h;
+    std::array<uint32_t, 2> m_t{};
+    std::array<uint8_t, BLOCK_SIZE> m_buffer{};
+    size_t m_bufferSize = 0;
+    size_t m_outSize;
+};
+
+} // namespace obsidian
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <cstdint>
+#include "WireGuardKeys.h"
+
+namespace obsidian {
+
+// ChaCha20-Poly1305 AEAD (RFC 8439) и XChaCha20-Poly1305
+// (draft-irtf-cfrg-xchacha) в том виде, в каком их использует WireGuard.
+// Все операции выполняются на месте над span без копирования данных.
+// ChaCha20 обрабатывает по 8 (AVX2) или 4 (SSSE3) блока за проход;
+// ядро выбирается в рантайме, на остальных CPU - скалярный код.
+class ChaCha20Poly1305 {
+public:
+    static constexpr size_t NONCE_SIZE = 12;
+    static constexpr size_t XNONCE_SIZE = 24;
+    static constexpr size_t TAG_SIZE = 16;
+
+    using Key = std::array<uint8_t, KEY_SIZE>;
+    using Nonce = std::array<uint8_t, NONCE_SIZE>;
+    using XNonce = std::array<uint8_t, XNONCE_SIZE>;
+
+    // Nonce транспортных сообщений WireGuard: 4 нулевых байта + счётчик (LE)
+    static Nonce counterNonce(uint64_t counter);
+
+    // buffer = открытый текст || TAG_SIZE свободных байт.
+    // Шифрует на месте и записывает тег в последние TAG_SIZE байт.
+    // false, если buffer короче тега
+    static bool seal(std::span<uint8_t> buffer,
+                     std::span<const uint8_t> associatedData,
+                     const Nonce& nonce,
+                     const Key& key);
+
+    // buffer = шифротекст || тег. Тег проверяется до расшифровки: при
+    // ошибке buffer не изменяется. При успехе открытый текст лежит в
+    // первых buffer.size() - TAG_SIZE байтах
+    static bool open(std::span<uint8_t> buffer,
+                     std::span<const uint8_t> associatedData,
+                     const Nonce& nonce,
+                     const Key& key);
+
+    // XChaCha20-Poly1305: 24-байтный nonce, подключ через HChaCha20
+    static bool xseal(std::span<uint8_t> buffer,
+                      std::span<const uint8_t> associatedData,
+                      const XNonce& nonce,
+                      const Key& key);
+    static bool xopen(std::span<uint8_t> buffer,
+                      std::span<const uint8_t> associatedData,
+                      const XNonce& nonce,
+                      const Key& key);
+
+    // Сырой поток ChaCha20: data ^= keystream, начиная с блока counter
+    static void chacha20Xor(std::span<uint8_t> data,
+                            const Key& key,
+                            const Nonce& nonce,
+                            uint32_t counter);
+
+    // XChaCha20 без аутентификации
+    static void xchacha20Xor(std::span<uint8_t> data,
+                             const Key& key,
+                             const XNonce& nonce,
+                             uint32_t counter);
+
+    static Key hchacha20(const Key& key, std::span<const uint8_t, 16> nonce);
+
+    // Poly1305 MAC (одноразовый ключ)
+    static std::array<uint8_t, TAG_SIZE> poly1305(std::span<const uint8_t> data,
+                                                  const Key& oneTimeKey);
+
+    // Имя выбранного ядра ChaCha20 ("avx2", "ssse3", "scalar")
+    static const char* chachaKernelName();
+};
+
+} // namespace obsidian
@@ -31,6 +31,18 @@ public:
     QString currentPeerId() const;
     void setCurrentPeerId(const QString& peerId);
 
+    // Number of key pairs kept pre-generated by KeyPool
+    int keyPoolSize() const;
+
+    // HTTP/2 for the API client; unset leaves Qt's default
+    std::optional<bool> http2Enabled() const;
+
+    // Parallel single requests of a bulk create/delete without a bulk endpoint
+    int bulkConcurrency() const;
+
+    // Background API requests (sync, bulk jobs) allowed in flight at once
+    int backgroundConcurrency() const;
+
     // Token storage (secure)
     void saveTokens(const QString& accessToken, const QString& refreshToken);
     std::optional<std::pair<QString, QString>> loadTokens() const;
@@ -48,6 +60,15 @@ public:
     Q_INVOKABLE static QString configDirectory();
     Q_INVOKABLE static QString configFilePath(const QString& peerId);
 
+    // Persistent TLS session tickets (see TlsSessionCache)
+    static QString tlsSessionCachePath();
+
+    // Request phase metrics in the Prometheus text format (ApiClient::writeMetrics)
+    Q_INVOKABLE static QString metricsFilePath();
+
+    // Seconds between automatic metrics dumps, 0 = only on demand
+    int metricsInterval() const;
+
 signals:
     void serverUrlChanged();
     void lastUsernameChanged();
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QHostInfo>
+#include <QElapsedTimer>
+#include <map>
+#include <memory>
+#include "WireGuardHandshake.h"
+
+class QUdpSocket;
+class QTimer;
+
+namespace obsidian {
+
+// Проверка доступности WireGuard-сервера без поднятия туннеля:
+// отправляет handshake initiation по UDP и ждёт корректный handshake
+// response. Время ответа измеряется от отправки датаграммы до её
+// получения (DNS не учитывается). Несколько проб могут идти параллельно.
+//
+// Сервер отвечает только известным ему пирам, поэтому нужен приватный
+// ключ устройства, зарегистрированного на этом сервере.
+class HandshakeProbe : public QObject {
+    Q_OBJECT
+
+    Q_PROPERTY(int pendingProbes READ pendingProbes NOTIFY pendingProbesChanged)
+
+public:
+    explicit HandshakeProbe(QObject* parent = nullptr);
+    ~HandshakeProbe() override;
+
+    int pendingProbes() const { return static_cast<int>(m_probes.size()); }
+
+    // endpoint - "host:port" или "[ipv6]:port" как в конфиге WireGuard,
+    // ключи в Base64. Возвращает id пробы; результат приходит в probeFinished
+    // (всегда асинхронно, в том числе при ошибке в аргументах)
+    Q_INVOKABLE int probe(const QString& endpoint,
+                          const QString& serverPublicKey,
+                          const QString& privateKey,
+                          const QString& presharedKey = QString(),
+                          int timeoutMs = 3000);
+
+    Q_INVOKABLE void cancel(int probeId);
+
+signals:
+    // rttMs < 0, если ответа от сервера не было
+    void probeFinished(int probeId, const QString& endpoint,
+                       bool success, double rttMs, const QString& error);
+    void pendingProbesChanged();
+
+private:
+    struct Probe {
+        QString endpoint;
+        quint16 port = 0;
+        int lookupId = -1;
+        std::unique_ptr<WireGuardHandshake> handshake;
+        QUdpSocket* socket = nullptr;
+        QTimer* timer = nullptr;
+        QElapsedTimer elapsed;
+    };
+
+    void onHostResolved(int probeId, const QHostInfo& info);
+    void onReadyRead(int probeId);
+    void finish(int probeId, bool success, double rttMs, const QString& error);
+
+    std::map<int, Probe> m_probes;
+    int m_nextProbeId = 1;
+};
+
+} // namespace obsidian
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace obsidian {
+
+// Incremental splitter of a top-level JSON array into its elements, fed
+// with network chunks as they arrive. Only the element currently split
+// across chunks is buffered; each complete element is handed out as a
+// view that is valid during the callback and can be parsed on its own.
+//
+// Elements are delimited, not validated: malformed JSON inside an element
+// is left to the element parser. Structural errors around the elements
+// (no '[', garbage between elements or after ']') make the stream failed.
+class JsonArrayStream {
+public:
+    using ElementHandler = std::function<void(std::string_view element)>;
+
+    // False once the stream has failed
+    bool feed(std::string_view chunk, const ElementHandler& onElement);
+
+    bool finished() const { return m_state == State::Done; }
+    bool failed() const { return m_state == State::Error; }
+
+private:
+    enum class State {
+        BeforeArray,
+        BeforeFirstElement,     // after '[': an element or ']'
+        BeforeElement,          // after ',': an element
+        InElement,
+        AfterElement,           // ',' or ']'
+        Done,
+        Error
+    };
+
+    void emitElement(std::string_view chunk, size_t begin, size_t end, const ElementHandler& onElement);
+
+    State m_state = State::BeforeArray;
+    int m_depth = 0;
+    bool m_inString = false;
+    bool m_escape = false;
+    std::string m_partial;      // start of an element split across chunks
+};
+
+} // namespace obsidian
@@ -2,7 +2,10 @@
 
 #include <QObject>
 #include <QString>
+#include <QVariantList>
+#include <QVariantMap>
 #include "WireGuardKeys.h"
+#include "KeyPool.h"
 
 namespace obsidian {
 
@@ -11,27 +14,59 @@ class KeyGenerator : public QObject {
 
 public:
     explicit KeyGenerator(QObject* parent = nullptr) : QObject(parent) {}
-    ~KeyGenerator() override = default;
+    ~KeyGenerator() override {
+        WireGuardKeys::secureZero(m_currentKeyPair);
+    }
+
+    // Пул готовых пар; без пула пара генерируется синхронно
+    void setKeyPool(KeyPool* pool) { m_keyPool = pool; }
 
     Q_INVOKABLE bool generateKeyPair() {
-        auto result = WireGuardKeys::generateKeyPair();
+        std::optional<KeyPair> result;
+        if (m_keyPool) {
+            result = m_keyPool->take();
+        }
+        if (!result) {
+            result = WireGuardKeys::generateKeyPair();
+        }
         if (!result) {
             return false;
         }
 
         m_currentKeyPair = *result;
+        WireGuardKeys::secureZero(*result);
+        m_publicKeyBase64 = toBase64String(m_currentKeyPair.publicKey);
         m_hasKeys = true;
         return true;
     }
 
+    // Пакетная генерация за один вызов из QML/CLI.
+    // Возвращает список {publicKey, privateKey} в Base64; пустой список при ошибке.
+    Q_INVOKABLE QVariantList generateKeyPairs(int count) const {
+        QVariantList result;
+        if (count <= 0) return result;
+
+        auto pairs = WireGuardKeys::generateKeyPairs(static_cast<size_t>(count));
+        result.reserve(static_cast<qsizetype>(pairs.size()));
+
+        for (auto& pair : pairs) {
+            QVariantMap entry;
+            entry.insert(QStringLiteral("publicKey"), toBase64String(pair.publicKey));
+            entry.insert(QStringLiteral("privateKey"), toBase64String(pair.privateKey));
+            result.append(entry);
+            WireGuardKeys::secureZero(pair);
+        }
+
+        return result;
+    }
+
     Q_INVOKABLE QString publicKey() const {
-        if (!m_hasKeys) return QString();
-        return QString::fromStdString(m_currentKeyPair.publicKeyBase64());
+        return m_publicKeyBase64;
     }
 
     Q_INVOKABLE QString privateKey() const {
         if (!m_hasKeys) return QString();
-        return QString::fromStdString(m_currentKeyPair.privateKeyBase64());
+        return toBase64String(m_currentKeyPair.privateKey);
     }
 
     Q_INVOKABLE bool hasKeys() const {
@@ -39,12 +74,22 @@ public:
     }
 
     Q_INVOKABLE void clearKeys() {
-        m_currentKeyPair = KeyPair();
+        WireGuardKeys::secureZero(m_currentKeyPair);
+        m_publicKeyBase64.clear();
         m_hasKeys = false;
     }
 
 private:
+    // Кодирование в стековый буфер без промежуточного std::string
+    static QString toBase64String(const std::array<uint8_t, KEY_SIZE>& key) {
+        char buffer[KEY_BASE64_SIZE];
+        WireGuardKeys::toBase64(key, buffer);
+        return QString::fromLatin1(buffer, KEY_BASE64_SIZE);
+    }
+
+    KeyPool* m_keyPool = nullptr;
     KeyPair m_currentKeyPair;
+    QString m_publicKeyBase64;  // кэш: publicKey() вызывается из QML многократно
     bool m_hasKeys = false;
 };
 
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QObject>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <optional>
+#include "WireGuardKeys.h"
+
+namespace obsidian {
+
+// Пул заранее сгенерированных ключевых пар.
+// Фоновый поток с приоритетом IdlePriority держит в пуле до capacity пар,
+// take() отдаёт готовую пару за O(1) без скалярного умножения в GUI-потоке.
+class KeyPool : public QObject {
+    Q_OBJECT
+
+    Q_PROPERTY(int capacity READ capacity WRITE setCapacity NOTIFY capacityChanged)
+    Q_PROPERTY(int hits READ hits NOTIFY statsChanged)
+    Q_PROPERTY(int misses READ misses NOTIFY statsChanged)
+
+public:
+    explicit KeyPool(int capacity = 4, QObject* parent = nullptr);
+    ~KeyPool() override;
+
+    int capacity() const;
+    void setCapacity(int capacity);
+
+    int hits() const { return m_hits.load(std::memory_order_relaxed); }
+    int misses() const { return m_misses.load(std::memory_order_relaxed); }
+
+    // Число готовых пар в пуле
+    Q_INVOKABLE int available() const;
+
+    // Готовая пара из пула; std::nullopt, если пул пуст (промах) -
+    // тогда вызывающий генерирует пару сам
+    std::optional<KeyPair> take();
+
+signals:
+    void capacityChanged();
+    void statsChanged();
+
+private:
+    void refillLoop();
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_needKeys;
+    std::deque<KeyPair> m_keys;
+    size_t m_capacity;
+    bool m_stopping = false;
+
+    std::atomic<int> m_hits{0};
+    std::atomic<int> m_misses{0};
+
+    std::unique_ptr<QThread> m_worker;
+};
+
+} // namespace obsidian
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace obsidian {
+
+// Latency histogram in the style of HdrHistogram: every power of two is
+// split into SUB_BUCKETS linear buckets, so a value is kept with a relative
+// error below 1/SUB_BUCKETS over the whole range (1 us .. ~71 min) in a
+// fixed 3.7 KB. Recording is lock-free (relaxed atomic increments) and may
+// happen on any thread while others read percentiles.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t(1) << SUB_BUCKET_BITS;
+    static constexpr int VALUE_BITS = 32;       // larger values are clamped
+    static constexpr uint64_t MAX_VALUE = (uint64_t(1) << VALUE_BITS) - 1;
+    static constexpr size_t BUCKET_COUNT = (VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    void record(uint64_t micros) noexcept;
+
+    uint64_t count() const noexcept { return m_count.load(std::memory_order_relaxed); }
+    uint64_t sumMicros() const noexcept { return m_sum.load(std::memory_order_relaxed); }
+    uint64_t maxMicros() const noexcept { return m_max.load(std::memory_order_relaxed); }
+
+    // Value at quantile q (0..1): the highest value of its bucket, capped
+    // by the maximum; 0 while empty
+    uint64_t percentile(double q) const noexcept;
+
+    // Not atomic as a whole: samples recorded meanwhile may be half-counted
+    void reset() noexcept;
+
+    static size_t bucketIndex(uint64_t micros) noexcept;
+    static uint64_t bucketHighestValue(size_t index) noexcept;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> m_buckets{};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_max{0};
+};
+
+} // namespace obsidian
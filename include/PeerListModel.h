@@ -0,0 +1,106 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVariantMap>
+#include "ApiClient.h"
+#include "PeerTable.h"
+
+namespace obsidian {
+
+// Peer list for the QML ListView. A new list is diffed against the shown
+// one by peer id and applied with the fewest row signals: ranges of
+// removed and inserted rows, moves, and dataChanged carrying only the roles
+// that changed. Refreshing 10k peers with one change touches one row, and
+// the delegates of the other rows are kept.
+//
+// The current and the selected device are roles too, so changing either
+// updates two rows instead of re-evaluating a binding in every delegate.
+//
+// Rows are kept packed in a PeerTable; data() builds the QString of a role
+// only when a delegate asks for it, i.e. for the rows on screen.
+class PeerListModel : public QAbstractListModel {
+    Q_OBJECT
+
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(QString currentPeerId READ currentPeerId WRITE setCurrentPeerId NOTIFY currentPeerIdChanged)
+    Q_PROPERTY(QString selectedPeerId READ selectedPeerId WRITE setSelectedPeerId NOTIFY selectedPeerIdChanged)
+    Q_PROPERTY(bool hasCurrentPeer READ hasCurrentPeer NOTIFY hasCurrentPeerChanged)
+
+public:
+    enum Role {
+        PeerIdRole = Qt::UserRole + 1,
+        DeviceNameRole,
+        ProtocolRole,
+        IpAddressRole,
+        PublicKeyRole,
+        IsActiveRole,
+        IsCurrentDeviceRole,
+        SelectedRole
+    };
+
+    explicit PeerListModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    int count() const { return static_cast<int>(m_peers.size()); }
+
+    // Full list in server order, diffed against the shown one
+    void setPeers(const QList<PeerInfo>& peers);
+
+    // Pages of ApiClient::loadPeersPaged. The first load is shown as pages
+    // arrive; later ones are collected and diffed in once complete, so the
+    // old rows stay until then. beginLoad() starts collecting the load with
+    // that request id and drops the pages of the previous one; pages of any
+    // other load (cancelled, or started elsewhere) are ignored
+    Q_INVOKABLE void beginLoad(int requestId);
+    void addBatch(int requestId, const QList<PeerInfo>& peers, bool last);
+
+    // Single changes (delta sync, delete): an unknown peer is appended
+    void upsertPeer(const PeerInfo& peer);
+    void removePeer(const QString& peerId);
+
+    QString currentPeerId() const { return m_currentPeerId; }
+    void setCurrentPeerId(const QString& peerId);
+
+    QString selectedPeerId() const { return m_selectedPeerId; }
+    void setSelectedPeerId(const QString& peerId);
+
+    bool hasCurrentPeer() const { return contains(m_currentPeerId); }
+
+    Q_INVOKABLE int indexOf(const QString& peerId) const { return static_cast<int>(m_index.find(m_peers, peerId)); }
+    Q_INVOKABLE bool contains(const QString& peerId) const { return m_index.contains(m_peers, peerId); }
+
+    // Roles of a row by name, as ListModel.get() returns them
+    Q_INVOKABLE QVariantMap get(int row) const;
+
+signals:
+    void countChanged();
+    void currentPeerIdChanged();
+    void selectedPeerIdChanged();
+    void hasCurrentPeerChanged();
+
+private:
+    // dataChanged of one role in the row of peerId, if it is shown
+    void emitRowChanged(const QString& peerId, int role);
+    // Replaces the row's peer, signalling only the roles that changed
+    void updateRow(int row, const PeerInfo& peer);
+    // Unknown peers as one inserted range at the end, known ones updated
+    void appendPeers(const QList<PeerInfo>& peers);
+
+    PeerTable m_peers;
+    PeerIndex m_index;              // id -> row
+
+    int m_loadId = 0;               // request id of the load in progress
+    QList<PeerInfo> m_incoming;     // pages of the load in progress
+    bool m_streaming = false;       // rows of this load are shown as they arrive
+
+    QString m_currentPeerId;
+    QString m_selectedPeerId;
+};
+
+} // namespace obsidian
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QList>
+#include <QStringList>
+#include "ApiClient.h"
+#include "PeerTable.h"
+
+namespace obsidian {
+
+// Local copy of the account's peer list kept up to date by delta sync.
+// Peers stay in server order, packed in a PeerTable; lookups by id go
+// through an index.
+class PeerStore {
+public:
+    struct Changes {
+        QList<PeerInfo> added;
+        QList<PeerInfo> updated;
+        QStringList removed;
+
+        int count() const { return static_cast<int>(added.size() + updated.size() + removed.size()); }
+    };
+
+    // Delta from the server: new or changed peers, ids of deleted ones
+    Changes apply(const QList<PeerInfo>& upserts, const QStringList& deleted);
+
+    // Full list from the server, diffed against the current one
+    Changes replace(const QList<PeerInfo>& snapshot);
+
+    const PeerTable& peers() const { return m_peers; }
+    qsizetype indexOf(const QString& id) const { return m_index.find(m_peers, id); }
+    qsizetype size() const { return m_peers.size(); }
+    void clear();
+
+private:
+    PeerTable m_peers;
+    PeerIndex m_index;  // id -> row of m_peers
+};
+
+} // namespace obsidian
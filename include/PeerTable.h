@@ -0,0 +1,173 @@
+#pragma once
+
+#include <QByteArrayView>
+#include <QList>
+#include <QSharedDataPointer>
+#include <QString>
+#include <QStringView>
+#include <QUtf8StringView>
+#include "ApiClient.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace obsidian {
+
+// Interned UTF-8 strings: each distinct string is stored once and referred
+// to by a 32-bit index. Strings are never removed; PeerTable rebuilds its
+// pool when most of it is no longer referenced.
+class StringPool {
+public:
+    uint32_t intern(QStringView text);
+    uint32_t intern(QByteArrayView utf8);
+    QUtf8StringView text(uint32_t index) const {
+        return QUtf8StringView(m_text.data() + m_offsets[index], m_offsets[index + 1] - m_offsets[index]);
+    }
+    QString toString(uint32_t index) const { return text(index).toString(); }
+
+    uint32_t count() const { return static_cast<uint32_t>(m_offsets.size() - 1); }
+    size_t memoryUsage() const;
+
+private:
+    void rehash(size_t slots);
+
+    std::string m_text;                     // all strings back to back
+    std::vector<uint32_t> m_offsets{0};     // string i is [offsets[i], offsets[i + 1])
+    std::vector<uint32_t> m_slots;          // open addressing: index + 1, 0 if empty
+};
+
+// Peer list as a structure of arrays, for accounts with many thousands of
+// devices. Per peer it keeps the UUID as 16 bytes, the public key as its
+// 32 raw bytes, the address as 4 or 16 bytes plus a prefix length, and the
+// device name and protocol as StringPool indexes. A value that does not
+// round-trip through its packed form (a non-UUID id, a malformed key) is
+// kept as pooled text instead, so at(row) always returns the PeerInfo that
+// was stored.
+//
+// QString values are only built when asked for, e.g. by the model for the
+// rows a view shows. Copies share the data until one of them is modified,
+// so a snapshot is O(1).
+class PeerTable {
+public:
+    enum Field {
+        Id = 1 << 0,
+        DeviceName = 1 << 1,
+        Protocol = 1 << 2,
+        IpAddress = 1 << 3,
+        PublicKey = 1 << 4,
+        Active = 1 << 5
+    };
+
+    PeerTable();
+    explicit PeerTable(const QList<PeerInfo>& peers);
+
+    qsizetype size() const { return static_cast<qsizetype>(d->flags.size()); }
+    bool isEmpty() const { return size() == 0; }
+
+    PeerInfo at(qsizetype row) const;
+    QList<PeerInfo> toList() const;
+
+    QString id(qsizetype row) const;
+    bool idEquals(qsizetype row, QStringView id) const;
+    QString deviceName(qsizetype row) const { return d->strings.toString(d->deviceNames[row]); }
+    QString protocol(qsizetype row) const { return d->strings.toString(d->protocols[row]); }
+    QString ipAddress(qsizetype row) const;
+    QString publicKey(qsizetype row) const;
+    bool isActive(qsizetype row) const { return d->flags[row] & ActiveFlag; }
+
+    // Hash of an id, equal for a row and its id text; PeerIndex uses it to
+    // look rows up without keeping the ids as QStrings
+    size_t idHash(qsizetype row) const;
+    static size_t idHash(QStringView id);
+
+    // Fields of the stored row that differ from peer, compared without
+    // building QStrings
+    int differences(qsizetype row, const PeerInfo& peer) const;
+
+    void append(const PeerInfo& peer) { insert(size(), {peer}); }
+    void append(const QList<PeerInfo>& peers) { insert(size(), peers); }
+    void insert(qsizetype row, const QList<PeerInfo>& peers);
+    void replace(qsizetype row, const PeerInfo& peer);
+    void remove(qsizetype row, qsizetype count = 1);
+    // Removes the rows marked in drop, in one pass
+    void removeRows(const std::vector<bool>& drop);
+    void move(qsizetype from, qsizetype to);
+    void clear();
+
+    // Heap and object bytes held by the table
+    size_t memoryUsage() const;
+
+private:
+    enum Flag : uint8_t {
+        ActiveFlag = 1 << 0,
+        IdText = 1 << 1,        // ids[row] holds a StringPool index
+        KeyText = 1 << 2,       // keys[row] holds a StringPool index
+        AddressText = 1 << 3,   // addresses[row] holds a StringPool index
+        Ipv6 = 1 << 4,
+        HasPrefix = 1 << 5      // "/prefix" after the address
+    };
+
+    // One peer in packed form
+    struct Row {
+        std::array<uint8_t, 16> id{};
+        std::array<uint8_t, 32> key{};
+        std::array<uint8_t, 16> address{};
+        uint32_t deviceName = 0;
+        uint32_t protocol = 0;
+        uint8_t prefix = 0;
+        uint8_t flags = 0;
+    };
+
+    struct Data : QSharedData {
+        std::vector<std::array<uint8_t, 16>> ids;
+        std::vector<std::array<uint8_t, 32>> keys;
+        std::vector<std::array<uint8_t, 16>> addresses;
+        std::vector<uint32_t> deviceNames;
+        std::vector<uint32_t> protocols;
+        std::vector<uint8_t> prefixes;
+        std::vector<uint8_t> flags;
+        StringPool strings;
+        uint32_t compactedCount = 0;    // strings.count() after the last compaction
+    };
+
+    Row encode(const PeerInfo& peer);
+    Row row(qsizetype index) const;
+    void store(qsizetype index, const Row& row);
+    bool keyEquals(qsizetype index, QStringView key) const;
+    bool addressEquals(qsizetype index, QStringView address) const;
+    // Rebuilds the pool once most of its strings are no longer used
+    void compactStrings();
+
+    QSharedDataPointer<Data> d;
+};
+
+// Row of a peer id in a PeerTable: open addressing over row numbers, the
+// ids themselves stay in the table. Rows are not removed one by one; the
+// index is rebuilt after rows are removed or moved.
+class PeerIndex {
+public:
+    void rebuild(const PeerTable& table);
+    // For rows appended to the table since the last rebuild
+    void insert(const PeerTable& table, qsizetype row);
+    void clear();
+
+    qsizetype find(const PeerTable& table, QStringView id) const;
+    bool contains(const PeerTable& table, QStringView id) const { return find(table, id) >= 0; }
+
+    size_t memoryUsage() const { return m_slots.capacity() * sizeof(Slot); }
+
+private:
+    struct Slot {
+        uint32_t row = 0;   // row + 1, 0 if empty
+        uint32_t hash = 0;  // low bits of the id hash, to skip most comparisons
+    };
+
+    void resize(size_t slots);
+    void place(uint32_t row, size_t hash);
+
+    std::vector<Slot> m_slots;
+    size_t m_count = 0;
+};
+
+} // namespace obsidian
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVariantMap>
+#include "LatencyHistogram.h"
+#include <array>
+#include <map>
+#include <memory>
+
+namespace obsidian {
+
+// Phase timings of successful API requests, per endpoint ("GET /api/vpn/peers"):
+//   queue    - request issued -> a connection starts or the request is written
+//   connect  - new connection only: DNS + TCP + TLS handshake; QNetworkReply
+//              reports no boundary between them
+//   ttfb     - request written -> response headers
+//   download - response headers -> last byte
+//   decode   - parsing the body into the result type
+//   dispatch - callbacks and signals delivering the result
+//   total    - the caller's request -> result delivered, retries and token
+//              refresh included
+// Histograms are created on first use and only touched on the ApiClient thread.
+class RequestMetrics {
+public:
+    enum class Phase {
+        Queue,
+        Connect,
+        Ttfb,
+        Download,
+        Decode,
+        Dispatch,
+        Total
+    };
+    static constexpr size_t PHASE_COUNT = 7;
+
+    static const char* phaseName(Phase phase);
+
+    void record(const QString& endpoint, Phase phase, qint64 nanoseconds);
+
+    // Time a request of a priority class ("interactive", "normal",
+    // "background") waited in the RequestScheduler before it was sent
+    void recordQueueWait(const QString& priorityClass, qint64 nanoseconds);
+
+    // {endpoint: {phase: {count, mean, p50, p90, p99, max}}}, times in ms
+    QVariantMap snapshot() const;
+
+    // {priorityClass: {count, mean, p50, p90, p99, max}}, times in ms
+    QVariantMap queueWaitSnapshot() const;
+
+    // Prometheus text exposition format, one summary per endpoint and phase
+    // and one per priority class for the queue wait
+    QByteArray prometheusText() const;
+
+    // Replaced atomically, as the node_exporter textfile collector expects
+    bool writePrometheusFile(const QString& path) const;
+
+    void reset();
+
+private:
+    using Histograms = std::array<std::unique_ptr<LatencyHistogram>, PHASE_COUNT>;
+    std::map<QString, Histograms> m_endpoints;
+    std::map<QString, std::unique_ptr<LatencyHistogram>> m_queueWaits;
+};
+
+} // namespace obsidian
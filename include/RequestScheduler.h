@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+namespace obsidian {
+
+// How urgently the result of an API request is needed
+enum class RequestPriority {
+    Interactive,    // the user is waiting for it: login, create, config of a clicked peer
+    Normal,
+    Background      // sync, bulk jobs, anything nobody is looking at yet
+};
+
+// Admission of API requests to the network. Interactive requests always
+// start at once; normal and background ones start while fewer than
+// maxActive requests are running, background ones only while fewer than
+// maxBackground of them are. The rest wait in one FIFO queue per class and
+// are started most urgent first as slots free up. A class with work and
+// nothing running may always start one request, even above maxActive, so
+// background traffic still moves while normal requests keep coming.
+//
+// maxActive matches the six connections per host of QNetworkAccessManager:
+// a request it has to queue is out of reach, one queued here can still be
+// overtaken by an interactive request.
+class RequestScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Ticket = uint64_t;
+
+    // Runs once the request holds a slot; waited is the time spent queued.
+    // The holder must call finished() exactly once, also if it sends nothing
+    using Start = std::function<void(Clock::duration waited)>;
+
+    static constexpr size_t PRIORITY_COUNT = 3;
+
+    explicit RequestScheduler(int maxActive = 6, int maxBackground = 2);
+
+    // Starts the request now if the limits allow and no request of the same
+    // or a more urgent class is queued. Returns the ticket of the queued
+    // request, 0 if it has started
+    Ticket submit(RequestPriority priority, Start start, Clock::time_point now = Clock::now());
+
+    // Moves a queued request to a more urgent class (it may start at once);
+    // false if it is not queued any more
+    bool promote(Ticket ticket, RequestPriority priority, Clock::time_point now = Clock::now());
+
+    // Drops a queued request without starting it
+    bool cancel(Ticket ticket);
+
+    // Releases the slot of a started request and starts queued ones
+    void finished(RequestPriority priority, Clock::time_point now = Clock::now());
+
+    void setLimits(int maxActive, int maxBackground, Clock::time_point now = Clock::now());
+    int maxActive() const { return m_maxActive; }
+    int maxBackground() const { return m_maxBackground; }
+
+    int active(RequestPriority priority) const { return m_active[index(priority)]; }
+    int queued(RequestPriority priority) const { return static_cast<int>(m_queues[index(priority)].size()); }
+
+    static const char* priorityName(RequestPriority priority);
+
+private:
+    struct Waiting {
+        Ticket ticket;
+        Start start;
+        Clock::time_point since;
+    };
+
+    static size_t index(RequestPriority priority) { return static_cast<size_t>(priority); }
+
+    bool hasRoom(RequestPriority priority) const;
+    void run(RequestPriority priority, Start start, Clock::duration waited);
+    void pump(Clock::time_point now);
+
+    int m_maxActive;
+    int m_maxBackground;
+
+    std::array<int, PRIORITY_COUNT> m_active{};
+    std::array<std::deque<Waiting>, PRIORITY_COUNT> m_queues;
+    Ticket m_nextTicket = 1;
+    bool m_pumping = false;
+};
+
+} // namespace obsidian
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+
+namespace obsidian {
+
+// Timeout and retry settings of an API endpoint
+struct ResiliencePolicy {
+    int transferTimeoutMs = 15000;  // no data for this long aborts the transfer
+    int maxAttempts = 1;            // 1 = no retries; only for idempotent requests
+    int backoffBaseMs = 250;
+    int backoffMaxMs = 4000;
+
+    // "Full jitter" exponential backoff before attempt number `attempt`
+    // (2, 3, ...): uniform in [0, min(max, base * 2^(attempt - 2))).
+    // random01 is a uniform random number in [0, 1)
+    int backoffDelayMs(int attempt, double random01) const;
+};
+
+// Circuit breaker for the API server. After failureThreshold consecutive
+// server failures (connection errors, timeouts, 5xx) it opens and requests
+// fail immediately; after openDuration a single probe request is let
+// through (half-open), and its outcome closes or re-opens the circuit.
+class CircuitBreaker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State {
+        Closed,
+        Open,
+        HalfOpen
+    };
+
+    explicit CircuitBreaker(int failureThreshold = 5,
+                            std::chrono::milliseconds openDuration = std::chrono::seconds(15));
+
+    // Whether a request may be sent now
+    bool allowRequest(Clock::time_point now = Clock::now());
+
+    void recordSuccess();
+    void recordFailure(Clock::time_point now = Clock::now());
+    void reset();
+
+    State state() const { return m_state; }
+
+private:
+    int m_failureThreshold;
+    std::chrono::milliseconds m_openDuration;
+
+    State m_state = State::Closed;
+    int m_failures = 0;
+    Clock::time_point m_openedAt;
+    Clock::time_point m_probeStartedAt;
+    bool m_probeInFlight = false;
+};
+
+} // namespace obsidian
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QUrl>
+
+namespace obsidian {
+
+// On-disk cache of TLS session tickets, keyed by server origin
+// (scheme://host:port). Lets the first request after launch resume the
+// previous TLS session instead of doing a full handshake.
+//
+// Tickets carry resumption secrets: the file is owner-only and every
+// entry expires after the server's lifetime hint (capped at MAX_LIFETIME).
+class TlsSessionCache {
+public:
+    static constexpr int DEFAULT_LIFETIME = 2 * 60 * 60;    // seconds
+    static constexpr int MAX_LIFETIME = 24 * 60 * 60;
+
+    explicit TlsSessionCache(const QString& filePath);
+
+    // Empty if there is no valid ticket for this server
+    QByteArray ticket(const QUrl& serverUrl) const;
+
+    // lifetimeHint - QSslConfiguration::sessionTicketLifeTimeHint(), seconds
+    void store(const QUrl& serverUrl, const QByteArray& ticket, int lifetimeHint);
+    void remove(const QUrl& serverUrl);
+
+    QString filePath() const { return m_filePath; }
+
+private:
+    struct Entry {
+        QByteArray ticket;
+        QDateTime expires;
+    };
+
+    static QString originKey(const QUrl& url);
+    void load();
+    bool save() const;
+    void dropExpired();
+
+    QString m_filePath;
+    QHash<QString, Entry> m_entries;
+};
+
+} // namespace obsidian
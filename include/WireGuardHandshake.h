@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <cstdint>
+#include "WireGuardKeys.h"
+#include "Blake2s.h"
+
+namespace obsidian {
+
+// Сторона инициатора рукопожатия WireGuard (Noise_IKpsk2_25519_ChaChaPoly_BLAKE2s):
+// формирует сообщение 1 (handshake initiation) и проверяет сообщение 2
+// (handshake response). Транспортные ключи не выводятся - класс нужен для
+// проверки доступности сервера без поднятия туннеля.
+class WireGuardHandshake {
+public:
+    using Key = std::array<uint8_t, KEY_SIZE>;
+
+    static constexpr size_t INITIATION_SIZE = 148;
+    static constexpr size_t RESPONSE_SIZE = 92;
+    static constexpr size_t COOKIE_REPLY_SIZE = 64;
+
+    enum class MessageType : uint8_t {
+        Initiation = 1,
+        Response = 2,
+        CookieReply = 3,
+        Transport = 4
+    };
+
+    enum class ResponseStatus {
+        Valid,          // Ответ сервера прошёл все проверки
+        CookieReply,    // Сервер под нагрузкой и требует cookie (но доступен)
+        Invalid         // Чужой, повреждённый или не прошедший проверку пакет
+    };
+
+    // presharedKey - нулевой ключ, если PSK не используется
+    WireGuardHandshake(const Key& localPrivateKey,
+                       const Key& remotePublicKey,
+                       const Key& presharedKey = {});
+    ~WireGuardHandshake();
+
+    WireGuardHandshake(const WireGuardHandshake&) = delete;
+    WireGuardHandshake& operator=(const WireGuardHandshake&) = delete;
+
+    // Сообщение 1; false, если источник энтропии недоступен или
+    // публичный ключ сервера имеет малый порядок
+    bool createInitiation(uint32_t senderIndex, std::span<uint8_t, INITIATION_SIZE> out);
+
+    // Проверка датаграммы от сервера после createInitiation()
+    ResponseStatus consumeResponse(std::span<const uint8_t> message);
+
+    uint32_t senderIndex() const { return m_senderIndex; }
+    uint32_t remoteIndex() const { return m_remoteIndex; }
+
+private:
+    void mixHash(std::span<const uint8_t> data);
+
+    Key m_localPrivate;
+    Key m_localPublic;
+    Key m_remotePublic;
+    Key m_presharedKey;
+
+    // Состояние Noise после сообщения 1
+    Blake2s::Hash m_chainingKey{};
+    Blake2s::Hash m_hash{};
+    KeyPair m_ephemeral{};
+
+    uint32_t m_senderIndex = 0;
+    uint32_t m_remoteIndex = 0;
+    bool m_initiated = false;
+};
+
+} // namespace obsidian
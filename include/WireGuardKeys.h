@@ -1,8 +1,11 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <array>
 #include <optional>
+#include <vector>
+#include <span>
 #include <cstdint>
 
 namespace obsidian {
@@ -11,6 +14,9 @@ namespace obsidian {
 // Размер ключа: 32 байта
 constexpr size_t KEY_SIZE = 32;
 
+// Base64 ключа: 43 значащих символа + '='
+constexpr size_t KEY_BASE64_SIZE = 44;
+
 struct KeyPair {
     std::array<uint8_t, KEY_SIZE> privateKey;
     std::array<uint8_t, KEY_SIZE> publicKey;
@@ -24,26 +30,71 @@ public:
     // Генерация новой ключевой пары
     static std::optional<KeyPair> generateKeyPair();
 
+    // Пакетная генерация: энтропия читается одним блоком из CSPRNG ядра,
+    // скалярные умножения распределяются по всем ядрам.
+    // Пустой вектор при ошибке источника энтропии.
+    static std::vector<KeyPair> generateKeyPairs(size_t count);
+    static bool generateKeyPairs(std::span<KeyPair> out);
+
     // Вычисление публичного ключа из приватного
     static std::array<uint8_t, KEY_SIZE> derivePublicKey(
         const std::array<uint8_t, KEY_SIZE>& privateKey);
 
+    // X25519 общий секрет; std::nullopt для точек малого порядка (нулевой результат)
+    static std::optional<std::array<uint8_t, KEY_SIZE>> sharedSecret(
+        const std::array<uint8_t, KEY_SIZE>& privateKey,
+        const std::array<uint8_t, KEY_SIZE>& publicKey);
+
+    // Пакетный вариант: одно обращение поля на пачку (инверсия Монтгомери).
+    // privateKeys - один ключ на все publicKeys или по ключу на каждый.
+    // valid (если не пуст) получает флаг для каждого ключа, отвергнутые
+    // результаты обнуляются. Возвращает число вычисленных секретов
+    static size_t sharedSecrets(
+        const std::array<uint8_t, KEY_SIZE>& privateKey,
+        std::span<const std::array<uint8_t, KEY_SIZE>> publicKeys,
+        std::span<std::array<uint8_t, KEY_SIZE>> out,
+        std::span<bool> valid = {});
+    static size_t sharedSecrets(
+        std::span<const std::array<uint8_t, KEY_SIZE>> privateKeys,
+        std::span<const std::array<uint8_t, KEY_SIZE>> publicKeys,
+        std::span<std::array<uint8_t, KEY_SIZE>> out,
+        std::span<bool> valid = {});
+
     // Конвертация в/из Base64
     static std::string toBase64(const std::array<uint8_t, KEY_SIZE>& key);
     static std::optional<std::array<uint8_t, KEY_SIZE>> fromBase64(const std::string& base64);
 
+    // Без аллокаций: out - буфер минимум на KEY_BASE64_SIZE символов (без '\0')
+    static void toBase64(const std::array<uint8_t, KEY_SIZE>& key, char* out);
+
+    // Строгая проверка: ровно 44 символа, '=' только в конце, нулевые
+    // неиспользуемые биты. При ошибке out не изменяется
+    static bool fromBase64(std::string_view base64, std::array<uint8_t, KEY_SIZE>& out);
+
+    // Пакетное декодирование; valid (если не пуст) получает флаг для каждого ключа,
+    // невалидные ключи в out обнуляются. Возвращает число успешно декодированных
+    static size_t fromBase64(std::span<const std::string_view> base64,
+                             std::span<std::array<uint8_t, KEY_SIZE>> out,
+                             std::span<bool> valid = {});
+
+    // Затирание секретов, которое компилятор не может удалить как "мёртвую" запись
+    static void secureZero(void* data, size_t size);
+    static void secureZero(KeyPair& keyPair) { secureZero(&keyPair, sizeof(keyPair)); }
+
 private:
     // Clamp private key согласно Curve25519 спецификации
     static void clampPrivateKey(std::array<uint8_t, KEY_SIZE>& key);
 
-    // Curve25519 scalar multiplication
-    static void curve25519ScalarMult(
-        std::array<uint8_t, KEY_SIZE>& result,
-        const std::array<uint8_t, KEY_SIZE>& scalar,
-        const std::array<uint8_t, KEY_SIZE>& point);
+    // Заполнение буфера из CSPRNG ОС (getrandom/arc4random_buf/BCryptGenRandom)
+    static bool fillRandom(uint8_t* buffer, size_t length);
 
-    // Базовая точка Curve25519 (9)
-    static constexpr std::array<uint8_t, KEY_SIZE> BASE_POINT = {9};
+    // Вычисление публичных ключей для уже заполненных приватных
+    static void derivePublicKeys(std::span<KeyPair> pairs);
+
+    // Умножение базовой точки через предвычисленную таблицу на кривой Эдвардса
+    static void curve25519ScalarMultBase(
+        std::array<uint8_t, KEY_SIZE>& result,
+        const std::array<uint8_t, KEY_SIZE>& scalar);
 };
 
 } // namespace obsidian
@@ -0,0 +1,722 @@
+#include "MockServer.h"
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QJsonArray>
+#include <QRandomGenerator>
+#include <QSet>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+#include <QUuid>
+#include <algorithm>
+#include <iterator>
+
+namespace obsidian {
+
+namespace {
+
+constexpr qsizetype MAX_HEADER_SIZE = 64 * 1024;
+
+const QString PEERS_PATH = QStringLiteral("/api/vpn/peers");
+
+QByteArray statusText(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 410: return "Gone";
+    case 500: return "Internal Server Error";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+    }
+}
+
+QByteArray randomBytes(int size) {
+    QByteArray bytes(size, Qt::Uninitialized);
+    for (char& byte : bytes) {
+        byte = static_cast<char>(QRandomGenerator::global()->bounded(256));
+    }
+    return bytes;
+}
+
+QByteArray base64Url(const QByteArray& data) {
+    return data.toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals);
+}
+
+// JWT-shaped, so that ApiClient schedules the refresh from "exp" and "iat"
+QByteArray makeAccessToken(const QString& username, qint64 issuedAt, qint64 expiresAt) {
+    QJsonObject payload;
+    payload["sub"] = username;
+    payload["iat"] = issuedAt;
+    payload["exp"] = expiresAt;
+    return base64Url(R"({"alg":"HS256","typ":"JWT"})") + '.'
+         + base64Url(QJsonDocument(payload).toJson(QJsonDocument::Compact)) + '.'
+         + base64Url(randomBytes(32));
+}
+
+} // anonymous namespace
+
+MockServer::MockServer(const Options& options, QObject* parent)
+    : QObject(parent)
+    , m_options(options)
+    , m_serverPublicKey(QString::fromLatin1(randomBytes(32).toBase64()))
+{
+}
+
+MockServer::~MockServer() = default;
+
+bool MockServer::listen(const QHostAddress& address, quint16 port) {
+    if (!m_server) {
+        m_server = new QTcpServer(this);
+        connect(m_server, &QTcpServer::newConnection, this, &MockServer::acceptConnections);
+
+        m_purgeTimer = new QTimer(this);
+        m_purgeTimer->setTimerType(Qt::VeryCoarseTimer);
+        connect(m_purgeTimer, &QTimer::timeout, this, &MockServer::purgeExpiredTokens);
+        m_purgeTimer->start(60 * 1000);
+    }
+    return m_server->listen(address, port);
+}
+
+quint16 MockServer::serverPort() const {
+    return m_server ? m_server->serverPort() : 0;
+}
+
+void MockServer::injectFaults(const QString& pathPrefix, int count, Fault fault, int status) {
+    if (count > 0) {
+        m_faults.append(ScriptedFault{pathPrefix, count, fault, status});
+    }
+}
+
+std::optional<MockServer::ScriptedFault> MockServer::takeScriptedFault(const QString& path) {
+    for (qsizetype i = 0; i < m_faults.size(); ++i) {
+        ScriptedFault& script = m_faults[i];
+        if (!path.startsWith(script.pathPrefix)) {
+            continue;
+        }
+        const ScriptedFault taken = script;
+        if (--script.remaining == 0) {
+            m_faults.removeAt(i);
+        }
+        return taken;
+    }
+    return std::nullopt;
+}
+
+qint64 MockServer::requestsReceived(const QString& pathPrefix) const {
+    qint64 count = 0;
+    for (auto it = m_received.cbegin(); it != m_received.cend(); ++it) {
+        if (it.key().startsWith(pathPrefix)) {
+            count += it.value();
+        }
+    }
+    return count;
+}
+
+qint64 MockServer::bytesSent(const QString& pathPrefix) const {
+    qint64 bytes = 0;
+    for (auto it = m_sent.cbegin(); it != m_sent.cend(); ++it) {
+        if (it.key().startsWith(pathPrefix)) {
+            bytes += it.value();
+        }
+    }
+    return bytes;
+}
+
+void MockServer::addCommandLineOptions(QCommandLineParser& parser) {
+    const Options defaults;
+    parser.addOptions({
+        {"latency", "Delay of every reply, ms.", "ms", QString::number(defaults.latencyMs)},
+        {"jitter", "Random +- variation of the delay, ms.", "ms", QString::number(defaults.jitterMs)},
+        {"error-rate", "Share of requests answered with 503 (0..1).", "rate", "0"},
+        {"drop-rate", "Share of requests answered with a connection reset (0..1).", "rate", "0"},
+        {"stall-rate", "Share of requests never answered (0..1).", "rate", "0"},
+        {"peers", "Synthetic peers of every new account.", "count", QString::number(defaults.peersPerUser)},
+        {"token-ttl", "Access token lifetime, s.", "seconds", QString::number(defaults.tokenTtl)},
+        {"change-log", "Peer changes kept for /changes; older revisions get 410.", "count",
+         QString::number(defaults.changeLogSize)},
+        {"no-bulk", "Answer 404 on /api/vpn/peers/bulk and /bulk-delete."},
+        {"no-changes", "Answer 404 on /api/vpn/peers/changes."},
+    });
+}
+
+MockServer::Options MockServer::optionsFromCommandLine(const QCommandLineParser& parser) {
+    Options options;
+    options.latencyMs = qMax(0, parser.value("latency").toInt());
+    options.jitterMs = qMax(0, parser.value("jitter").toInt());
+    options.errorRate = std::clamp(parser.value("error-rate").toDouble(), 0.0, 1.0);
+    options.dropRate = std::clamp(parser.value("drop-rate").toDouble(), 0.0, 1.0);
+    options.stallRate = std::clamp(parser.value("stall-rate").toDouble(), 0.0, 1.0);
+    options.peersPerUser = qMax(0, parser.value("peers").toInt());
+    options.tokenTtl = qMax(1, parser.value("token-ttl").toInt());
+    options.changeLogSize = qMax(1, parser.value("change-log").toInt());
+    options.bulkEndpoints = !parser.isSet("no-bulk");
+    options.changesEndpoint = !parser.isSet("no-changes");
+    return options;
+}
+
+void MockServer::acceptConnections() {
+    while (QTcpSocket* socket = m_server->nextPendingConnection()) {
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        m_connections.insert(socket, Connection{});
+
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            const auto it = m_connections.find(socket);
+            if (it != m_connections.end()) {
+                it->buffer.append(socket->readAll());
+                processNext(socket);
+            }
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_connections.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void MockServer::processNext(QTcpSocket* socket) {
+    const auto it = m_connections.find(socket);
+    if (it == m_connections.end() || it->busy) {
+        return;
+    }
+
+    QByteArray& buffer = it->buffer;
+    const qsizetype headerEnd = buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        if (buffer.size() > MAX_HEADER_SIZE) {
+            socket->abort();
+        }
+        return;
+    }
+
+    const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+    const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if (requestLine.size() != 3) {
+        socket->abort();
+        return;
+    }
+
+    Request request;
+    request.method = requestLine[0];
+    const QUrl target(QString::fromLatin1(requestLine[1]));
+    request.path = target.path();
+    request.query = QUrlQuery(target);
+    for (qsizetype i = 1; i < lines.size(); ++i) {
+        const qsizetype colon = lines[i].indexOf(':');
+        if (colon > 0) {
+            request.headers.insert(lines[i].left(colon).trimmed().toLower(), lines[i].mid(colon + 1).trimmed());
+        }
+    }
+
+    const qsizetype bodySize = request.headers.value("content-length").toLongLong();
+    if (bodySize < 0) {
+        socket->abort();
+        return;
+    }
+    if (buffer.size() < headerEnd + 4 + bodySize) {
+        return;     // body not complete yet
+    }
+    request.body = buffer.mid(headerEnd + 4, bodySize);
+    buffer.remove(0, headerEnd + 4 + bodySize);
+    it->busy = true;
+
+    const bool keepAlive = request.headers.value("connection").toLower() != "close";
+    ++m_received[request.path];
+
+    // Injected faults, scripted ones first; a failed request does not
+    // change any state
+    bool stall = false;
+    bool drop = false;
+    int failStatus = 0;
+    if (const std::optional<ScriptedFault> script = takeScriptedFault(request.path)) {
+        stall = script->fault == Fault::Stall;
+        drop = script->fault == Fault::Reset;
+        failStatus = script->fault == Fault::Error ? script->status : 0;
+    } else {
+        const double roll = QRandomGenerator::global()->generateDouble();
+        stall = roll < m_options.stallRate;
+        drop = !stall && roll < m_options.stallRate + m_options.dropRate;
+        if (!stall && !drop && roll < m_options.stallRate + m_options.dropRate + m_options.errorRate) {
+            failStatus = 503;
+        }
+    }
+    if (stall) {
+        return;     // stays busy until the client gives up
+    }
+    const Response response = drop ? Response{}
+                            : failStatus ? error(failStatus, "Injected failure")
+                            : handle(request);
+
+    const auto reply = [this, socket, path = request.path, response, keepAlive, drop]() {
+        if (drop) {
+            socket->abort();
+        } else {
+            writeResponse(socket, path, response, keepAlive);
+        }
+    };
+
+    const int delay = replyDelayMs();
+    if (delay > 0) {
+        QTimer::singleShot(delay, socket, reply);
+    } else {
+        reply();
+    }
+}
+
+void MockServer::writeResponse(QTcpSocket* socket, const QString& path, const Response& response,
+                               bool keepAlive)
+{
+    QByteArray head = "HTTP/1.1 " + QByteArray::number(response.status) + ' '
+                    + statusText(response.status) + "\r\n";
+    // 204 and 304 carry no body
+    if (response.status != 204 && response.status != 304) {
+        head += "Content-Type: " + response.contentType + "\r\n";
+        head += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+    }
+    for (const auto& [name, value] : response.headers) {
+        head += name + ": " + value + "\r\n";
+    }
+    if (!keepAlive) {
+        head += "Connection: close\r\n";
+    }
+    head += "\r\n";
+
+    socket->write(head);
+    socket->write(response.body);
+    m_sent[path] += head.size() + response.body.size();
+    m_requestsServed.fetch_add(1, std::memory_order_relaxed);
+
+    if (!keepAlive) {
+        socket->disconnectFromHost();
+        return;
+    }
+
+    const auto it = m_connections.find(socket);
+    if (it != m_connections.end()) {
+        it->busy = false;
+        processNext(socket);    // a pipelined request may be waiting
+    }
+}
+
+int MockServer::replyDelayMs() const {
+    if (m_options.jitterMs <= 0) {
+        return m_options.latencyMs;
+    }
+    const int offset = QRandomGenerator::global()->bounded(-m_options.jitterMs, m_options.jitterMs + 1);
+    return qMax(0, m_options.latencyMs + offset);
+}
+
+MockServer::Response MockServer::json(int status, const QJsonDocument& document) {
+    Response response;
+    response.status = status;
+    response.body = document.toJson(QJsonDocument::Compact);
+    return response;
+}
+
+MockServer::Response MockServer::error(int status, const QString& message) {
+    return json(status, QJsonDocument(QJsonObject{{"error", message}}));
+}
+
+MockServer::Response MockServer::handle(const Request& request) {
+    const QString& path = request.path;
+
+    if (path.startsWith(QLatin1String("/api/auth/"))) {
+        if (request.method != "POST") {
+            return error(405, "Method not allowed");
+        }
+        const QJsonObject body = QJsonDocument::fromJson(request.body).object();
+        if (path == QLatin1String("/api/auth/login")) {
+            return login(body);
+        }
+        if (path == QLatin1String("/api/auth/register")) {
+            return registerUser(body);
+        }
+        if (path == QLatin1String("/api/auth/refresh")) {
+            return refresh(body);
+        }
+        return error(404, "Not found");
+    }
+
+    if (path != PEERS_PATH && !path.startsWith(PEERS_PATH + QLatin1Char('/'))) {
+        return error(404, "Not found");
+    }
+
+    Response denied;
+    Account* account = authenticate(request, denied);
+    if (!account) {
+        return denied;
+    }
+
+    const QStringList segments = path.mid(PEERS_PATH.size()).split(u'/', Qt::SkipEmptyParts);
+    const QJsonObject body = QJsonDocument::fromJson(request.body).object();
+
+    // /api/vpn/peers
+    if (segments.isEmpty()) {
+        if (request.method == "GET") {
+            return listPeers(*account, request);
+        }
+        if (request.method == "POST") {
+            return createPeer(*account, body);
+        }
+        return error(405, "Method not allowed");
+    }
+
+    // /api/vpn/peers/changes, /bulk, /bulk-delete, /{id}
+    if (segments.size() == 1) {
+        const QString& name = segments[0];
+        if (name == QLatin1String("changes")) {
+            if (!m_options.changesEndpoint) {
+                return error(404, "Not found");
+            }
+            return request.method == "GET" ? peerChanges(*account, request) : error(405, "Method not allowed");
+        }
+        if (name == QLatin1String("bulk") || name == QLatin1String("bulk-delete")) {
+            if (!m_options.bulkEndpoints) {
+                return error(404, "Not found");
+            }
+            if (request.method != "POST") {
+                return error(405, "Method not allowed");
+            }
+            return name == QLatin1String("bulk") ? bulkCreate(*account, body) : bulkDelete(*account, body);
+        }
+        return request.method == "DELETE" ? deletePeer(*account, name) : error(405, "Method not allowed");
+    }
+
+    // /api/vpn/peers/{id}/config
+    if (segments.size() == 2 && segments[1] == QLatin1String("config")) {
+        return request.method == "GET" ? peerConfig(*account, request, segments[0])
+                                       : error(405, "Method not allowed");
+    }
+
+    return error(404, "Not found");
+}
+
+MockServer::Account* MockServer::authenticate(const Request& request, Response& denied) {
+    const QByteArray authorization = request.headers.value("authorization");
+    const auto session = authorization.startsWith("Bearer ")
+        ? m_accessTokens.constFind(authorization.mid(7))
+        : m_accessTokens.constEnd();
+
+    if (session == m_accessTokens.constEnd()) {
+        denied = error(401, "Invalid token");
+        return nullptr;
+    }
+    if (session->expiresAt <= QDateTime::currentSecsSinceEpoch()) {
+        denied = error(401, "Token expired");
+        return nullptr;
+    }
+
+    const auto account = m_accounts.find(session->username);
+    if (account == m_accounts.end()) {
+        denied = error(401, "Invalid token");
+        return nullptr;
+    }
+    return &account.value();
+}
+
+MockServer::Response MockServer::login(const QJsonObject& body) {
+    const QString username = body.value(QLatin1String("username")).toString();
+    const QString password = body.value(QLatin1String("password")).toString();
+    if (username.isEmpty()) {
+        return error(400, "username is required");
+    }
+
+    // Unknown users are registered on the fly: load clients need no setup
+    const auto account = m_accounts.constFind(username);
+    if (account == m_accounts.constEnd()) {
+        createAccount(username, password);
+    } else if (account->password != password) {
+        return error(401, "Invalid credentials");
+    }
+
+    return json(200, QJsonDocument(issueTokens(username)));
+}
+
+MockServer::Response MockServer::registerUser(const QJsonObject& body) {
+    const QString username = body.value(QLatin1String("username")).toString();
+    const QString password = body.value(QLatin1String("password")).toString();
+    if (username.isEmpty() || password.isEmpty()) {
+        return error(400, "username and password are required");
+    }
+    if (m_accounts.contains(username)) {
+        return error(409, "User already exists");
+    }
+
+    createAccount(username, password);
+    return json(201, QJsonDocument(QJsonObject{{"message", "User registered"}}));
+}
+
+MockServer::Response MockServer::refresh(const QJsonObject& body) {
+    const QByteArray token = body.value(QLatin1String("refresh_token")).toString().toLatin1();
+    const auto it = m_refreshTokens.find(token);
+    if (it == m_refreshTokens.end()) {
+        return error(401, "Invalid refresh token");
+    }
+
+    // Refresh tokens are single use, the reply carries the next one
+    const QString username = it.value();
+    m_refreshTokens.erase(it);
+    return json(200, QJsonDocument(issueTokens(username)));
+}
+
+QJsonObject MockServer::issueTokens(const QString& username) {
+    const qint64 issuedAt = QDateTime::currentSecsSinceEpoch();
+    const qint64 expiresAt = issuedAt + m_options.tokenTtl;
+    const QByteArray accessToken = makeAccessToken(username, issuedAt, expiresAt);
+    const QByteArray refreshToken = base64Url(randomBytes(32));
+
+    m_accessTokens.insert(accessToken, Session{username, expiresAt});
+    m_refreshTokens.insert(refreshToken, username);
+
+    QJsonObject tokens;
+    tokens["access_token"] = QString::fromLatin1(accessToken);
+    tokens["refresh_token"] = QString::fromLatin1(refreshToken);
+    tokens["expires_in"] = m_options.tokenTtl;
+    return tokens;
+}
+
+void MockServer::purgeExpiredTokens() {
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    for (auto it = m_accessTokens.begin(); it != m_accessTokens.end();) {
+        it = it->expiresAt <= now ? m_accessTokens.erase(it) : std::next(it);
+    }
+}
+
+MockServer::Response MockServer::listPeers(Account& account, const Request& request) {
+    const int limit = request.query.queryItemValue(QStringLiteral("limit")).toInt();
+    if (limit > 0) {
+        // Keyset pagination: the cursor is the sequence of the page's first peer
+        auto it = account.peers.lowerBound(request.query.queryItemValue(QStringLiteral("cursor")).toULongLong());
+        QJsonArray page;
+        for (; it != account.peers.end() && page.size() < limit; ++it) {
+            page.append(peerJson(*it));
+        }
+
+        Response response = json(200, QJsonDocument(page));
+        if (it != account.peers.end()) {
+            response.headers.emplaceBack("X-Next-Cursor", QByteArray::number(it.key()));
+        }
+        return response;
+    }
+
+    const QByteArray etag = "\"r" + QByteArray::number(account.revision) + '"';
+    Response response;
+    response.headers.emplaceBack("ETag", etag);
+    if (request.headers.value("if-none-match") == etag) {
+        response.status = 304;
+        return response;
+    }
+
+    // Serialized once per revision: most clients ask for an unchanged list
+    if (account.listRevision != account.revision) {
+        QJsonArray peers;
+        for (const Peer& peer : std::as_const(account.peers)) {
+            peers.append(peerJson(peer));
+        }
+        account.listBody = QJsonDocument(peers).toJson(QJsonDocument::Compact);
+        account.listRevision = account.revision;
+    }
+    response.body = account.listBody;
+    return response;
+}
+
+MockServer::Response MockServer::peerChanges(Account& account, const Request& request) {
+    const QString since = request.query.queryItemValue(QStringLiteral("since"));
+    QJsonArray peers;
+    QJsonArray deleted;
+
+    if (since.isEmpty()) {
+        for (const Peer& peer : std::as_const(account.peers)) {
+            peers.append(peerJson(peer));
+        }
+    } else {
+        bool ok = false;
+        const quint64 revision = since.toULongLong(&ok);
+        // Trimmed from the change log, or not ours (e.g. from before a restart)
+        if (!ok || revision < account.oldestRevision || revision > account.revision) {
+            return error(410, "Revision expired");
+        }
+
+        const auto first = std::upper_bound(account.changes.cbegin(), account.changes.cend(), revision,
+            [](quint64 value, const std::pair<quint64, QString>& change) { return value < change.first; });
+
+        // Newest first, so that every peer is reported once, in its final state
+        QSet<QString> seen;
+        for (auto it = account.changes.cend(); it != first;) {
+            --it;
+            if (seen.contains(it->second)) {
+                continue;
+            }
+            seen.insert(it->second);
+
+            const auto sequence = account.index.constFind(it->second);
+            if (sequence == account.index.constEnd()) {
+                deleted.append(it->second);
+            } else {
+                peers.append(peerJson(account.peers.value(*sequence)));
+            }
+        }
+    }
+
+    QJsonObject result;
+    result["revision"] = QString::number(account.revision);
+    result["full"] = since.isEmpty();
+    result["peers"] = peers;
+    result["deleted"] = deleted;
+    return json(200, QJsonDocument(result));
+}
+
+MockServer::Response MockServer::createPeer(Account& account, const QJsonObject& body) {
+    const QString deviceName = body.value(QLatin1String("device_name")).toString();
+    const QString publicKey = body.value(QLatin1String("public_key")).toString();
+    if (deviceName.isEmpty() || publicKey.isEmpty()) {
+        return error(400, "device_name and public_key are required");
+    }
+    return json(201, QJsonDocument(createdPeerJson(addPeer(account, deviceName, publicKey))));
+}
+
+MockServer::Response MockServer::deletePeer(Account& account, const QString& peerId) {
+    if (!removePeer(account, peerId)) {
+        return error(404, "Peer not found");
+    }
+    Response response;
+    response.status = 204;
+    return response;
+}
+
+MockServer::Response MockServer::peerConfig(Account& account, const Request& request, const QString& peerId) {
+    const auto sequence = account.index.constFind(peerId);
+    if (sequence == account.index.constEnd()) {
+        return error(404, "Peer not found");
+    }
+
+    // The config of a peer never changes: its sequence is a stable validator
+    const QByteArray etag = "\"c" + QByteArray::number(*sequence) + '"';
+    Response response;
+    response.headers.emplaceBack("ETag", etag);
+    if (request.headers.value("if-none-match") == etag) {
+        response.status = 304;
+        return response;
+    }
+
+    response.contentType = QByteArrayLiteral("text/plain; charset=utf-8");
+    response.body = peerConfigText(account.peers.value(*sequence)).toUtf8();
+    return response;
+}
+
+MockServer::Response MockServer::bulkCreate(Account& account, const QJsonObject& body) {
+    QJsonArray results;
+    for (const QJsonValue& item : body.value(QLatin1String("peers")).toArray()) {
+        const QJsonObject device = item.toObject();
+        const QString deviceName = device.value(QLatin1String("device_name")).toString();
+        const QString publicKey = device.value(QLatin1String("public_key")).toString();
+        if (deviceName.isEmpty() || publicKey.isEmpty()) {
+            results.append(QJsonObject{{"error", "device_name and public_key are required"}});
+        } else {
+            results.append(createdPeerJson(addPeer(account, deviceName, publicKey)));
+        }
+    }
+    return json(200, QJsonDocument(QJsonObject{{"results", results}}));
+}
+
+MockServer::Response MockServer::bulkDelete(Account& account, const QJsonObject& body) {
+    QJsonArray results;
+    for (const QJsonValue& id : body.value(QLatin1String("ids")).toArray()) {
+        results.append(removePeer(account, id.toString()) ? QJsonObject()
+                                                          : QJsonObject{{"error", "Peer not found"}});
+    }
+    return json(200, QJsonDocument(QJsonObject{{"results", results}}));
+}
+
+MockServer::Account& MockServer::createAccount(const QString& username, const QString& password) {
+    Account& account = m_accounts[username];
+    account.password = password;
+    for (int i = 0; i < m_options.peersPerUser; ++i) {
+        addPeer(account, QStringLiteral("device-%1").arg(i + 1), QString::fromLatin1(randomBytes(32).toBase64()));
+    }
+
+    // Synthetic peers predate every revision a client can hold
+    account.changes.clear();
+    account.oldestRevision = account.revision;
+    return account;
+}
+
+const MockServer::Peer& MockServer::addPeer(Account& account, const QString& deviceName,
+                                            const QString& publicKey)
+{
+    const quint64 sequence = account.nextSequence++;
+
+    Peer peer;
+    peer.id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    peer.deviceName = deviceName;
+    peer.ipAddress = QStringLiteral("10.%1.%2.%3/32")
+        .arg((sequence >> 16) & 0xff).arg((sequence >> 8) & 0xff).arg(sequence & 0xff);
+    peer.publicKey = publicKey;
+    peer.isActive = sequence % 3 != 0;
+
+    account.index.insert(peer.id, sequence);
+    recordChange(account, peer.id);
+    return *account.peers.insert(sequence, peer);
+}
+
+bool MockServer::removePeer(Account& account, const QString& peerId) {
+    const auto it = account.index.constFind(peerId);
+    if (it == account.index.constEnd()) {
+        return false;
+    }
+    account.peers.remove(*it);
+    account.index.erase(it);
+    recordChange(account, peerId);
+    return true;
+}
+
+void MockServer::recordChange(Account& account, const QString& peerId) {
+    account.changes.emplace_back(++account.revision, peerId);
+    while (account.changes.size() > static_cast<size_t>(m_options.changeLogSize)) {
+        account.oldestRevision = account.changes.front().first;
+        account.changes.pop_front();
+    }
+}
+
+QJsonObject MockServer::peerJson(const Peer& peer) {
+    QJsonObject obj;
+    obj["id"] = peer.id;
+    obj["device_name"] = peer.deviceName;
+    obj["protocol"] = "wireguard";
+    obj["wg_ip_address"] = peer.ipAddress;
+    obj["wg_public_key"] = peer.publicKey;
+    obj["is_active"] = peer.isActive;
+    return obj;
+}
+
+QJsonObject MockServer::createdPeerJson(const Peer& peer) const {
+    QJsonObject obj;
+    obj["peer"] = peerJson(peer);
+    obj["config"] = peerConfigText(peer);
+    return obj;
+}
+
+// Same shape as the real server: the client substitutes its private key
+QString MockServer::peerConfigText(const Peer& peer) const {
+    return QStringLiteral(
+        "[Interface]\n"
+        "PrivateKey = <ВСТАВЬТЕ_ВАШ_ПРИВАТНЫЙ_КЛЮЧ>\n"
+        "Address = %1\n"
+        "DNS = 1.1.1.1\n"
+        "\n"
+        "[Peer]\n"
+        "PublicKey = %2\n"
+        "AllowedIPs = 0.0.0.0/0, ::/0\n"
+        "Endpoint = 127.0.0.1:51820\n"
+        "PersistentKeepalive = 25\n").arg(peer.ipAddress, m_serverPublicKey);
+}
+
+} // namespace obsidian
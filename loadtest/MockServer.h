@@ -0,0 +1,187 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QUrlQuery>
+#include <atomic>
+#include <deque>
+#include <optional>
+#include <utility>
+
+class QCommandLineParser;
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+
+namespace obsidian {
+
+// In-memory stand-in for the Obsidian API (/api/auth/*, /api/vpn/peers*)
+// for load and latency testing of ApiClient without a real backend.
+// HTTP/1.1 with keep-alive over QTcpServer, one request per connection at a
+// time. Every reply can be delayed, failed, withheld or replaced by a
+// connection reset according to Options, or by faults scripted for the next
+// requests of a path (injectFaults)
+class MockServer : public QObject {
+    Q_OBJECT
+
+public:
+    struct Options {
+        int latencyMs = 0;          // added to every reply
+        int jitterMs = 0;           // latency varies uniformly by +-jitterMs
+        double errorRate = 0.0;     // share of requests answered with 503
+        double dropRate = 0.0;      // share of requests answered with a connection reset
+        double stallRate = 0.0;     // share of requests never answered
+        int peersPerUser = 10;      // synthetic peers of a new account
+        int tokenTtl = 900;         // access token lifetime, seconds
+        int changeLogSize = 10000;  // changes kept for /changes; older revisions get 410
+        bool bulkEndpoints = true;  // false: /bulk and /bulk-delete answer 404
+        bool changesEndpoint = true;
+    };
+
+    enum class Fault {
+        Error,      // answered with the given status
+        Reset,      // connection reset
+        Stall       // never answered
+    };
+
+    explicit MockServer(const Options& options, QObject* parent = nullptr);
+    ~MockServer() override;
+
+    // The next `count` requests whose path starts with pathPrefix get the
+    // fault instead of their reply, ahead of the random rates. Scripts are
+    // used in the order they were added
+    void injectFaults(const QString& pathPrefix, int count, Fault fault, int status = 503);
+    void clearFaults() { m_faults.clear(); }
+
+    // Requests received so far whose path starts with pathPrefix, faulted
+    // ones included
+    qint64 requestsReceived(const QString& pathPrefix) const;
+
+    // Bytes of HTTP replies (head and body) written so far for requests
+    // whose path starts with pathPrefix
+    qint64 bytesSent(const QString& pathPrefix) const;
+
+    // Port 0 picks a free one, see serverPort()
+    bool listen(const QHostAddress& address = QHostAddress::LocalHost, quint16 port = 0);
+    quint16 serverPort() const;
+
+    // HTTP replies written so far; safe to read from any thread
+    qint64 requestsServed() const { return m_requestsServed.load(std::memory_order_relaxed); }
+
+    // Command line options shared by obsidian_mock_server and obsidian_load
+    static void addCommandLineOptions(QCommandLineParser& parser);
+    static Options optionsFromCommandLine(const QCommandLineParser& parser);
+
+private:
+    struct Request {
+        QByteArray method;
+        QString path;
+        QUrlQuery query;
+        QHash<QByteArray, QByteArray> headers;   // lower-case names
+        QByteArray body;
+    };
+
+    struct Response {
+        int status = 200;
+        QByteArray contentType = QByteArrayLiteral("application/json");
+        QByteArray body;
+        QList<std::pair<QByteArray, QByteArray>> headers;
+    };
+
+    struct Peer {
+        QString id;
+        QString deviceName;
+        QString ipAddress;
+        QString publicKey;
+        bool isActive = true;
+    };
+
+    struct Account {
+        QString password;
+        QMap<quint64, Peer> peers;              // by creation sequence: server order
+        QHash<QString, quint64> index;          // peer id -> sequence
+        quint64 nextSequence = 1;
+        quint64 revision = 1;
+        quint64 oldestRevision = 1;             // /changes answers since >= this
+        std::deque<std::pair<quint64, QString>> changes;   // (revision, peer id)
+        QByteArray listBody;                    // serialized list of listRevision
+        quint64 listRevision = 0;
+    };
+
+    struct Session {
+        QString username;
+        qint64 expiresAt = 0;
+    };
+
+    struct Connection {
+        QByteArray buffer;
+        bool busy = false;      // a reply is pending; later requests wait
+    };
+
+    struct ScriptedFault {
+        QString pathPrefix;
+        int remaining = 0;
+        Fault fault = Fault::Error;
+        int status = 503;
+    };
+
+    // Takes one use of the first script matching the path
+    std::optional<ScriptedFault> takeScriptedFault(const QString& path);
+
+    void acceptConnections();
+    void processNext(QTcpSocket* socket);
+    void writeResponse(QTcpSocket* socket, const QString& path, const Response& response, bool keepAlive);
+    int replyDelayMs() const;
+
+    static Response json(int status, const QJsonDocument& document);
+    static Response error(int status, const QString& message);
+
+    Response handle(const Request& request);
+    Account* authenticate(const Request& request, Response& denied);
+
+    Response login(const QJsonObject& body);
+    Response registerUser(const QJsonObject& body);
+    Response refresh(const QJsonObject& body);
+    QJsonObject issueTokens(const QString& username);
+    void purgeExpiredTokens();
+
+    Response listPeers(Account& account, const Request& request);
+    Response peerChanges(Account& account, const Request& request);
+    Response createPeer(Account& account, const QJsonObject& body);
+    Response deletePeer(Account& account, const QString& peerId);
+    Response peerConfig(Account& account, const Request& request, const QString& peerId);
+    Response bulkCreate(Account& account, const QJsonObject& body);
+    Response bulkDelete(Account& account, const QJsonObject& body);
+
+    Account& createAccount(const QString& username, const QString& password);
+    const Peer& addPeer(Account& account, const QString& deviceName, const QString& publicKey);
+    bool removePeer(Account& account, const QString& peerId);
+    void recordChange(Account& account, const QString& peerId);
+    static QJsonObject peerJson(const Peer& peer);
+    QJsonObject createdPeerJson(const Peer& peer) const;
+    QString peerConfigText(const Peer& peer) const;
+
+    Options m_options;
+    QTcpServer* m_server = nullptr;
+    QTimer* m_purgeTimer = nullptr;
+    QHash<QTcpSocket*, Connection> m_connections;
+    QList<ScriptedFault> m_faults;
+    QHash<QString, qint64> m_received;          // by path
+    QHash<QString, qint64> m_sent;              // reply bytes by path
+
+    QHash<QString, Account> m_accounts;         // by username
+    QHash<QByteArray, Session> m_accessTokens;
+    QHash<QByteArray, QString> m_refreshTokens; // -> username
+    QString m_serverPublicKey;
+
+    std::atomic<qint64> m_requestsServed{0};
+};
+
+} // namespace obsidian
@@ -0,0 +1,547 @@
+// Нагрузочный прогон ApiClient: много клиентов одновременно против API.
+//
+//   ./obsidian_load --clients 100 --duration 30 --peers 1000 --latency 50 --jitter 20
+//   ./obsidian_load --server http://127.0.0.1:8081 --clients 20
+//
+// Без --server поднимает MockServer в отдельном потоке с параметрами
+// obsidian_mock_server. Каждый клиент входит под своим пользователем и по
+// кругу выполняет сценарий приложения; в конце печатаются запросы в секунду
+// и p50/p99 задержки по эндпоинтам, как их видит вызывающий код (с
+// повторами, кэшем и обновлением токена внутри ApiClient).
+//
+// --background N держит у каждого клиента N фоновых bulk-удалений рядом со
+// сценарием: так видно, обгоняют ли интерактивные запросы фоновую работу.
+//
+// --cold-start N вместо нагрузки N раз запускает свежий ApiClient и входит
+// один раз, для каждого режима HTTP/2 (умолчание Qt, выключен, а для https
+// и включён) с прогревом соединения и без него, и печатает p50/p90 времени
+// до первого байта. Вход идёт через --start-gap мс после setServerUrl.
+// С --tls-sessions FILE для https каждая строка снимается дважды: с пустым
+// кэшем TLS-сессий (полное рукопожатие) и с билетом от предыдущего запуска
+// (возобновление), как между запусками приложения. --ca-cert добавляет
+// сертификат локального стенда к доверенным.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QSslCertificate>
+#include <QSslConfiguration>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+
+#include "ApiClient.h"
+#include "MockServer.h"
+#include "TlsSessionCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+using namespace obsidian;
+
+namespace {
+
+// Requests still in flight when the run ends get this long to finish
+constexpr int DRAIN_TIMEOUT_MS = 60 * 1000;
+
+// Ids per background bulk delete; none of them exists on the server
+constexpr int BACKGROUND_BATCH = 20;
+
+struct EndpointStats {
+    std::vector<qint64> latenciesUs;
+    int errors = 0;
+};
+using Stats = std::map<QString, EndpointStats>;
+
+enum class Step { Login, ListPeers, SyncPeers, PeerConfig, CreatePeer, DeletePeer, PagedList };
+
+// Repeated after login; steps without a peer to work on are skipped
+constexpr Step SCENARIO[] = {
+    Step::ListPeers, Step::SyncPeers, Step::PeerConfig, Step::CreatePeer,
+    Step::SyncPeers, Step::DeletePeer, Step::PagedList,
+};
+
+QString endpointName(Step step) {
+    switch (step) {
+    case Step::Login:      return QStringLiteral("POST /api/auth/login");
+    case Step::ListPeers:  return QStringLiteral("GET /api/vpn/peers");
+    case Step::SyncPeers:  return QStringLiteral("GET /api/vpn/peers/changes");
+    case Step::PeerConfig: return QStringLiteral("GET /api/vpn/peers/{id}/config");
+    case Step::CreatePeer: return QStringLiteral("POST /api/vpn/peers");
+    case Step::DeletePeer: return QStringLiteral("DELETE /api/vpn/peers/{id}");
+    case Step::PagedList:  return QStringLiteral("GET /api/vpn/peers (paged)");
+    }
+    return QString();
+}
+
+QString randomPublicKey() {
+    QByteArray key(32, Qt::Uninitialized);
+    for (char& byte : key) {
+        byte = static_cast<char>(QRandomGenerator::global()->bounded(256));
+    }
+    return QString::fromLatin1(key.toBase64());
+}
+
+// One application instance: its own ApiClient (and connection pool), one
+// request at a time
+class VirtualUser {
+public:
+    VirtualUser(const QString& serverUrl, const QString& username, int backgroundJobs, Stats& stats,
+                const bool& running, std::function<void()> onStopped)
+        : m_username(username)
+        , m_backgroundJobs(backgroundJobs)
+        , m_stats(stats)
+        , m_running(running)
+        , m_onStopped(std::move(onStopped))
+    {
+        m_client.setServerUrl(serverUrl);
+
+        QObject::connect(&m_client, &ApiClient::loginSuccess, &m_client, [this]() { finish(true); });
+        QObject::connect(&m_client, &ApiClient::loginError, &m_client, [this]() { finish(false); });
+        QObject::connect(&m_client, &ApiClient::peersLoaded, &m_client,
+                         [this](const QList<PeerInfo>& peers) {
+            m_knownPeerIds.clear();
+            for (const PeerInfo& peer : peers) {
+                m_knownPeerIds.append(peer.id);
+            }
+            finish(true);
+        });
+        QObject::connect(&m_client, &ApiClient::peersBatchLoaded, &m_client,
+                         [this](int, const QList<PeerInfo>&, bool last) {
+            if (last) {
+                finish(true);
+            }
+        });
+        QObject::connect(&m_client, &ApiClient::peersSynced, &m_client, [this]() { finish(true); });
+        QObject::connect(&m_client, &ApiClient::peerConfigLoaded, &m_client, [this]() { finish(true); });
+        QObject::connect(&m_client, &ApiClient::peerCreated, &m_client, [this](const PeerInfo& peer) {
+            m_createdPeerId = peer.id;
+            finish(true);
+        });
+        QObject::connect(&m_client, &ApiClient::peerCreateError, &m_client, [this]() { finish(false); });
+        QObject::connect(&m_client, &ApiClient::peerDeleted, &m_client, [this]() { finish(true); });
+        QObject::connect(&m_client, &ApiClient::apiError, &m_client, [this]() { finish(false); });
+        QObject::connect(&m_client, &ApiClient::bulkFinished, &m_client, [this](int bulkId) {
+            finishBackground(bulkId);
+        });
+    }
+
+    void start() { run(Step::Login); }
+
+private:
+    void run(Step step) {
+        m_step = step;
+        m_waiting = true;
+        m_timer.start();
+
+        switch (step) {
+        case Step::Login:
+            m_client.login(m_username, QStringLiteral("password"));
+            break;
+        case Step::ListPeers:
+            m_client.getPeers();
+            break;
+        case Step::SyncPeers:
+            m_client.syncPeers();
+            break;
+        case Step::PeerConfig:
+            m_client.getPeerConfig(m_knownPeerIds.at(
+                QRandomGenerator::global()->bounded(static_cast<int>(m_knownPeerIds.size()))));
+            break;
+        case Step::CreatePeer:
+            m_client.createPeer(QStringLiteral("load-%1").arg(++m_createdCount), randomPublicKey());
+            break;
+        case Step::DeletePeer:
+            m_client.deletePeer(std::exchange(m_createdPeerId, QString()));
+            break;
+        case Step::PagedList:
+            m_client.loadPeersPaged();
+            break;
+        }
+    }
+
+    void finish(bool ok) {
+        if (!m_waiting) {
+            return;
+        }
+        m_waiting = false;
+
+        EndpointStats& stats = m_stats[endpointName(m_step)];
+        stats.latenciesUs.push_back(m_timer.nsecsElapsed() / 1000);
+        if (!ok) {
+            ++stats.errors;
+        }
+
+        // Not from inside the ApiClient signal that delivered the result
+        QTimer::singleShot(0, &m_client, [this]() { next(); });
+    }
+
+    void runBackground() {
+        QStringList ids;
+        for (int i = 0; i < BACKGROUND_BATCH; ++i) {
+            ids.append(QStringLiteral("missing-%1").arg(i));
+        }
+        QElapsedTimer timer;
+        timer.start();
+        m_background.emplace(m_client.deletePeers(ids), timer);
+    }
+
+    void finishBackground(int bulkId) {
+        const auto job = m_background.find(bulkId);
+        if (job == m_background.end()) {
+            return;
+        }
+        m_stats[QStringLiteral("bulk delete (background)")].latenciesUs.push_back(job->second.nsecsElapsed() / 1000);
+        m_background.erase(job);
+
+        if (m_running) {
+            QTimer::singleShot(0, &m_client, [this]() { runBackground(); });
+        }
+    }
+
+    void next() {
+        if (!m_running) {
+            m_onStopped();
+            return;
+        }
+        if (!m_client.isAuthenticated()) {
+            run(Step::Login);
+            return;
+        }
+        if (!m_backgroundStarted) {
+            m_backgroundStarted = true;
+            for (int i = 0; i < m_backgroundJobs; ++i) {
+                runBackground();
+            }
+        }
+
+        for (;;) {
+            const Step step = SCENARIO[m_position++ % std::size(SCENARIO)];
+            if ((step == Step::PeerConfig && m_knownPeerIds.isEmpty())
+                || (step == Step::DeletePeer && m_createdPeerId.isEmpty())) {
+                continue;
+            }
+            run(step);
+            return;
+        }
+    }
+
+    ApiClient m_client;
+    QString m_username;
+    int m_backgroundJobs = 0;
+    Stats& m_stats;
+    const bool& m_running;
+    std::function<void()> m_onStopped;
+
+    Step m_step = Step::Login;
+    size_t m_position = 0;
+    bool m_waiting = false;
+    QElapsedTimer m_timer;
+    QStringList m_knownPeerIds;
+    QString m_createdPeerId;
+    int m_createdCount = 0;
+
+    bool m_backgroundStarted = false;
+    std::map<int, QElapsedTimer> m_background;  // by bulk id
+};
+
+double percentileMs(const std::vector<qint64>& sorted, double q) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    const auto rank = static_cast<size_t>(std::ceil(q * static_cast<double>(sorted.size())));
+    return static_cast<double>(sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1]) / 1000.0;
+}
+
+QString reportRow(const QString& name, const EndpointStats& stats, double seconds) {
+    std::vector<qint64> sorted = stats.latenciesUs;
+    std::sort(sorted.begin(), sorted.end());
+
+    return name.leftJustified(36)
+         + QString::number(sorted.size()).rightJustified(10)
+         + QString::number(stats.errors).rightJustified(8)
+         + QString::number(static_cast<double>(sorted.size()) / seconds, 'f', 1).rightJustified(10)
+         + QString::number(percentileMs(sorted, 0.50), 'f', 2).rightJustified(10)
+         + QString::number(percentileMs(sorted, 0.99), 'f', 2).rightJustified(10);
+}
+
+// Every run is a fresh ApiClient, so nothing is pooled yet. setServerUrl
+// pre-connects unless the warm-up is off; the login follows startGapMs
+// later, as it would once the login page is shown.
+//
+// With tlsSessionsPath every https row is taken twice: with the session
+// cache file removed before each run (full handshake) and with the ticket
+// the previous run left in it (resumed), as between two app launches
+int runColdStart(const QString& serverUrl, int runs, int startGapMs, const QString& tlsSessionsPath) {
+    struct Mode {
+        QString name;
+        std::optional<bool> http2;
+    };
+    std::vector<Mode> modes = {
+        {QStringLiteral("qt default"), std::nullopt},
+        {QStringLiteral("http2 off"), false},
+    };
+    const bool https = serverUrl.startsWith(QLatin1String("https:"));
+    // Plain http would need h2c, which the mock server does not speak
+    if (https) {
+        modes.push_back({QStringLiteral("http2 on"), true});
+    }
+
+    enum class Tls { None, Full, Resumed };
+    std::vector<Tls> tlsModes = {Tls::None};
+    if (https && !tlsSessionsPath.isEmpty()) {
+        tlsModes = {Tls::Full, Tls::Resumed};
+    }
+
+    QTextStream out(stdout);
+    out << runs << " cold starts per mode, login " << startGapMs << " ms after start, " << serverUrl << "\n\n";
+    out << QStringLiteral("mode").leftJustified(16)
+        << QStringLiteral("warm-up").rightJustified(8)
+        << QStringLiteral("tls").rightJustified(9)
+        << QStringLiteral("runs").rightJustified(8)
+        << QStringLiteral("errors").rightJustified(8)
+        << QStringLiteral("h2").rightJustified(6)
+        << QStringLiteral("p50 ms").rightJustified(10)
+        << QStringLiteral("p90 ms").rightJustified(10) << '\n';
+
+    struct Run {
+        bool loggedIn = false;
+        bool http2 = false;
+        std::optional<double> firstByteMs;
+    };
+
+    const auto coldStart = [&](const Mode& mode, bool warmUp, Tls tls, int index) {
+        if (tls == Tls::Full) {
+            QFile::remove(tlsSessionsPath);
+        }
+        // Declared before the client, which keeps a pointer to it
+        std::optional<TlsSessionCache> sessions;
+        if (tls != Tls::None) {
+            sessions.emplace(tlsSessionsPath);
+        }
+
+        ApiClient client;
+        client.setWarmUpEnabled(warmUp);
+        if (mode.http2) {
+            client.setHttp2Enabled(*mode.http2);
+        }
+        if (sessions) {
+            client.setTlsSessionCache(&*sessions);
+        }
+
+        Run run;
+        QEventLoop loop;
+        QObject::connect(&client, &ApiClient::firstByteTimeMeasured, &loop, [&](double ms, bool, bool http2) {
+            run.firstByteMs = ms;
+            run.http2 = http2;
+        });
+        QObject::connect(&client, &ApiClient::loginSuccess, &loop, [&]() {
+            run.loggedIn = true;
+            loop.quit();
+        });
+        QObject::connect(&client, &ApiClient::loginError, &loop, &QEventLoop::quit);
+        QTimer::singleShot(startGapMs + DRAIN_TIMEOUT_MS, &loop, &QEventLoop::quit);
+
+        client.setServerUrl(serverUrl);
+        QTimer::singleShot(startGapMs, &loop, [&client, index]() {
+            client.login(QStringLiteral("cold-start-%1").arg(index + 1), QStringLiteral("secret"));
+        });
+        loop.exec();
+        return run;
+    };
+
+    for (const Mode& mode : modes) {
+        for (const bool warmUp : {false, true}) {
+            for (const Tls tls : tlsModes) {
+                // The first resumed run needs a ticket from an earlier launch
+                if (tls == Tls::Resumed) {
+                    coldStart(mode, warmUp, Tls::Full, 0);
+                }
+
+                std::vector<qint64> firstByteUs;
+                int errors = 0;
+                int http2Used = 0;
+                for (int i = 0; i < runs; ++i) {
+                    const Run run = coldStart(mode, warmUp, tls, i);
+                    if (!run.loggedIn) {
+                        ++errors;
+                    }
+                    if (run.firstByteMs) {
+                        firstByteUs.push_back(std::llround(*run.firstByteMs * 1000.0));
+                        http2Used += run.http2 ? 1 : 0;
+                    }
+                }
+
+                const QString tlsName = tls == Tls::Full ? QStringLiteral("full")
+                                      : tls == Tls::Resumed ? QStringLiteral("resumed")
+                                      : QStringLiteral("-");
+                std::sort(firstByteUs.begin(), firstByteUs.end());
+                out << mode.name.leftJustified(16)
+                    << (warmUp ? QStringLiteral("on") : QStringLiteral("off")).rightJustified(8)
+                    << tlsName.rightJustified(9)
+                    << QString::number(runs).rightJustified(8)
+                    << QString::number(errors).rightJustified(8)
+                    << QString::number(http2Used).rightJustified(6)
+                    << QString::number(percentileMs(firstByteUs, 0.50), 'f', 2).rightJustified(10)
+                    << QString::number(percentileMs(firstByteUs, 0.90), 'f', 2).rightJustified(10) << '\n';
+                out.flush();
+            }
+        }
+    }
+    return 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("obsidian_load");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs concurrent ApiClient instances against the Obsidian API");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"server", "API server URL; without it a MockServer is started in-process.", "url"},
+        {"clients", "Concurrent ApiClient instances.", "count", "50"},
+        {"duration", "Length of the run, s.", "seconds", "10"},
+        {"shared-account", "Log every client in as the same user."},
+        {"background", "Background bulk deletes each client keeps in flight.", "count", "0"},
+        {"cold-start", "Only measure the time to first byte of this many cold starts per HTTP/2 and "
+         "warm-up mode.", "runs"},
+        {"start-gap", "Cold start: delay between setting the server and the login, ms.", "ms", "100"},
+        {"tls-sessions", "Cold start against https: compare full and resumed handshakes, keeping "
+         "tickets in this file.", "file"},
+        {"ca-cert", "Extra trusted CA certificate (PEM), e.g. of a local TLS server.", "file"},
+    });
+    MockServer::addCommandLineOptions(parser);
+    parser.process(app);
+
+    if (parser.isSet("ca-cert")) {
+        const QList<QSslCertificate> certificates = QSslCertificate::fromPath(parser.value("ca-cert"));
+        if (certificates.isEmpty()) {
+            QTextStream(stderr) << "Cannot read " << parser.value("ca-cert") << "\n";
+            return 1;
+        }
+        QSslConfiguration config = QSslConfiguration::defaultConfiguration();
+        config.addCaCertificates(certificates);
+        QSslConfiguration::setDefaultConfiguration(config);
+    }
+
+    const int clientCount = qMax(1, parser.value("clients").toInt());
+    const int durationMs = qMax(1, parser.value("duration").toInt()) * 1000;
+    const int backgroundJobs = qMax(0, parser.value("background").toInt());
+
+    // The in-process server gets its own thread, so serving does not
+    // compete with the clients for the event loop
+    QThread serverThread;
+    MockServer* server = nullptr;
+    QString serverUrl = parser.value("server");
+
+    if (serverUrl.isEmpty()) {
+        server = new MockServer(MockServer::optionsFromCommandLine(parser));
+        server->moveToThread(&serverThread);
+        QObject::connect(&serverThread, &QThread::finished, server, &QObject::deleteLater);
+        serverThread.start();
+
+        quint16 port = 0;
+        QMetaObject::invokeMethod(server, [server, &port]() {
+            if (server->listen()) {
+                port = server->serverPort();
+            }
+        }, Qt::BlockingQueuedConnection);
+
+        if (port == 0) {
+            QTextStream(stderr) << "Cannot start the mock server\n";
+            serverThread.quit();
+            serverThread.wait();
+            return 1;
+        }
+        serverUrl = QStringLiteral("http://127.0.0.1:%1").arg(port);
+    }
+
+    if (parser.isSet("cold-start")) {
+        const int result = runColdStart(serverUrl, qMax(1, parser.value("cold-start").toInt()),
+                                        qMax(0, parser.value("start-gap").toInt()),
+                                        parser.value("tls-sessions"));
+        serverThread.quit();
+        serverThread.wait();
+        return result;
+    }
+
+    Stats stats;
+    bool running = true;
+    int stoppedClients = 0;
+    QElapsedTimer elapsed;
+    qint64 elapsedMs = 0;
+
+    const auto onStopped = [&]() {
+        if (++stoppedClients == clientCount) {
+            elapsedMs = elapsed.elapsed();
+            app.quit();
+        }
+    };
+
+    std::vector<std::unique_ptr<VirtualUser>> users;
+    users.reserve(clientCount);
+    for (int i = 0; i < clientCount; ++i) {
+        const QString username = parser.isSet("shared-account")
+            ? QStringLiteral("load-user")
+            : QStringLiteral("load-user-%1").arg(i + 1);
+        users.push_back(std::make_unique<VirtualUser>(serverUrl, username, backgroundJobs,
+                                                      stats, running, onStopped));
+    }
+
+    elapsed.start();
+    for (const auto& user : users) {
+        user->start();
+    }
+
+    QTimer::singleShot(durationMs, &app, [&running]() { running = false; });
+    QTimer::singleShot(durationMs + DRAIN_TIMEOUT_MS, &app, [&]() {
+        elapsedMs = elapsed.elapsed();
+        app.quit();
+    });
+    app.exec();
+
+    const double seconds = qMax<qint64>(elapsedMs, 1) / 1000.0;
+    EndpointStats total;
+
+    QTextStream out(stdout);
+    out << clientCount << " clients, " << QString::number(seconds, 'f', 1) << " s, " << serverUrl << "\n\n";
+    out << QStringLiteral("endpoint").leftJustified(36)
+        << QStringLiteral("requests").rightJustified(10)
+        << QStringLiteral("errors").rightJustified(8)
+        << QStringLiteral("req/s").rightJustified(10)
+        << QStringLiteral("p50 ms").rightJustified(10)
+        << QStringLiteral("p99 ms").rightJustified(10) << '\n';
+
+    for (const auto& [name, endpoint] : stats) {
+        out << reportRow(name, endpoint, seconds) << '\n';
+        total.latenciesUs.insert(total.latenciesUs.end(), endpoint.latenciesUs.begin(), endpoint.latenciesUs.end());
+        total.errors += endpoint.errors;
+    }
+    out << reportRow(QStringLiteral("total"), total, seconds) << '\n';
+
+    if (stoppedClients < clientCount) {
+        out << '\n' << (clientCount - stoppedClients) << " clients still had a request in flight\n";
+    }
+    if (server) {
+        out << '\n' << "mock server: " << server->requestsServed() << " HTTP replies\n";
+    }
+    out.flush();
+
+    users.clear();
+    serverThread.quit();
+    serverThread.wait();
+    return 0;
+}
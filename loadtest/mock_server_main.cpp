@@ -0,0 +1,37 @@
+// Локальный mock-сервер Obsidian API для нагрузочного тестирования клиента.
+//
+//   ./obsidian_mock_server --peers 1000 --latency 50 --jitter 20 --error-rate 0.01
+//
+// Слушает http://127.0.0.1:8081 — адрес сервера клиента по умолчанию.
+// Неизвестный пользователь регистрируется при первом входе.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+#include "MockServer.h"
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("obsidian_mock_server");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Mock Obsidian API server for load and latency testing");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"address", "Address to listen on.", "address", "127.0.0.1"},
+        {"port", "Port to listen on.", "port", "8081"},
+    });
+    obsidian::MockServer::addCommandLineOptions(parser);
+    parser.process(app);
+
+    obsidian::MockServer server(obsidian::MockServer::optionsFromCommandLine(parser));
+    const QHostAddress address(parser.value("address"));
+    if (!server.listen(address, parser.value("port").toUShort())) {
+        QTextStream(stderr) << "Cannot listen on " << parser.value("address") << ':' << parser.value("port") << '\n';
+        return 1;
+    }
+
+    QTextStream(stdout) << "Listening on http://" << address.toString() << ':' << server.serverPort() << Qt::endl;
+    return app.exec();
+}
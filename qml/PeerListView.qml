@@ -12,9 +12,17 @@ Rectangle {
 
     property string selectedPeerId: ""
     property string pendingPrivateKey: ""
+    property int peersRequestId: 0
 
-    ListModel {
-        id: peersModel
+    // The list is not needed once the view is gone
+    Component.onDestruction: apiClient.cancel(peersRequestId)
+
+    // Rows come from peerListModel (C++), which applies every update as a
+    // diff; the selection is a model role so only two delegates change
+    Binding {
+        target: peerListModel
+        property: "selectedPeerId"
+        value: peerListView.selectedPeerId
     }
 
     ColumnLayout {
@@ -40,7 +48,7 @@ Rectangle {
             }
 
             Rectangle {
-                visible: peersModel.count > 0
+                visible: peerListModel.count > 0
                 width: 24
                 height: 20
                 radius: 10
@@ -48,7 +56,7 @@ Rectangle {
 
                 Label {
                     anchors.centerIn: parent
-                    text: peersModel.count
+                    text: peerListModel.count
                     font.pixelSize: 11
                     color: "#888899"
                 }
@@ -57,7 +65,7 @@ Rectangle {
             Item { Layout.fillWidth: true }
 
             Button {
-                visible: !hasCurrentDevice()
+                visible: !peerListModel.hasCurrentPeer
                 implicitWidth: 36
                 implicitHeight: 36
                 text: "+"
@@ -87,7 +95,7 @@ Rectangle {
             Layout.fillHeight: true
             clip: true
             spacing: 8
-            model: peersModel
+            model: peerListModel
 
             ScrollBar.vertical: ScrollBar {
                 policy: ScrollBar.AsNeeded
@@ -99,12 +107,12 @@ Rectangle {
                 height: 68
                 radius: 12
 
-                readonly property bool isCurrentDevice: model.peerId === configManager.currentPeerId
+                readonly property bool isCurrentDevice: model.isCurrentDevice
 
-                color: model.peerId === selectedPeerId ? "#253050" :
+                color: model.selected ? "#253050" :
                        (isCurrentDevice && delegateMouseArea.containsMouse ? "#1f1f3a" : "#151528")
-                border.color: model.peerId === selectedPeerId ? "#4ade80" : "transparent"
-                border.width: model.peerId === selectedPeerId ? 2 : 0
+                border.color: model.selected ? "#4ade80" : "transparent"
+                border.width: model.selected ? 2 : 0
                 opacity: isCurrentDevice ? 1.0 : 0.6
 
                 MouseArea {
@@ -132,7 +140,7 @@ Rectangle {
                         height: 42
                         radius: 10
                         color: delegateRoot.isCurrentDevice
-                               ? (model.peerId === selectedPeerId ? "#4ade80" : "#e94560")
+                               ? (model.selected ? "#4ade80" : "#e94560")
                                : "#3a3a5a"
 
                         Label {
@@ -184,7 +192,7 @@ Rectangle {
                         implicitHeight: 32
                         text: "\u2715"
                         font.pixelSize: 12
-                        opacity: delegateMouseArea.containsMouse || model.peerId === selectedPeerId ? 1 : 0
+                        opacity: delegateMouseArea.containsMouse || model.selected ? 1 : 0
 
                         background: Rectangle {
                             color: parent.pressed ? "#ef4444" : "transparent"
@@ -210,7 +218,7 @@ Rectangle {
             // Empty state
             Label {
                 anchors.centerIn: parent
-                visible: peersModel.count === 0
+                visible: peerListModel.count === 0
                 text: qsTr("No devices\nTap + to add")
                 horizontalAlignment: Text.AlignHCenter
                 font.pixelSize: 14
@@ -315,26 +323,15 @@ Rectangle {
     Connections {
         target: apiClient
 
-        function onPeersLoaded(peerList) {
-            peersModel.clear()
-            for (var i = 0; i < peerList.length; i++) {
-                var p = peerList[i]
-                peersModel.append({
-                    peerId: p.id,
-                    deviceName: p.deviceName,
-                    ipAddress: p.ipAddress,
-                    isActive: p.isActive
-                })
-            }
-            // Auto-select current device if it exists in the list
+        // peerListModel has applied the page already; once the list is
+        // complete the current device is auto-selected if it is in it
+        function onPeersBatchLoaded(requestId, peerList, last) {
+            if (requestId !== peersRequestId || !last)
+                return
+
             var curId = configManager.currentPeerId
-            if (curId.length > 0 && selectedPeerId === "") {
-                for (var j = 0; j < peersModel.count; j++) {
-                    if (peersModel.get(j).peerId === curId) {
-                        selectPeer(curId, peersModel.get(j).deviceName)
-                        break
-                    }
-                }
+            if (curId.length > 0 && selectedPeerId === "" && peerListModel.contains(curId)) {
+                selectPeer(curId, peerListModel.get(peerListModel.indexOf(curId)).deviceName)
             }
         }
 
@@ -368,7 +365,11 @@ Rectangle {
     }
 
     function loadPeers() {
-        apiClient.getPeers()
+        // A newer list replaces the one still streaming; the shown rows
+        // stay until it is complete and is diffed in
+        apiClient.cancel(peersRequestId)
+        peersRequestId = apiClient.loadPeersPaged()
+        peerListModel.beginLoad(peersRequestId)
     }
 
     function createPeer(deviceName) {
@@ -385,15 +386,4 @@ Rectangle {
         var configPath = configManager.configFilePath(peerId)
         peerListView.peerSelected(peerId, configPath)
     }
-
-    function hasCurrentDevice() {
-        var curId = configManager.currentPeerId
-        if (curId.length === 0)
-            return false
-        for (var i = 0; i < peersModel.count; i++) {
-            if (peersModel.get(i).peerId === curId)
-                return true
-        }
-        return false
-    }
 }
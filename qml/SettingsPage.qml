@@ -7,6 +7,13 @@ Page {
 
     signal back()
 
+    // Request timings; five taps on the version reveal them
+    property int versionTaps: 0
+    property bool diagnosticsVisible: false
+    property var metrics: ({})
+    property var queueWaits: ({})
+    readonly property var phaseNames: ["queue", "connect", "ttfb", "download", "decode", "dispatch", "total"]
+
     background: Rectangle {
         color: "#0f0f1a"
     }
@@ -133,6 +140,15 @@ Page {
                                 font.weight: Font.Medium
                                 color: "#ffffff"
                             }
+
+                            TapHandler {
+                                onTapped: {
+                                    settingsPage.versionTaps++
+                                    if (settingsPage.versionTaps >= 5) {
+                                        settingsPage.diagnosticsVisible = true
+                                    }
+                                }
+                            }
                         }
 
                         Rectangle {
@@ -240,6 +256,208 @@ Page {
                 }
             }
 
+            // Diagnostics (hidden)
+            Rectangle {
+                visible: settingsPage.diagnosticsVisible
+                Layout.fillWidth: true
+                Layout.leftMargin: 20
+                Layout.rightMargin: 20
+                height: diagnosticsColumn.height + 48
+                radius: 16
+                color: "#1a1a2e"
+
+                Timer {
+                    interval: 1000
+                    repeat: true
+                    triggeredOnStart: true
+                    running: settingsPage.diagnosticsVisible && settingsPage.visible
+                    onTriggered: {
+                        settingsPage.metrics = apiClient.metricsSnapshot()
+                        settingsPage.queueWaits = apiClient.queueWaitSnapshot()
+                    }
+                }
+
+                ColumnLayout {
+                    id: diagnosticsColumn
+                    anchors.left: parent.left
+                    anchors.right: parent.right
+                    anchors.top: parent.top
+                    anchors.margins: 24
+                    spacing: 16
+
+                    RowLayout {
+                        spacing: 12
+
+                        Rectangle {
+                            width: 40
+                            height: 40
+                            radius: 10
+                            color: "#2a2a4a"
+
+                            Label {
+                                anchors.centerIn: parent
+                                text: "⏱"
+                                font.pixelSize: 18
+                            }
+                        }
+
+                        Label {
+                            text: qsTr("Diagnostics")
+                            font.pixelSize: 17
+                            font.weight: Font.DemiBold
+                            color: "#ffffff"
+                        }
+                    }
+
+                    // Scheduler queue wait per priority class, with the current load
+                    ColumnLayout {
+                        Layout.fillWidth: true
+                        spacing: 4
+
+                        Label {
+                            text: qsTr("Queue wait")
+                            font.pixelSize: 13
+                            font.weight: Font.DemiBold
+                            color: "#ffffff"
+                        }
+
+                        Repeater {
+                            model: ["interactive", "normal", "background"]
+
+                            delegate: Label {
+                                required property string modelData
+                                readonly property var stats: settingsPage.queueWaits[modelData] || ({})
+
+                                text: modelData.padEnd(12)
+                                      + (stats.count ? stats.p50.toFixed(1) + " / " + stats.p99.toFixed(1) + " ms  (" + stats.count + ")"
+                                                     : "-")
+                                      + "  " + qsTr("active %1, queued %2").arg(stats.active || 0).arg(stats.queued || 0)
+                                font.family: "monospace"
+                                font.pixelSize: 12
+                                color: "#888899"
+                            }
+                        }
+                    }
+
+                    Label {
+                        visible: Object.keys(settingsPage.metrics).length === 0
+                        text: qsTr("No completed requests yet")
+                        font.pixelSize: 13
+                        color: "#888899"
+                    }
+
+                    Repeater {
+                        model: Object.keys(settingsPage.metrics).sort()
+
+                        delegate: ColumnLayout {
+                            id: endpointColumn
+                            required property string modelData
+                            readonly property var phases: settingsPage.metrics[modelData] || ({})
+
+                            Layout.fillWidth: true
+                            spacing: 4
+
+                            Label {
+                                Layout.fillWidth: true
+                                text: endpointColumn.modelData
+                                elide: Text.ElideRight
+                                font.pixelSize: 13
+                                font.weight: Font.DemiBold
+                                color: "#ffffff"
+                            }
+
+                            // p50 / p99 in ms and the sample count, per phase
+                            Repeater {
+                                model: settingsPage.phaseNames.filter(phase => endpointColumn.phases[phase] !== undefined)
+
+                                delegate: Label {
+                                    required property string modelData
+                                    readonly property var stats: endpointColumn.phases[modelData]
+
+                                    text: modelData.padEnd(9) + stats.p50.toFixed(1) + " / "
+                                          + stats.p99.toFixed(1) + " ms  (" + stats.count + ")"
+                                    font.family: "monospace"
+                                    font.pixelSize: 12
+                                    color: "#888899"
+                                }
+                            }
+                        }
+                    }
+
+                    Rectangle {
+                        Layout.fillWidth: true
+                        height: 1
+                        color: "#2a2a4a"
+                    }
+
+                    RowLayout {
+                        Layout.fillWidth: true
+                        spacing: 12
+
+                        Button {
+                            Layout.fillWidth: true
+                            Layout.preferredHeight: 40
+                            text: qsTr("Write metrics file")
+
+                            background: Rectangle {
+                                color: parent.pressed ? "#3a3a5a" : "#2a2a4a"
+                                radius: 8
+                            }
+
+                            contentItem: Text {
+                                text: parent.text
+                                color: "#ffffff"
+                                font.pixelSize: 14
+                                horizontalAlignment: Text.AlignHCenter
+                                verticalAlignment: Text.AlignVCenter
+                            }
+
+                            onClicked: {
+                                const path = configManager.metricsFilePath()
+                                metricsStatus.text = apiClient.writeMetrics(path)
+                                        ? qsTr("Saved to %1").arg(path)
+                                        : qsTr("Could not write %1").arg(path)
+                            }
+                        }
+
+                        Button {
+                            Layout.preferredWidth: 100
+                            Layout.preferredHeight: 40
+                            text: qsTr("Reset")
+
+                            background: Rectangle {
+                                color: parent.pressed ? "#3a3a5a" : "#2a2a4a"
+                                radius: 8
+                            }
+
+                            contentItem: Text {
+                                text: parent.text
+                                color: "#ffffff"
+                                font.pixelSize: 14
+                                horizontalAlignment: Text.AlignHCenter
+                                verticalAlignment: Text.AlignVCenter
+                            }
+
+                            onClicked: {
+                                apiClient.resetMetrics()
+                                settingsPage.metrics = apiClient.metricsSnapshot()
+                                settingsPage.queueWaits = apiClient.queueWaitSnapshot()
+                                metricsStatus.text = ""
+                            }
+                        }
+                    }
+
+                    Label {
+                        id: metricsStatus
+                        Layout.fillWidth: true
+                        visible: text.length > 0
+                        wrapMode: Text.WrapAnywhere
+                        font.pixelSize: 12
+                        color: "#888899"
+                    }
+                }
+            }
+
             Item { Layout.preferredHeight: 20 }
         }
     }
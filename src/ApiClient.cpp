@@ -1,148 +1,1366 @@
 #include "ApiClient.h"
+#include "TlsSessionCache.h"
+#include "JsonArrayStream.h"
+#include "PeerStore.h"
 #include <QNetworkRequest>
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QUrl>
+#include <QUrlQuery>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QRandomGenerator>
+#include <QDebug>
+#include <variant>
+#include <optional>
+#include <chrono>
+#include <utility>
+#include <type_traits>
+#if QT_CONFIG(ssl)
+#include <QSslConfiguration>
+#endif
 
 namespace obsidian {
 
+namespace {
+
+// Response decoders. Each one parses the reply body exactly once and fills
+// the result type directly; false means the body is not what the endpoint
+// promises.
+
+QJsonDocument parseJson(const QByteArray& body) {
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(body, &error);
+    if (error.error != QJsonParseError::NoError) {
+        return QJsonDocument();
+    }
+    return doc;
+}
+
+struct EmptyResponse {
+    using Result = std::monostate;
+
+    static bool decode(const QByteArray&, Result&) {
+        return true;
+    }
+};
+
+struct TextResponse {
+    using Result = QString;
+
+    static bool decode(const QByteArray& body, Result& out) {
+        out = QString::fromUtf8(body);
+        return true;
+    }
+};
+
+struct AuthTokensResponse {
+    using Result = AuthTokens;
+
+    static bool decode(const QByteArray& body, Result& out) {
+        const QJsonDocument doc = parseJson(body);
+        if (!doc.isObject()) {
+            return false;
+        }
+        const QJsonObject obj = doc.object();
+        out.accessToken = obj.value(QLatin1String("access_token")).toString();
+        out.refreshToken = obj.value(QLatin1String("refresh_token")).toString();
+        out.expiresIn = obj.value(QLatin1String("expires_in")).toInt();
+        return true;
+    }
+};
+
+// WireGuard config text ("[Interface]" / "[Peer]" sections) -> ServerConfig
+ServerConfig parseServerConfig(const QString& config) {
+    ServerConfig result;
+
+    for (QStringView line : QStringView(config).split(u'\n')) {
+        const qsizetype separator = line.indexOf(u'=');
+        if (separator < 0) {
+            continue;
+        }
+        const QStringView key = line.left(separator).trimmed();
+        const QString value = line.mid(separator + 1).trimmed().toString();
+
+        if (key.compare(u"Endpoint", Qt::CaseInsensitive) == 0) {
+            result.endpoint = value;
+        } else if (key.compare(u"PublicKey", Qt::CaseInsensitive) == 0) {
+            result.serverPublicKey = value;
+        } else if (key.compare(u"Address", Qt::CaseInsensitive) == 0) {
+            result.address = value;
+        } else if (key.compare(u"DNS", Qt::CaseInsensitive) == 0) {
+            result.dns = value;
+        } else if (key.compare(u"PresharedKey", Qt::CaseInsensitive) == 0) {
+            result.presharedKey = value;
+        } else if (key.compare(u"AllowedIPs", Qt::CaseInsensitive) == 0) {
+            result.allowedIPs = value;
+        }
+    }
+
+    return result;
+}
+
+struct CreatedPeer {
+    PeerInfo peer;
+    ServerConfig config;
+};
+
+struct CreatedPeerResponse {
+    using Result = CreatedPeer;
+
+    static bool decode(const QByteArray& body, Result& out) {
+        const QJsonDocument doc = parseJson(body);
+        if (!doc.isObject()) {
+            return false;
+        }
+        const QJsonObject obj = doc.object();
+        out.peer = ApiClient::parsePeer(obj.value(QLatin1String("peer")).toObject());
+        out.config = parseServerConfig(obj.value(QLatin1String("config")).toString());
+        return true;
+    }
+};
+
+// Per-item results of a bulk endpoint: {"results": [...]} or a bare array
+struct BulkResultsResponse {
+    using Result = QJsonArray;
+
+    static bool decode(const QByteArray& body, Result& out) {
+        const QJsonDocument doc = parseJson(body);
+        if (doc.isArray()) {
+            out = doc.array();
+            return true;
+        }
+        if (doc.isObject() && doc.object().value(QLatin1String("results")).isArray()) {
+            out = doc.object().value(QLatin1String("results")).toArray();
+            return true;
+        }
+        return false;
+    }
+};
+
+// Delta of the peer list since a revision:
+//   {"revision": "...", "full": false, "peers": [changed...], "deleted": [ids...]}
+// "full": true means "peers" is the whole list (no or too old revision)
+struct PeerChanges {
+    QString revision;
+    bool full = false;
+    QList<PeerInfo> upserts;
+    QStringList deleted;
+};
+
+struct PeerChangesResponse {
+    using Result = PeerChanges;
+
+    static bool decode(const QByteArray& body, Result& out) {
+        const QJsonDocument doc = parseJson(body);
+        if (!doc.isObject()) {
+            return false;
+        }
+        const QJsonObject obj = doc.object();
+        out.revision = obj.value(QLatin1String("revision")).toVariant().toString();
+        out.full = obj.value(QLatin1String("full")).toBool();
+        out.upserts = ApiClient::parsePeers(obj.value(QLatin1String("peers")).toArray());
+        for (const QJsonValue& id : obj.value(QLatin1String("deleted")).toArray()) {
+            out.deleted.append(id.toString());
+        }
+        return !out.revision.isEmpty();
+    }
+};
+
+struct PeerListResponse {
+    using Result = QList<PeerInfo>;
+
+    static bool decode(const QByteArray& body, Result& out) {
+        const QJsonDocument doc = parseJson(body);
+        if (!doc.isArray()) {
+            return false;
+        }
+        out = ApiClient::parsePeers(doc.array());
+        return true;
+    }
+};
+
+// Resilience policies. Only GETs are retried: POST is not idempotent and a
+// repeated DELETE would report 404 for a peer the first attempt removed
+namespace policies {
+constexpr ResiliencePolicy Interactive{.transferTimeoutMs = 15000};
+constexpr ResiliencePolicy Read{.transferTimeoutMs = 10000, .maxAttempts = 4};
+constexpr ResiliencePolicy Bulk{.transferTimeoutMs = 60000};
+// Backoff between failed token refreshes, not retries of one request
+constexpr ResiliencePolicy TokenRefresh{.backoffBaseMs = 10000, .backoffMaxMs = 5 * 60 * 1000};
+} // namespace policies
+
+// Endpoints of the Obsidian API. Interactive: the user has just asked for
+// it (the token refresh too, every parked request waits for it); background:
+// sync and bulk jobs, including the single requests of a bulk fallback
+namespace endpoints {
+constexpr ApiEndpoint<AuthTokensResponse> Login{
+    .method = HttpMethod::Post, .path = "/api/auth/login",
+    .auth = Auth::None, .resilience = policies::Interactive, .priority = RequestPriority::Interactive};
+constexpr ApiEndpoint<EmptyResponse> Register{
+    .method = HttpMethod::Post, .path = "/api/auth/register",
+    .auth = Auth::None, .resilience = policies::Interactive, .priority = RequestPriority::Interactive};
+constexpr ApiEndpoint<AuthTokensResponse> Refresh{
+    .method = HttpMethod::Post, .path = "/api/auth/refresh",
+    .auth = Auth::None, .resilience = policies::Interactive, .priority = RequestPriority::Interactive};
+constexpr ApiEndpoint<CreatedPeerResponse> CreatePeer{
+    .method = HttpMethod::Post, .path = "/api/vpn/peers",
+    .resilience = policies::Interactive, .priority = RequestPriority::Interactive};
+constexpr ApiEndpoint<PeerListResponse> ListPeers{
+    .method = HttpMethod::Get, .path = "/api/vpn/peers",
+    .cachePolicy = CachePolicy::Conditional, .resilience = policies::Read};
+constexpr ApiEndpoint<EmptyResponse> DeletePeer{
+    .method = HttpMethod::Delete, .path = "/api/vpn/peers/%1",
+    .resilience = policies::Interactive, .priority = RequestPriority::Interactive};
+constexpr ApiEndpoint<TextResponse> PeerConfig{
+    .method = HttpMethod::Get, .path = "/api/vpn/peers/%1/config",
+    .cachePolicy = CachePolicy::Conditional, .resilience = policies::Read,
+    .priority = RequestPriority::Interactive};
+constexpr ApiEndpoint<PeerChangesResponse> PeerChanges{
+    .method = HttpMethod::Get, .path = "/api/vpn/peers/changes?since=%1",
+    .resilience = policies::Read, .priority = RequestPriority::Background};
+constexpr ApiEndpoint<BulkResultsResponse> BulkCreatePeers{
+    .method = HttpMethod::Post, .path = "/api/vpn/peers/bulk",
+    .resilience = policies::Bulk, .priority = RequestPriority::Background};
+constexpr ApiEndpoint<BulkResultsResponse> BulkDeletePeers{
+    .method = HttpMethod::Post, .path = "/api/vpn/peers/bulk-delete",
+    .resilience = policies::Bulk, .priority = RequestPriority::Background};
+constexpr ApiEndpoint<CreatedPeerResponse> BulkItemCreatePeer{
+    .method = HttpMethod::Post, .path = "/api/vpn/peers",
+    .resilience = policies::Interactive, .priority = RequestPriority::Background};
+constexpr ApiEndpoint<EmptyResponse> BulkItemDeletePeer{
+    .method = HttpMethod::Delete, .path = "/api/vpn/peers/%1",
+    .resilience = policies::Interactive, .priority = RequestPriority::Background};
+} // namespace endpoints
+
+QNetworkRequest::Priority networkPriority(RequestPriority priority) {
+    switch (priority) {
+    case RequestPriority::Interactive:
+        return QNetworkRequest::HighPriority;
+    case RequestPriority::Normal:
+        return QNetworkRequest::NormalPriority;
+    case RequestPriority::Background:
+        return QNetworkRequest::LowPriority;
+    }
+    return QNetworkRequest::NormalPriority;
+}
+
+// Failures that say nothing about the request itself: the server is down,
+// overloaded or unreachable. They are retried and trip the circuit breaker
+bool isServerFailure(QNetworkReply::NetworkError error, int status) {
+    switch (error) {
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::HostNotFoundError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::OperationCanceledError:     // transfer timeout
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::UnknownNetworkError:
+        return true;
+    default:
+        break;
+    }
+    return status == 500 || status == 502 || status == 503 || status == 504;
+}
+
+#if QT_CONFIG(ssl)
+// TLS settings shared by the pre-connect and the requests: they must match,
+// otherwise QNetworkAccessManager does not reuse the warmed-up socket
+QSslConfiguration makeSslConfiguration(bool http2, const QByteArray& sessionTicket) {
+    QSslConfiguration config = QSslConfiguration::defaultConfiguration();
+    if (http2) {
+        // ALPN is negotiated during the handshake, so the pre-connected
+        // socket must already offer h2 to be reused by HTTP/2 requests
+        config.setAllowedNextProtocols({
+            QSslConfiguration::ALPNProtocolHTTP2,
+            QSslConfiguration::NextProtocolHttp1_1
+        });
+    }
+    // Without this QSslSocket does not expose the session ticket
+    config.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+    if (!sessionTicket.isEmpty()) {
+        config.setSessionTicket(sessionTicket);
+    }
+    return config;
+}
+#endif
+
+QJsonObject createPeerBody(const QString& deviceName, const QString& publicKey) {
+    QJsonObject body;
+    body["device_name"] = deviceName;
+    body["protocol"] = "wireguard";
+    body["public_key"] = publicKey;
+    return body;
+}
+
+// createPeers() item: {deviceName, publicKey}
+QJsonObject createPeerBody(const QVariant& device) {
+    const QVariantMap map = device.toMap();
+    return createPeerBody(map.value("deviceName").toString(), map.value("publicKey").toString());
+}
+
+// Start of a bulkFinished result: what the item was
+QVariantMap bulkItemResult(bool create, const QVariant& item) {
+    QVariantMap result;
+    if (create) {
+        result["deviceName"] = item.toMap().value("deviceName");
+    } else {
+        result["peerId"] = item.toString();
+    }
+    return result;
+}
+
+// Error text of a failed reply: the server's {"error": "..."} if present
+QString replyError(QNetworkReply* reply, const QByteArray& body) {
+    const QString serverError = parseJson(body).object().value(QLatin1String("error")).toString();
+    return serverError.isEmpty() ? reply->errorString() : serverError;
+}
+
+// Network phase boundaries of one reply, in ns since it was issued; -1 if not seen
+struct ReplyTiming {
+    QElapsedTimer clock;
+    qint64 connecting = -1;     // a new connection started
+    qint64 sent = -1;           // request written
+    qint64 headers = -1;        // response headers received
+};
+
+std::shared_ptr<ReplyTiming> timeReply(QNetworkReply* reply) {
+    auto timing = std::make_shared<ReplyTiming>();
+    timing->clock.start();
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    QObject::connect(reply, &QNetworkReply::socketStartedConnecting, reply, [timing]() {
+        if (timing->connecting < 0) {
+            timing->connecting = timing->clock.nsecsElapsed();
+        }
+    });
+    QObject::connect(reply, &QNetworkReply::requestSent, reply, [timing]() {
+        if (timing->headers < 0) {
+            timing->sent = timing->clock.nsecsElapsed();
+        }
+    });
+#endif
+    QObject::connect(reply, &QNetworkReply::metaDataChanged, reply, [timing]() {
+        if (timing->headers < 0) {
+            timing->headers = timing->clock.nsecsElapsed();
+        }
+    });
+    return timing;
+}
+
+// Queue, connect, TTFB and download of a reply that got a response. Before
+// Qt 6.3 there are no connection signals and all of the wait counts as TTFB
+void recordNetworkPhases(RequestMetrics& metrics, const QString& endpoint,
+                         const ReplyTiming& timing, qint64 finished)
+{
+    using Phase = RequestMetrics::Phase;
+    if (timing.headers < 0) {
+        return;
+    }
+
+    qint64 sent = 0;
+    if (timing.sent >= 0) {
+        sent = timing.sent;
+        if (timing.connecting >= 0 && timing.connecting <= sent) {
+            metrics.record(endpoint, Phase::Queue, timing.connecting);
+            metrics.record(endpoint, Phase::Connect, sent - timing.connecting);
+        } else {
+            metrics.record(endpoint, Phase::Queue, sent);
+        }
+    }
+    metrics.record(endpoint, Phase::Ttfb, timing.headers - sent);
+    metrics.record(endpoint, Phase::Download, finished - timing.headers);
+}
+
+} // anonymous namespace
+
 ApiClient::ApiClient(QObject* parent)
     : QObject(parent)
+    , m_peerStore(std::make_unique<PeerStore>())
 {
+    m_refreshTimer.setSingleShot(true);
+    m_refreshTimer.setTimerType(Qt::VeryCoarseTimer);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &ApiClient::scheduleTokenRefresh);
 }
 
+ApiClient::~ApiClient() = default;
+
 void ApiClient::setServerUrl(const QString& url) {
     if (m_serverUrl != url) {
         m_serverUrl = url;
+
+        // New server: measure the cold start again
+        m_firstByteMeasured = false;
+        m_firstRequest = nullptr;
+        m_warmedUp = false;
+        if (m_warmUpEnabled) {
+            warmUp();
+        }
+
+        clearResponseCache();
+        resetPeerSync();
+        m_bulkEndpointMissing = false;
+        m_peerChangesMissing = false;
+
         emit serverUrlChanged();
     }
 }
 
-void ApiClient::setLoading(bool loading) {
-    if (m_loading != loading) {
-        m_loading = loading;
-        emit loadingChanged();
+void ApiClient::setHttp2Enabled(bool enabled) {
+    if (m_http2 != enabled) {
+        m_http2 = enabled;
+        emit http2EnabledChanged();
+    }
+}
+
+void ApiClient::resetHttp2() {
+    if (m_http2) {
+        m_http2.reset();
+        emit http2EnabledChanged();
+    }
+}
+
+void ApiClient::warmUp() {
+    const QUrl url(m_serverUrl);
+    if (!url.isValid() || url.host().isEmpty()) {
+        return;
+    }
+
+    if (url.scheme() == QLatin1String("https")) {
+#if QT_CONFIG(ssl)
+        const QByteArray ticket = m_tlsSessionCache ? m_tlsSessionCache->ticket(url) : QByteArray();
+        m_networkManager.connectToHostEncrypted(url.host(), static_cast<quint16>(url.port(443)),
+                                                makeSslConfiguration(m_http2.value_or(true), ticket));
+        m_warmedUp = true;
+#endif
+    } else {
+        // For h2c the socket itself is not reused, but DNS is still cached
+        m_networkManager.connectToHost(url.host(), static_cast<quint16>(url.port(80)));
+        m_warmedUp = true;
+    }
+}
+
+void ApiClient::setCacheLimit(qint64 bytes) {
+    m_responseCache.setMaxCost(bytes);
+    emit responseCacheChanged();
+}
+
+void ApiClient::clearResponseCache() {
+    m_responseCache.clear();
+    emit responseCacheChanged();
+}
+
+void ApiClient::storeResponse(const QString& path, QNetworkReply* reply, qsizetype bodySize, std::any value) {
+    auto entry = std::make_unique<CachedResponse>();
+    entry->etag = reply->rawHeader(QByteArrayLiteral("ETag"));
+    entry->lastModified = reply->rawHeader(QByteArrayLiteral("Last-Modified"));
+
+    if (entry->etag.isEmpty() && entry->lastModified.isEmpty()) {
+        // Nothing to revalidate with
+        m_responseCache.remove(path);
+    } else {
+        entry->value = std::move(value);
+        // Responses larger than the whole limit are dropped by QCache
+        m_responseCache.insert(path, entry.release(), qMax<qsizetype>(bodySize, 1));
+    }
+}
+
+QString ApiClient::coalescingKeyFor(HttpMethod method, const QString& path, const QJsonObject& body) const {
+    // The token is part of the key: after a re-login a request must not
+    // attach to one sent on behalf of the previous account
+    const size_t bodyHash = body.isEmpty() ? 0 : qHash(QJsonDocument(body).toJson(QJsonDocument::Compact));
+    return QString::number(static_cast<int>(method)) + u' ' + m_serverUrl + path
+           + u' ' + QString::number(qHash(m_authorizationHeader))
+           + u' ' + QString::number(bodyHash);
+}
+
+void ApiClient::setAccessToken(const QString& accessToken, int expiresIn, bool issuedNow) {
+    m_accessToken = accessToken;
+    m_authorizationHeader = accessToken.isEmpty()
+        ? QByteArray()
+        : QByteArrayLiteral("Bearer ") + accessToken.toUtf8();
+
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    const QJsonObject claims = jwtClaims(accessToken);
+    const auto expiry = static_cast<qint64>(claims.value(QLatin1String("exp")).toDouble());
+    const auto issuedAt = static_cast<qint64>(claims.value(QLatin1String("iat")).toDouble());
+
+    // A token issued just now tells how far the local clock is off the
+    // server's; a restored one is judged with the last known offset
+    if (issuedNow && expiry > 0) {
+        if (issuedAt > 0) {
+            m_clockSkew = issuedAt - now;
+        } else if (expiresIn > 0) {
+            m_clockSkew = expiry - expiresIn - now;
+        }
     }
+
+    // The token itself is authoritative; expires_in is the fallback for
+    // opaque tokens. The expiry is kept in local clock time
+    if (expiry > 0) {
+        m_accessTokenExpiry = expiry - m_clockSkew;
+        m_accessTokenLifetime = issuedAt > 0 ? expiry - issuedAt
+                              : expiresIn > 0 ? expiresIn
+                              : m_accessTokenExpiry - now;
+    } else if (expiresIn > 0) {
+        m_accessTokenExpiry = now + expiresIn;
+        m_accessTokenLifetime = expiresIn;
+    } else {
+        m_accessTokenExpiry = 0;
+        m_accessTokenLifetime = 0;
+    }
+    scheduleTokenRefresh();
 }
 
-void ApiClient::sendRequest(
-    const QString& endpoint,
-    const QString& method,
-    const QJsonObject& body,
-    std::function<void(const QJsonObject&)> onSuccess,
-    std::function<void(const QString&)> onError)
+QJsonObject ApiClient::jwtClaims(const QString& token) {
+    const QStringList parts = token.split(u'.');
+    if (parts.size() != 3) {
+        return QJsonObject();
+    }
+    const QByteArray payload = QByteArray::fromBase64(parts[1].toLatin1(),
+        QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals);
+    return parseJson(payload).object();
+}
+
+qint64 ApiClient::jwtExpiry(const QString& token) {
+    return static_cast<qint64>(jwtClaims(token).value(QLatin1String("exp")).toDouble());
+}
+
+void ApiClient::scheduleTokenRefresh() {
+    m_refreshTimer.stop();
+    if (m_accessTokenExpiry == 0 || m_refreshToken.isEmpty() || m_refreshInProgress) {
+        return;
+    }
+
+    // At most half the lifetime: a token shorter than two margins would be
+    // due for refresh the moment it arrives. Never sooner than
+    // m_nextRefreshAllowed, so an already expired token (a clock far off
+    // the server's) cannot make refreshes run back to back
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    const qint64 margin = qMin<qint64>(REFRESH_MARGIN, m_accessTokenLifetime / 2);
+    const qint64 remaining = qMax(m_accessTokenExpiry - margin - now, m_nextRefreshAllowed - now);
+    if (remaining <= 0) {
+        startTokenRefresh();
+        return;
+    }
+
+    // Long waits are split: the timer re-checks the clock when it fires,
+    // which also covers a suspend/resume in between
+    constexpr qint64 MAX_WAIT = 60 * 60;
+    m_refreshTimer.start(std::chrono::seconds(qMin(remaining, MAX_WAIT)));
+}
+
+void ApiClient::startTokenRefresh() {
+    if (m_refreshInProgress) {
+        return;
+    }
+    m_refreshInProgress = true;
+    m_refreshTimer.stop();
+
+    QJsonObject body;
+    body["refresh_token"] = m_refreshToken;
+
+    send(endpoints::Refresh, QString(), body,
+        [this](AuthTokens tokens) {
+            m_refreshInProgress = false;
+            m_refreshFailures = 0;
+            m_nextRefreshAllowed = QDateTime::currentSecsSinceEpoch() + MIN_REFRESH_INTERVAL;
+            if (!tokens.refreshToken.isEmpty()) {
+                m_refreshToken = tokens.refreshToken;
+            } else {
+                tokens.refreshToken = m_refreshToken;
+            }
+            setAccessToken(tokens.accessToken, tokens.expiresIn, true);
+
+            emit tokenRefreshed(tokens);
+
+            // Taken first: a replayed request may park itself again
+            const QList<ParkedRequest> parked = std::exchange(m_parkedRequests, {});
+            for (const ParkedRequest& request : parked) {
+                request.replay();
+            }
+        },
+        [this](const QString& error, int status) {
+            m_refreshInProgress = false;
+            failParkedRequests(error);
+            emit apiError(error);
+
+            // A rejected refresh token stays rejected; anything else (no
+            // network, 5xx, open circuit) is retried with growing delays
+            if (status == 400 || status == 401 || status == 403) {
+                return;
+            }
+            ++m_refreshFailures;
+            const int delayMs = policies::TokenRefresh.backoffDelayMs(
+                m_refreshFailures + 1, QRandomGenerator::global()->generateDouble());
+            m_nextRefreshAllowed = QDateTime::currentSecsSinceEpoch()
+                                 + qMax<qint64>(MIN_REFRESH_INTERVAL, (delayMs + 999) / 1000);
+            scheduleTokenRefresh();
+        }
+    );
+}
+
+void ApiClient::failParkedRequests(const QString& error) {
+    const QList<ParkedRequest> parked = std::exchange(m_parkedRequests, {});
+    for (const ParkedRequest& request : parked) {
+        request.fail(error);
+    }
+}
+
+QNetworkReply* ApiClient::startRequest(HttpMethod method, const QString& path, const QJsonObject& body,
+                                       int transferTimeoutMs, RequestPriority priority,
+                                       const CachedResponse* revalidate)
 {
-    QUrl url(m_serverUrl + endpoint);
+    const QUrl url(m_serverUrl + path);
     QNetworkRequest request(url);
+    request.setTransferTimeout(transferTimeoutMs);
+    // Order of requests QNetworkAccessManager itself has to queue
+    request.setPriority(networkPriority(priority));
+
+    // Left alone unless configured: Qt 6 allows HTTP/2 by default
+    if (m_http2) {
+        request.setAttribute(QNetworkRequest::Http2AllowedAttribute, *m_http2);
+    }
+    if (http2Enabled() && url.scheme() == QLatin1String("http")) {
+        request.setAttribute(QNetworkRequest::Http2DirectAttribute, true);
+    }
+#if QT_CONFIG(ssl)
+    // h2 is offered unless disabled, as Qt does for requests without an
+    // explicit TLS configuration
+    if (url.scheme() == QLatin1String("https")) {
+        const QByteArray ticket = m_tlsSessionCache ? m_tlsSessionCache->ticket(url) : QByteArray();
+        request.setSslConfiguration(makeSslConfiguration(m_http2.value_or(true), ticket));
+    }
+#endif
 
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    if (!m_authorizationHeader.isEmpty()) {
+        request.setRawHeader(QByteArrayLiteral("Authorization"), m_authorizationHeader);
+    }
 
-    if (!m_accessToken.isEmpty()) {
-        request.setRawHeader("Authorization", ("Bearer " + m_accessToken).toUtf8());
+    if (revalidate) {
+        if (!revalidate->etag.isEmpty()) {
+            request.setRawHeader(QByteArrayLiteral("If-None-Match"), revalidate->etag);
+        }
+        if (!revalidate->lastModified.isEmpty()) {
+            request.setRawHeader(QByteArrayLiteral("If-Modified-Since"), revalidate->lastModified);
+        }
     }
 
-    QNetworkReply* reply = nullptr;
+    QByteArray payload;
+    if (method == HttpMethod::Post || method == HttpMethod::Put) {
+        request.setHeader(QNetworkRequest::ContentTypeHeader, QByteArrayLiteral("application/json"));
+        payload = QJsonDocument(body).toJson(QJsonDocument::Compact);
+    }
 
-    if (method == "GET") {
+    QNetworkReply* reply = nullptr;
+    switch (method) {
+    case HttpMethod::Get:
         reply = m_networkManager.get(request);
-    } else if (method == "POST") {
-        reply = m_networkManager.post(request, QJsonDocument(body).toJson());
-    } else if (method == "PUT") {
-        reply = m_networkManager.put(request, QJsonDocument(body).toJson());
-    } else if (method == "DELETE") {
+        break;
+    case HttpMethod::Post:
+        reply = m_networkManager.post(request, payload);
+        break;
+    case HttpMethod::Put:
+        reply = m_networkManager.put(request, payload);
+        break;
+    case HttpMethod::Delete:
         reply = m_networkManager.deleteResource(request);
+        break;
     }
 
     if (!reply) {
-        onError("Failed to create request");
+        return nullptr;
+    }
+
+    if (!m_firstByteMeasured && !m_firstRequest) {
+        m_firstRequest = reply;
+        QElapsedTimer started;
+        started.start();
+
+        connect(reply, &QNetworkReply::metaDataChanged, this, [this, reply, started]() {
+            if (m_firstRequest != reply) {
+                return;
+            }
+            m_firstRequest = nullptr;
+            m_firstByteMeasured = true;
+            m_firstByteTimeMs = started.nsecsElapsed() / 1e6;
+
+            const bool http2 = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+            qInfo() << "ApiClient: first byte after" << m_firstByteTimeMs << "ms"
+                    << (m_warmedUp ? "(warmed up," : "(cold,")
+                    << (http2 ? "HTTP/2)" : "HTTP/1.1)");
+            emit firstByteTimeMeasured(m_firstByteTimeMs, m_warmedUp, http2);
+        }, Qt::SingleShotConnection);
+    }
+
+    beginActivity();
+    return reply;
+}
+
+void ApiClient::finishRequest(QNetworkReply* reply) {
+    // The first request failed before any response: measure the next one
+    if (m_firstRequest == reply) {
+        m_firstRequest = nullptr;
+    }
+
+    storeTlsSession(reply);
+    endActivity();
+}
+
+void ApiClient::beginActivity() {
+    if (m_activeRequests++ == 0) {
+        emit loadingChanged();
+    }
+}
+
+void ApiClient::endActivity() {
+    if (--m_activeRequests == 0) {
+        emit loadingChanged();
+    }
+}
+
+void ApiClient::recordServerOutcome(bool serverFailure) {
+    const bool wasAvailable = serverAvailable();
+    if (serverFailure) {
+        m_circuitBreaker.recordFailure();
+    } else {
+        m_circuitBreaker.recordSuccess();
+    }
+    if (serverAvailable() != wasAvailable) {
+        qInfo() << "ApiClient: server" << (wasAvailable ? "unavailable, failing fast" : "available again");
+        emit serverAvailableChanged();
+    }
+}
+
+void ApiClient::storeTlsSession(QNetworkReply* reply) {
+#if QT_CONFIG(ssl)
+    if (!m_tlsSessionCache || reply->url().scheme() != QLatin1String("https")) {
         return;
     }
+    // TLS 1.3 tickets arrive after the handshake, so the reply is checked
+    // when it finishes; an unchanged ticket is not written again
+    const QSslConfiguration config = reply->sslConfiguration();
+    m_tlsSessionCache->store(reply->url(), config.sessionTicket(), config.sessionTicketLifeTimeHint());
+#else
+    Q_UNUSED(reply);
+#endif
+}
 
-    setLoading(true);
+void ApiClient::forgetRequest(int requestId, const QString& endpointKey) {
+    m_requests.erase(requestId);
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply, onSuccess, onError]() {
-        setLoading(false);
-        reply->deleteLater();
+    const auto count = m_pendingByEndpoint.find(endpointKey);
+    if (count != m_pendingByEndpoint.end() && --*count == 0) {
+        m_pendingByEndpoint.erase(count);
+    }
+}
 
-        if (reply->error() != QNetworkReply::NoError) {
-            QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
-            QString errorMsg = doc.object().value("error").toString();
-            if (errorMsg.isEmpty()) {
-                errorMsg = reply->errorString();
+void ApiClient::schedule(const OperationPtr& operation, std::function<void()> start) {
+    operation->queuedTicket = m_scheduler.submit(operation->priority,
+        [this, operation, start = std::move(start)](RequestScheduler::Clock::duration waited) {
+            operation->queuedTicket = 0;
+            m_metrics.recordQueueWait(QLatin1String(RequestScheduler::priorityName(operation->priority)),
+                                      std::chrono::nanoseconds(waited).count());
+            start();
+        });
+}
+
+QVariantMap ApiClient::queueWaitSnapshot() const {
+    QVariantMap result = m_metrics.queueWaitSnapshot();
+    for (const RequestPriority priority : {RequestPriority::Interactive, RequestPriority::Normal,
+                                           RequestPriority::Background}) {
+        const QString name = QLatin1String(RequestScheduler::priorityName(priority));
+        QVariantMap entry = result.value(name).toMap();
+        entry.insert("active", m_scheduler.active(priority));
+        entry.insert("queued", m_scheduler.queued(priority));
+        result.insert(name, entry);
+    }
+    return result;
+}
+
+void ApiClient::setBackgroundConcurrency(int concurrency) {
+    m_scheduler.setLimits(m_scheduler.maxActive(), concurrency);
+}
+
+QVariantMap ApiClient::pendingByEndpoint() const {
+    QVariantMap result;
+    for (auto it = m_pendingByEndpoint.constBegin(); it != m_pendingByEndpoint.constEnd(); ++it) {
+        result.insert(it.key(), it.value());
+    }
+    return result;
+}
+
+void ApiClient::completeOperation(const OperationPtr& operation, const std::any* result,
+                                  const QString& error, int status)
+{
+    if (!operation->coalescingKey.isNull() && m_pendingCalls.value(operation->coalescingKey) == operation) {
+        m_pendingCalls.remove(operation->coalescingKey);
+    }
+
+    // Taken before any callback runs: a callback that repeats the request
+    // must start a new one
+    const std::map<int, ResultCallback> callers = std::exchange(operation->callers, {});
+    if (callers.empty()) {
+        return;
+    }
+    for (const auto& [requestId, callback] : callers) {
+        forgetRequest(requestId, operation->endpointKey);
+    }
+    emit pendingRequestsChanged();
+
+    QElapsedTimer dispatching;
+    dispatching.start();
+    for (const auto& [requestId, callback] : callers) {
+        callback(result, error, status);
+    }
+
+    if (result) {
+        m_metrics.record(operation->endpointKey, RequestMetrics::Phase::Dispatch, dispatching.nsecsElapsed());
+        m_metrics.record(operation->endpointKey, RequestMetrics::Phase::Total, operation->started.nsecsElapsed());
+    }
+}
+
+void ApiClient::cancel(int requestId) {
+    const auto bulk = m_bulkJobs.find(requestId);
+    if (bulk != m_bulkJobs.end()) {
+        const BulkJobPtr job = bulk->second;
+        m_bulkJobs.erase(bulk);
+        for (const int request : std::as_const(job->requests)) {
+            cancel(request);
+        }
+        return;
+    }
+
+    const auto sync = m_peerSyncs.find(requestId);
+    if (sync != m_peerSyncs.end()) {
+        const int step = sync->second;
+        m_peerSyncs.erase(sync);
+        cancel(step);
+        return;
+    }
+
+    const auto it = m_requests.find(requestId);
+    if (it == m_requests.end()) {
+        return;
+    }
+    const OperationPtr operation = it->second;
+
+    operation->callers.erase(requestId);
+    forgetRequest(requestId, operation->endpointKey);
+    emit pendingRequestsChanged();
+
+    if (!operation->callers.empty()) {
+        return;     // a coalesced caller still waits for the reply
+    }
+
+    operation->cancelled = true;
+    if (!operation->coalescingKey.isNull() && m_pendingCalls.value(operation->coalescingKey) == operation) {
+        m_pendingCalls.remove(operation->coalescingKey);
+    }
+    if (operation->queuedTicket) {
+        m_scheduler.cancel(std::exchange(operation->queuedTicket, 0));
+    }
+    if (operation->reply) {
+        operation->reply->abort();
+    }
+}
+
+template <typename Decoder, typename OnSuccess, typename OnError>
+int ApiClient::send(const ApiEndpoint<Decoder>& endpoint,
+                    const QString& pathArgument,
+                    const QJsonObject& body,
+                    OnSuccess onSuccess,
+                    OnError onError)
+{
+    using Result = typename Decoder::Result;
+
+    // An empty argument is valid (e.g. "since=" for the first sync)
+    const QString pathTemplate = QString::fromLatin1(endpoint.path);
+    const QString path = pathTemplate.contains(u"%1") ? pathTemplate.arg(pathArgument) : pathTemplate;
+
+    ResultCallback deliver = [onSuccess = std::move(onSuccess), onError = std::move(onError)](
+            const std::any* result, const QString& error, [[maybe_unused]] int status) {
+        if (result) {
+            onSuccess(std::any_cast<Result>(*result));
+        } else if constexpr (std::is_invocable_v<OnError&, const QString&, int>) {
+            onError(error, status);
+        } else {
+            onError(error);
+        }
+    };
+
+    const int requestId = m_nextRequestId++;
+
+    // A duplicate of an idempotent request that is still in flight waits
+    // for the outstanding reply instead of being sent again
+    QString coalescingKey;
+    if (endpoint.method == HttpMethod::Get) {
+        coalescingKey = coalescingKeyFor(endpoint.method, path, body);
+        const OperationPtr pending = m_pendingCalls.value(coalescingKey);
+        if (pending) {
+            // An interactive caller must not wait behind background work.
+            // The class is set first: a promoted request may start at once
+            if (pending->queuedTicket && endpoint.priority < pending->priority) {
+                pending->priority = endpoint.priority;
+                m_scheduler.promote(pending->queuedTicket, endpoint.priority);
             }
-            onError(errorMsg);
-            return;
+            pending->callers.emplace(requestId, std::move(deliver));
+            m_requests.emplace(requestId, pending);
+            ++m_pendingByEndpoint[pending->endpointKey];
+            ++m_coalescedRequests;
+            emit coalescedRequestsChanged();
+            emit pendingRequestsChanged();
+            return requestId;
         }
+    }
 
-        QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
-        onSuccess(doc.object());
+    static const char* const methodNames[] = {"GET", "POST", "PUT", "DELETE"};
+
+    auto operation = std::make_shared<Operation>();
+    operation->started.start();
+    operation->priority = endpoint.priority;
+    operation->coalescingKey = coalescingKey;
+    operation->endpointKey = QLatin1String(methodNames[static_cast<int>(endpoint.method)])
+                             + u' ' + QLatin1String(endpoint.path);
+    operation->callers.emplace(requestId, std::move(deliver));
+
+    if (!coalescingKey.isNull()) {
+        m_pendingCalls.insert(coalescingKey, operation);
+    }
+    m_requests.emplace(requestId, operation);
+    ++m_pendingByEndpoint[operation->endpointKey];
+    emit pendingRequestsChanged();
+
+    dispatch(endpoint, path, body, operation, false, 1);
+    return requestId;
+}
+
+template <typename Decoder>
+void ApiClient::dispatch(ApiEndpoint<Decoder> endpoint, const QString& path, const QJsonObject& body,
+                         const OperationPtr& operation, bool replayed, int attempt)
+{
+    // Cancelled while parked or waiting for a retry
+    if (operation->cancelled) {
+        return;
+    }
+
+    schedule(operation, [this, endpoint, path, body, operation, replayed, attempt]() {
+        sendOperation(endpoint, path, body, operation, replayed, attempt);
     });
 }
 
-void ApiClient::sendArrayRequest(
-    const QString& endpoint,
-    const QString& method,
-    const QJsonObject& body,
-    std::function<void(const QJsonArray&)> onSuccess,
-    std::function<void(const QString&)> onError)
+template <typename Decoder>
+void ApiClient::sendOperation(ApiEndpoint<Decoder> endpoint, const QString& path, const QJsonObject& body,
+                              const OperationPtr& operation, bool replayed, int attempt)
 {
-    QUrl url(m_serverUrl + endpoint);
-    QNetworkRequest request(url);
+    using Result = typename Decoder::Result;
 
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    // The scheduler slot is held until the reply finishes; a path that
+    // sends nothing gives it back at once
+    const auto release = [this, operation]() {
+        m_scheduler.finished(operation->priority);
+    };
 
-    if (!m_accessToken.isEmpty()) {
-        request.setRawHeader("Authorization", ("Bearer " + m_accessToken).toUtf8());
+    const auto replay = [this, endpoint, path, body, operation]() {
+        dispatch(endpoint, path, body, operation, true, 1);
+    };
+    const auto retry = [this, endpoint, path, body, operation, replayed, attempt]() {
+        dispatch(endpoint, path, body, operation, replayed, attempt + 1);
+    };
+    const auto fail = [this, operation](const QString& error) {
+        completeOperation(operation, nullptr, error);
+    };
+
+    // Sending with the token being replaced would only earn a 401
+    if (endpoint.auth == Auth::Required && m_refreshInProgress) {
+        m_parkedRequests.append({replay, fail});
+        release();
+        return;
     }
 
-    QNetworkReply* reply = nullptr;
+    // Errors are reported asynchronously, after the caller got the request id
+    if (!m_circuitBreaker.allowRequest()) {
+        QTimer::singleShot(0, this, [fail]() { fail("Server unavailable"); });
+        release();
+        return;
+    }
 
-    if (method == "GET") {
-        reply = m_networkManager.get(request);
-    } else if (method == "POST") {
-        reply = m_networkManager.post(request, QJsonDocument(body).toJson());
+    // The cached entry is copied: it may be evicted before the reply arrives
+    const bool conditional = endpoint.cachePolicy == CachePolicy::Conditional;
+    std::optional<CachedResponse> cached;
+    if (conditional) {
+        if (const CachedResponse* entry = m_responseCache.object(path)) {
+            cached = *entry;
+        }
     }
 
+    QNetworkReply* reply = startRequest(endpoint.method, path, body, endpoint.resilience.transferTimeoutMs,
+                                        operation->priority, cached ? &*cached : nullptr);
     if (!reply) {
-        onError("Failed to create request");
+        QTimer::singleShot(0, this, [fail]() { fail("Failed to create request"); });
+        release();
         return;
     }
+    operation->reply = reply;
+    const auto timing = timeReply(reply);
 
-    setLoading(true);
-
-    connect(reply, &QNetworkReply::finished, this, [this, reply, onSuccess, onError]() {
-        setLoading(false);
+    connect(reply, &QNetworkReply::finished, this,
+            [this, reply, endpoint, path, conditional, cached = std::move(cached),
+             operation, replayed, attempt, replay, retry, fail, release, timing,
+             sentAuthorization = m_authorizationHeader]() {
+        const qint64 finished = timing->clock.nsecsElapsed();
+        finishRequest(reply);
         reply->deleteLater();
+        operation->reply = nullptr;
+        release();
 
-        if (reply->error() != QNetworkReply::NoError) {
-            QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
-            QString errorMsg = doc.object().value("error").toString();
-            if (errorMsg.isEmpty()) {
-                errorMsg = reply->errorString();
+        // Nobody needs the result any more: dropped unread
+        if (operation->cancelled) {
+            return;
+        }
+
+        const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+        const bool serverFailure = isServerFailure(reply->error(), status);
+        recordServerOutcome(serverFailure);
+
+        // Transient failure of an idempotent request: retry after a jittered
+        // backoff, unless the breaker has just given up on the server
+        if (serverFailure && attempt < endpoint.resilience.maxAttempts && serverAvailable()) {
+            const int delay = endpoint.resilience.backoffDelayMs(
+                attempt + 1, QRandomGenerator::global()->generateDouble());
+            beginActivity();    // still loading while waiting
+            QTimer::singleShot(delay, this, [this, retry]() {
+                retry();
+                endActivity();
+            });
+            return;
+        }
+
+        // Expired token: park the request until one refresh completes. If
+        // the token has changed since this request was sent, the refresh
+        // already happened and the request is simply replayed
+        if (status == 401 && endpoint.auth == Auth::Required && !replayed && !m_refreshToken.isEmpty()) {
+            if (sentAuthorization != m_authorizationHeader && !m_refreshInProgress) {
+                replay();
+            } else {
+                m_parkedRequests.append({replay, fail});
+                startTokenRefresh();
             }
-            onError(errorMsg);
             return;
         }
 
-        QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
-        onSuccess(doc.array());
+        const QByteArray responseBody = reply->readAll();
+
+        if (reply->error() != QNetworkReply::NoError) {
+            completeOperation(operation, nullptr, replyError(reply, responseBody), status);
+            return;
+        }
+        recordNetworkPhases(m_metrics, operation->endpointKey, *timing, finished);
+
+        // 304 Not Modified: the body is empty, reuse the decoded object
+        if (cached && status == 304) {
+            ++m_cacheHits;
+            emit responseCacheChanged();
+            completeOperation(operation, &cached->value, QString());
+            return;
+        }
+
+        QElapsedTimer decoding;
+        decoding.start();
+        Result result{};
+        if (!Decoder::decode(responseBody, result)) {
+            fail("Invalid server response");
+            return;
+        }
+        m_metrics.record(operation->endpointKey, RequestMetrics::Phase::Decode, decoding.nsecsElapsed());
+
+        const std::any value(std::move(result));
+        if (conditional) {
+            ++m_cacheMisses;
+            storeResponse(path, reply, responseBody.size(), value);
+            emit responseCacheChanged();
+        }
+        completeOperation(operation, &value, QString());
     });
 }
 
-void ApiClient::login(const QString& username, const QString& password) {
+void ApiClient::setBulkConcurrency(int concurrency) {
+    concurrency = qBound(1, concurrency, 32);
+    if (m_bulkConcurrency != concurrency) {
+        m_bulkConcurrency = concurrency;
+        emit bulkConcurrencyChanged();
+    }
+}
+
+int ApiClient::createPeers(const QVariantList& devices) {
+    return startBulk(true, devices);
+}
+
+int ApiClient::deletePeers(const QStringList& peerIds) {
+    QVariantList items;
+    items.reserve(peerIds.size());
+    for (const QString& id : peerIds) {
+        items.append(id);
+    }
+    return startBulk(false, items);
+}
+
+int ApiClient::startBulk(bool create, const QVariantList& items) {
+    auto job = std::make_shared<BulkJob>();
+    job->id = m_nextRequestId++;
+    job->create = create;
+    job->items = items;
+    job->results = QVariantList(items.size());
+    m_bulkJobs.emplace(job->id, job);
+
+    if (items.isEmpty()) {
+        QTimer::singleShot(0, this, [this, job]() { finishBulk(job); });
+    } else if (m_bulkEndpointMissing || items.size() == 1) {
+        pumpBulk(job);
+    } else {
+        sendBulkRequest(job);
+    }
+    return job->id;
+}
+
+void ApiClient::sendBulkRequest(const BulkJobPtr& job) {
+    QJsonObject body;
+    if (job->create) {
+        QJsonArray peers;
+        for (const QVariant& item : std::as_const(job->items)) {
+            peers.append(createPeerBody(item));
+        }
+        body["peers"] = peers;
+    } else {
+        body["ids"] = QJsonArray::fromVariantList(job->items);
+    }
+
+    const auto onSuccess = [this, job](QJsonArray itemResults) {
+        job->requests.remove(-1);
+        for (qsizetype i = 0; i < job->items.size(); ++i) {
+            QVariantMap result = bulkItemResult(job->create, job->items[i]);
+            const QJsonObject obj = i < itemResults.size() ? itemResults.at(i).toObject() : QJsonObject();
+
+            if (i >= itemResults.size()) {
+                result["ok"] = false;
+                result["error"] = QStringLiteral("No result from server");
+            } else if (obj.contains(QLatin1String("error"))) {
+                result["ok"] = false;
+                result["error"] = obj.value(QLatin1String("error")).toString();
+            } else {
+                result["ok"] = true;
+                if (job->create) {
+                    result["peer"] = QVariant::fromValue(parsePeer(obj.value(QLatin1String("peer")).toObject()));
+                }
+            }
+            job->results[i] = result;
+        }
+        job->completed = static_cast<int>(job->items.size());
+        emit bulkProgress(job->id, job->completed, job->completed);
+        finishBulk(job);
+    };
+
+    const auto onError = [this, job](const QString& error, int status) {
+        job->requests.remove(-1);
+
+        // No bulk endpoint on this server: pipeline single requests
+        if (status == 404 || status == 405 || status == 501) {
+            m_bulkEndpointMissing = true;
+            pumpBulk(job);
+            return;
+        }
+
+        for (qsizetype i = 0; i < job->items.size(); ++i) {
+            QVariantMap result = bulkItemResult(job->create, job->items[i]);
+            result["ok"] = false;
+            result["error"] = error;
+            job->results[i] = result;
+        }
+        job->completed = static_cast<int>(job->items.size());
+        finishBulk(job);
+    };
+
+    job->requests.insert(-1, job->create
+        ? send(endpoints::BulkCreatePeers, QString(), body, onSuccess, onError)
+        : send(endpoints::BulkDeletePeers, QString(), body, onSuccess, onError));
+}
+
+void ApiClient::pumpBulk(const BulkJobPtr& job) {
+    while (job->requests.size() < m_bulkConcurrency && job->next < job->items.size()) {
+        const int index = job->next++;
+        const QVariant& item = job->items[index];
+
+        const auto onError = [this, job, index](const QString& error) {
+            QVariantMap result = bulkItemResult(job->create, job->items[index]);
+            result["ok"] = false;
+            result["error"] = error;
+            completeBulkItem(job, index, result);
+        };
+
+        int requestId = 0;
+        if (job->create) {
+            requestId = send(endpoints::BulkItemCreatePeer, QString(), createPeerBody(item),
+                [this, job, index](CreatedPeer created) {
+                    QVariantMap result = bulkItemResult(true, job->items[index]);
+                    result["ok"] = true;
+                    result["peer"] = QVariant::fromValue(created.peer);
+                    completeBulkItem(job, index, result);
+                },
+                onError);
+        } else {
+            requestId = send(endpoints::BulkItemDeletePeer, item.toString(), {},
+                [this, job, index](std::monostate) {
+                    QVariantMap result = bulkItemResult(false, job->items[index]);
+                    result["ok"] = true;
+                    completeBulkItem(job, index, result);
+                },
+                onError);
+        }
+        job->requests.insert(index, requestId);
+    }
+}
+
+void ApiClient::completeBulkItem(const BulkJobPtr& job, int index, const QVariantMap& result) {
+    job->requests.remove(index);
+    job->results[index] = result;
+    ++job->completed;
+    emit bulkProgress(job->id, job->completed, static_cast<int>(job->items.size()));
+
+    if (job->completed == job->items.size()) {
+        finishBulk(job);
+    } else {
+        pumpBulk(job);
+    }
+}
+
+void ApiClient::finishBulk(const BulkJobPtr& job) {
+    // Cancelled jobs report nothing
+    if (m_bulkJobs.erase(job->id) == 0) {
+        return;
+    }
+    emit bulkFinished(job->id, job->results);
+}
+
+void ApiClient::resetPeerSync() {
+    m_peerStore->clear();
+    m_peerRevision.clear();
+}
+
+QList<PeerInfo> ApiClient::syncedPeers() const {
+    return m_peerStore->peers().toList();
+}
+
+void ApiClient::publishPeerChanges(int changeCount, const QList<PeerInfo>& added,
+                                   const QList<PeerInfo>& updated, const QStringList& removed)
+{
+    for (const QString& id : removed) {
+        emit peerRemoved(id);
+    }
+    for (const PeerInfo& peer : updated) {
+        emit peerUpdated(peer);
+    }
+    for (const PeerInfo& peer : added) {
+        emit peerAdded(peer);
+    }
+    emit peersSynced(changeCount);
+}
+
+int ApiClient::syncPeers() {
+    const int syncId = m_nextRequestId++;
+    m_peerSyncs.emplace(syncId, 0);
+    sendPeerSyncStep(syncId);
+    return syncId;
+}
+
+void ApiClient::sendPeerSyncStep(int syncId) {
+    const auto sync = m_peerSyncs.find(syncId);
+    if (sync == m_peerSyncs.end()) {
+        return;     // cancelled
+    }
+    if (m_peerChangesMissing) {
+        sync->second = fetchPeerSnapshot(syncId);
+        return;
+    }
+
+    const QString since = QString::fromLatin1(QUrl::toPercentEncoding(m_peerRevision));
+
+    sync->second = send(endpoints::PeerChanges, since, {},
+        [this, syncId](PeerChanges delta) {
+            m_peerSyncs.erase(syncId);
+            const PeerStore::Changes changes = delta.full
+                ? m_peerStore->replace(delta.upserts)
+                : m_peerStore->apply(delta.upserts, delta.deleted);
+            m_peerRevision = delta.revision;
+            publishPeerChanges(changes.count(), changes.added, changes.updated, changes.removed);
+        },
+        [this, syncId](const QString& error, int status) {
+            if (status == 410 && !m_peerRevision.isEmpty()) {
+                // Revision rejected (expired on the server): start over
+                m_peerRevision.clear();
+                sendPeerSyncStep(syncId);
+            } else if (status == 404 || status == 405 || status == 501) {
+                m_peerChangesMissing = true;
+                sendPeerSyncStep(syncId);
+            } else {
+                m_peerSyncs.erase(syncId);
+                emit apiError(error);
+            }
+        }
+    );
+}
+
+// Full list through the conditional cache: an unchanged list costs a 304
+int ApiClient::fetchPeerSnapshot(int syncId) {
+    return send(endpoints::ListPeers, QString(), {},
+        [this, syncId](QList<PeerInfo> peers) {
+            m_peerSyncs.erase(syncId);
+            const PeerStore::Changes changes = m_peerStore->replace(peers);
+            publishPeerChanges(changes.count(), changes.added, changes.updated, changes.removed);
+        },
+        [this, syncId](const QString& error) {
+            m_peerSyncs.erase(syncId);
+            emit apiError(error);
+        }
+    );
+}
+
+PeerInfo ApiClient::parsePeer(const QJsonObject& obj) {
+    PeerInfo peer;
+    peer.id = obj.value(QLatin1String("id")).toString();
+    peer.deviceName = obj.value(QLatin1String("device_name")).toString();
+    peer.protocol = obj.value(QLatin1String("protocol")).toString();
+    peer.ipAddress = obj.value(QLatin1String("wg_ip_address")).toString();
+    peer.publicKey = obj.value(QLatin1String("wg_public_key")).toString();
+    peer.isActive = obj.value(QLatin1String("is_active")).toBool();
+    return peer;
+}
+
+QList<PeerInfo> ApiClient::parsePeers(const QJsonArray& array) {
+    QList<PeerInfo> peers;
+    peers.reserve(array.size());
+
+    for (const QJsonValue& val : array) {
+        peers.append(parsePeer(val.toObject()));
+    }
+
+    return peers;
+}
+
+int ApiClient::login(const QString& username, const QString& password) {
     QJsonObject body;
     body["username"] = username;
     body["password"] = password;
 
-    sendRequest("/api/auth/login", "POST", body,
-        [this](const QJsonObject& response) {
-            AuthTokens tokens;
-            tokens.accessToken = response["access_token"].toString();
-            tokens.refreshToken = response["refresh_token"].toString();
-            tokens.expiresIn = response["expires_in"].toInt();
-
-            m_accessToken = tokens.accessToken;
+    return send(endpoints::Login, QString(), body,
+        [this](AuthTokens tokens) {
             m_refreshToken = tokens.refreshToken;
+            m_refreshFailures = 0;
+            m_nextRefreshAllowed = 0;
+            setAccessToken(tokens.accessToken, tokens.expiresIn, true);
+            clearResponseCache();
+            resetPeerSync();
 
             emit authenticationChanged();
             emit loginSuccess(tokens);
@@ -153,14 +1371,14 @@ void ApiClient::login(const QString& username, const QString& password) {
     );
 }
 
-void ApiClient::registerUser(const QString& username, const QString& email, const QString& password) {
+int ApiClient::registerUser(const QString& username, const QString& email, const QString& password) {
     QJsonObject body;
     body["username"] = username;
     body["email"] = email;
     body["password"] = password;
 
-    sendRequest("/api/auth/register", "POST", body,
-        [this](const QJsonObject&) {
+    return send(endpoints::Register, QString(), body,
+        [this](std::monostate) {
             emit registerSuccess();
         },
         [this](const QString& error) {
@@ -170,55 +1388,26 @@ void ApiClient::registerUser(const QString& username, const QString& email, cons
 }
 
 void ApiClient::logout() {
-    m_accessToken.clear();
     m_refreshToken.clear();
+    m_refreshFailures = 0;
+    m_nextRefreshAllowed = 0;
+    setAccessToken(QString());
+    clearResponseCache();
+    resetPeerSync();
+    failParkedRequests("Logged out");
     emit authenticationChanged();
 }
 
 void ApiClient::refreshToken() {
-    QJsonObject body;
-    body["refresh_token"] = m_refreshToken;
-
-    sendRequest("/api/auth/refresh", "POST", body,
-        [this](const QJsonObject& response) {
-            AuthTokens tokens;
-            tokens.accessToken = response["access_token"].toString();
-            tokens.refreshToken = response["refresh_token"].toString();
-            tokens.expiresIn = response["expires_in"].toInt();
-
-            m_accessToken = tokens.accessToken;
-            m_refreshToken = tokens.refreshToken;
-
-            emit tokenRefreshed(tokens);
-        },
-        [this](const QString& error) {
-            emit apiError(error);
-        }
-    );
+    startTokenRefresh();
 }
 
-void ApiClient::createPeer(const QString& deviceName, const QString& publicKey) {
-    QJsonObject body;
-    body["device_name"] = deviceName;
-    body["protocol"] = "wireguard";
-    body["public_key"] = publicKey;
-
-    sendRequest("/api/vpn/peers", "POST", body,
-        [this](const QJsonObject& response) {
-            QJsonObject peerObj = response["peer"].toObject();
-
-            PeerInfo peer;
-            peer.id = peerObj["id"].toString();
-            peer.deviceName = peerObj["device_name"].toString();
-            peer.protocol = peerObj["protocol"].toString();
-            peer.ipAddress = peerObj["wg_ip_address"].toString();
-            peer.publicKey = peerObj["wg_public_key"].toString();
-            peer.isActive = peerObj["is_active"].toBool();
+int ApiClient::createPeer(const QString& deviceName, const QString& publicKey) {
+    const QJsonObject body = createPeerBody(deviceName, publicKey);
 
-            ServerConfig config;
-            QString configStr = response["config"].toString();
-
-            emit peerCreated(peer, config);
+    return send(endpoints::CreatePeer, QString(), body,
+        [this](CreatedPeer created) {
+            emit peerCreated(created.peer, created.config);
         },
         [this](const QString& error) {
             emit peerCreateError(error);
@@ -226,23 +1415,9 @@ void ApiClient::createPeer(const QString& deviceName, const QString& publicKey)
     );
 }
 
-void ApiClient::getPeers() {
-    sendArrayRequest("/api/vpn/peers", "GET", {},
-        [this](const QJsonArray& response) {
-            QList<PeerInfo> peers;
-
-            for (const QJsonValue& val : response) {
-                QJsonObject obj = val.toObject();
-                PeerInfo peer;
-                peer.id = obj["id"].toString();
-                peer.deviceName = obj["device_name"].toString();
-                peer.protocol = obj["protocol"].toString();
-                peer.ipAddress = obj["wg_ip_address"].toString();
-                peer.publicKey = obj["wg_public_key"].toString();
-                peer.isActive = obj["is_active"].toBool();
-                peers.append(peer);
-            }
-
+int ApiClient::getPeers() {
+    return send(endpoints::ListPeers, QString(), {},
+        [this](QList<PeerInfo> peers) {
             emit peersLoaded(peers);
         },
         [this](const QString& error) {
@@ -251,40 +1426,217 @@ void ApiClient::getPeers() {
     );
 }
 
-void ApiClient::deletePeer(const QString& peerId) {
-    sendRequest("/api/vpn/peers/" + peerId, "DELETE", {},
-        [this, peerId](const QJsonObject&) {
-            emit peerDeleted(peerId);
-        },
-        [this](const QString& error) {
+int ApiClient::loadPeersPaged(int pageSize) {
+    const int requestId = m_nextRequestId++;
+
+    auto operation = std::make_shared<Operation>();
+    operation->started.start();
+    operation->endpointKey = QStringLiteral("GET /api/vpn/peers?limit=%1&cursor=%2");
+    operation->callers.emplace(requestId, [this](const std::any* result, const QString& error, int) {
+        if (!result) {
             emit apiError(error);
         }
-    );
+    });
+
+    m_requests.emplace(requestId, operation);
+    ++m_pendingByEndpoint[operation->endpointKey];
+    emit pendingRequestsChanged();
+
+    fetchPeerPage(operation, requestId, qMax(pageSize, 1), QString(), false);
+    return requestId;
 }
 
-void ApiClient::getPeerConfig(const QString& peerId) {
-    QUrl url(m_serverUrl + "/api/vpn/peers/" + peerId + "/config");
-    QNetworkRequest request(url);
+void ApiClient::fetchPeerPage(const OperationPtr& operation, int requestId, int pageSize,
+                              const QString& cursor, bool replayed)
+{
+    if (operation->cancelled) {
+        return;
+    }
+
+    schedule(operation, [this, operation, requestId, pageSize, cursor, replayed]() {
+        sendPeerPage(operation, requestId, pageSize, cursor, replayed);
+    });
+}
+
+void ApiClient::sendPeerPage(const OperationPtr& operation, int requestId, int pageSize,
+                             const QString& cursor, bool replayed)
+{
+    const auto release = [this, operation]() {
+        m_scheduler.finished(operation->priority);
+    };
+    if (operation->cancelled) {
+        release();
+        return;
+    }
+
+    const auto again = [this, operation, requestId, pageSize, cursor]() {
+        fetchPeerPage(operation, requestId, pageSize, cursor, true);
+    };
+    const auto fail = [this, operation](const QString& error) {
+        completeOperation(operation, nullptr, error);
+    };
 
-    if (!m_accessToken.isEmpty()) {
-        request.setRawHeader("Authorization", ("Bearer " + m_accessToken).toUtf8());
+    if (m_refreshInProgress) {
+        m_parkedRequests.append({again, fail});
+        release();
+        return;
+    }
+    if (!m_circuitBreaker.allowRequest()) {
+        QTimer::singleShot(0, this, [fail]() { fail("Server unavailable"); });
+        release();
+        return;
     }
 
-    QNetworkReply* reply = m_networkManager.get(request);
-    setLoading(true);
+    QUrlQuery query;
+    query.addQueryItem(QStringLiteral("limit"), QString::number(pageSize));
+    if (!cursor.isEmpty()) {
+        query.addQueryItem(QStringLiteral("cursor"), cursor);
+    }
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply, peerId]() {
-        setLoading(false);
+    // Pages are not retried automatically: rows of a failed page may
+    // already be delivered
+    QNetworkReply* reply = startRequest(HttpMethod::Get,
+                                        QStringLiteral("/api/vpn/peers?") + query.toString(QUrl::FullyEncoded),
+                                        {}, policies::Read.transferTimeoutMs, operation->priority);
+    if (!reply) {
+        QTimer::singleShot(0, this, [fail]() { fail("Failed to create request"); });
+        release();
+        return;
+    }
+    operation->reply = reply;
+    const auto timing = timeReply(reply);
+
+    // Splits the array into elements as chunks arrive; only the element
+    // crossing a chunk boundary is buffered. Decoding overlaps the download,
+    // so the download phase of a page includes it. An element that is not a
+    // JSON object, or a broken array, makes the page invalid: nullopt
+    auto stream = std::make_shared<JsonArrayStream>();
+    auto decodeTime = std::make_shared<qint64>(0);
+    auto invalid = std::make_shared<bool>(false);
+    const auto decodeChunk = [stream, decodeTime, invalid](const QByteArray& chunk) -> std::optional<QList<PeerInfo>> {
+        QElapsedTimer decoding;
+        decoding.start();
+        QList<PeerInfo> batch;
+        const bool ok = stream->feed(std::string_view(chunk.constData(), static_cast<size_t>(chunk.size())),
+                                     [&batch, invalid](std::string_view element) {
+            if (*invalid) {
+                return;
+            }
+            const QByteArray json = QByteArray::fromRawData(element.data(), static_cast<qsizetype>(element.size()));
+            const QJsonDocument document = parseJson(json);
+            if (!document.isObject()) {
+                *invalid = true;
+                return;
+            }
+            batch.append(parsePeer(document.object()));
+        });
+        *decodeTime += decoding.nsecsElapsed();
+        if (!ok) {
+            *invalid = true;
+        }
+        if (*invalid) {
+            return std::nullopt;
+        }
+        return batch;
+    };
+
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply, operation, requestId, decodeChunk, invalid]() {
+        // Error bodies are left for the finished handler
+        if (operation->cancelled || *invalid
+            || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) {
+            return;
+        }
+        const std::optional<QList<PeerInfo>> batch = decodeChunk(reply->readAll());
+        if (!batch) {
+            // The rest of the page is not needed; finished reports the error
+            reply->abort();
+            return;
+        }
+        if (!batch->isEmpty()) {
+            emit peersBatchLoaded(requestId, *batch, false);
+        }
+    });
+
+    connect(reply, &QNetworkReply::finished, this,
+            [this, reply, operation, requestId, pageSize, cursor, replayed, stream, decodeChunk, decodeTime,
+             invalid, timing, again, fail, release]() {
+        const qint64 finished = timing->clock.nsecsElapsed();
+        finishRequest(reply);
         reply->deleteLater();
+        operation->reply = nullptr;
+        release();
+
+        if (operation->cancelled) {
+            return;
+        }
+        if (*invalid) {
+            fail("Invalid server response");
+            return;
+        }
+
+        const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        recordServerOutcome(isServerFailure(reply->error(), status));
+
+        // Nothing of a 401 page was delivered, so it can be replayed as is
+        if (status == 401 && !replayed && !m_refreshToken.isEmpty()) {
+            m_parkedRequests.append({again, fail});
+            startTokenRefresh();
+            return;
+        }
 
         if (reply->error() != QNetworkReply::NoError) {
-            emit apiError(reply->errorString());
+            completeOperation(operation, nullptr, replyError(reply, reply->readAll()), status);
+            return;
+        }
+
+        const std::optional<QList<PeerInfo>> batch = decodeChunk(reply->readAll());
+        if (!batch || !stream->finished()) {
+            fail("Invalid server response");
             return;
         }
+        recordNetworkPhases(m_metrics, operation->endpointKey, *timing, finished);
+        m_metrics.record(operation->endpointKey, RequestMetrics::Phase::Decode, *decodeTime);
 
-        QString config = QString::fromUtf8(reply->readAll());
-        emit peerConfigLoaded(peerId, config);
+        const QString nextCursor = QString::fromUtf8(reply->rawHeader(QByteArrayLiteral("X-Next-Cursor")));
+        if (nextCursor.isEmpty()) {
+            emit peersBatchLoaded(requestId, *batch, true);
+            const std::any done;
+            completeOperation(operation, &done, QString());
+            return;
+        }
+
+        // A cursor that does not move, or a page that is empty but not the
+        // last, would have us fetch the same page forever
+        if (nextCursor == cursor || batch->isEmpty()) {
+            fail("Invalid server response");
+            return;
+        }
+
+        emit peersBatchLoaded(requestId, *batch, false);
+        fetchPeerPage(operation, requestId, pageSize, nextCursor, false);
     });
 }
 
+int ApiClient::deletePeer(const QString& peerId) {
+    return send(endpoints::DeletePeer, peerId, {},
+        [this, peerId](std::monostate) {
+            emit peerDeleted(peerId);
+        },
+        [this](const QString& error) {
+            emit apiError(error);
+        }
+    );
+}
+
+int ApiClient::getPeerConfig(const QString& peerId) {
+    return send(endpoints::PeerConfig, peerId, {},
+        [this, peerId](QString config) {
+            emit peerConfigLoaded(peerId, config);
+        },
+        [this](const QString& error) {
+            emit apiError(error);
+        }
+    );
+}
+
 } // namespace obsidian
@@ -0,0 +1,246 @@
+#include "Blake2s.h"
+#include "WireGuardKeys.h"
+#include <algorithm>
+#include <cstring>
+
+namespace obsidian {
+
+namespace {
+
+constexpr std::array<uint32_t, 8> IV = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+    0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+constexpr uint8_t SIGMA[10][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
+    { 11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4 },
+    { 7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8 },
+    { 9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13 },
+    { 2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9 },
+    { 12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11 },
+    { 13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10 },
+    { 6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5 },
+    { 10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0 },
+};
+
+inline uint32_t load32_le(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline void store32_le(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+inline uint32_t rotr32(uint32_t v, int n) {
+    return (v >> n) | (v << (32 - n));
+}
+
+inline void G(uint32_t* v, int a, int b, int c, int d, uint32_t x, uint32_t y) {
+    v[a] = v[a] + v[b] + x;
+    v[d] = rotr32(v[d] ^ v[a], 16);
+    v[c] = v[c] + v[d];
+    v[b] = rotr32(v[b] ^ v[c], 12);
+    v[a] = v[a] + v[b] + y;
+    v[d] = rotr32(v[d] ^ v[a], 8);
+    v[c] = v[c] + v[d];
+    v[b] = rotr32(v[b] ^ v[c], 7);
+}
+
+} // anonymous namespace
+
+Blake2s::Blake2s(size_t outSize, std::span<const uint8_t> key)
+    : m_h(IV)
+    , m_outSize(std::clamp<size_t>(outSize, 1, HASH_SIZE))
+{
+    const size_t keySize = std::min(key.size(), MAX_KEY_SIZE);
+
+    // Parameter block: digest length, key length, fanout = depth = 1
+    m_h[0] ^= 0x01010000u ^ (static_cast<uint32_t>(keySize) << 8) ^ static_cast<uint32_t>(m_outSize);
+
+    if (keySize > 0) {
+        std::memcpy(m_buffer.data(), key.data(), keySize);
+        m_bufferSize = BLOCK_SIZE;
+    }
+}
+
+Blake2s::~Blake2s() {
+    WireGuardKeys::secureZero(m_buffer.data(), m_buffer.size());
+    WireGuardKeys::secureZero(m_h.data(), sizeof(m_h));
+}
+
+void Blake2s::compress(const uint8_t* block, bool last) {
+    uint32_t m[16];
+    uint32_t v[16];
+
+    for (int i = 0; i < 16; ++i) {
+        m[i] = load32_le(block + 4 * i);
+    }
+    for (int i = 0; i < 8; ++i) {
+        v[i] = m_h[i];
+        v[i + 8] = IV[i];
+    }
+    v[12] ^= m_t[0];
+    v[13] ^= m_t[1];
+    if (last) {
+        v[14] = ~v[14];
+    }
+
+    // Раунды развёрнуты, чтобы индексы SIGMA были константами компиляции
+#define BLAKE2S_ROUND(r)                                               \
+    G(v, 0, 4, 8, 12, m[SIGMA[r][0]], m[SIGMA[r][1]]);                 \
+    G(v, 1, 5, 9, 13, m[SIGMA[r][2]], m[SIGMA[r][3]]);                 \
+    G(v, 2, 6, 10, 14, m[SIGMA[r][4]], m[SIGMA[r][5]]);                \
+    G(v, 3, 7, 11, 15, m[SIGMA[r][6]], m[SIGMA[r][7]]);                \
+    G(v, 0, 5, 10, 15, m[SIGMA[r][8]], m[SIGMA[r][9]]);                \
+    G(v, 1, 6, 11, 12, m[SIGMA[r][10]], m[SIGMA[r][11]]);              \
+    G(v, 2, 7, 8, 13, m[SIGMA[r][12]], m[SIGMA[r][13]]);               \
+    G(v, 3, 4, 9, 14, m[SIGMA[r][14]], m[SIGMA[r][15]])
+
+    BLAKE2S_ROUND(0);
+    BLAKE2S_ROUND(1);
+    BLAKE2S_ROUND(2);
+    BLAKE2S_ROUND(3);
+    BLAKE2S_ROUND(4);
+    BLAKE2S_ROUND(5);
+    BLAKE2S_ROUND(6);
+    BLAKE2S_ROUND(7);
+    BLAKE2S_ROUND(8);
+    BLAKE2S_ROUND(9);
+
+#undef BLAKE2S_ROUND
+
+    for (int i = 0; i < 8; ++i) {
+        m_h[i] ^= v[i] ^ v[i + 8];
+    }
+}
+
+void Blake2s::update(std::span<const uint8_t> data) {
+    const uint8_t* in = data.data();
+    size_t length = data.size();
+
+    while (length > 0) {
+        // Последний блок сжимается только в final(), поэтому полный
+        // буфер сбрасывается лишь при поступлении новых данных
+        if (m_bufferSize == BLOCK_SIZE) {
+            m_t[0] += BLOCK_SIZE;
+            if (m_t[0] < BLOCK_SIZE) ++m_t[1];
+            compress(m_buffer.data(), false);
+            m_bufferSize = 0;
+        }
+
+        // Полные блоки, за которыми есть ещё данные, сжимаются напрямую из входа
+        if (m_bufferSize == 0) {
+            while (length > BLOCK_SIZE) {
+                m_t[0] += BLOCK_SIZE;
+                if (m_t[0] < BLOCK_SIZE) ++m_t[1];
+                compress(in, false);
+                in += BLOCK_SIZE;
+                length -= BLOCK_SIZE;
+            }
+        }
+
+        const size_t take = std::min(length, BLOCK_SIZE - m_bufferSize);
+        std::memcpy(m_buffer.data() + m_bufferSize, in, take);
+        m_bufferSize += take;
+        in += take;
+        length -= take;
+    }
+}
+
+void Blake2s::final(std::span<uint8_t> out) {
+    m_t[0] += static_cast<uint32_t>(m_bufferSize);
+    if (m_t[0] < m_bufferSize) ++m_t[1];
+
+    std::fill(m_buffer.begin() + static_cast<std::ptrdiff_t>(m_bufferSize), m_buffer.end(), uint8_t(0));
+    compress(m_buffer.data(), true);
+
+    uint8_t digest[HASH_SIZE];
+    for (int i = 0; i < 8; ++i) {
+        store32_le(digest + 4 * i, m_h[i]);
+    }
+    std::memcpy(out.data(), digest, std::min(out.size(), m_outSize));
+    WireGuardKeys::secureZero(digest, sizeof(digest));
+}
+
+Blake2s::Hash Blake2s::hash(std::span<const uint8_t> data) {
+    Hash out;
+    hash(out, data);
+    return out;
+}
+
+void Blake2s::hash(std::span<uint8_t> out, std::span<const uint8_t> data,
+                   std::span<const uint8_t> key)
+{
+    Blake2s state(out.size(), key);
+    state.update(data);
+    state.final(out);
+}
+
+Blake2s::Hash Blake2s::hmac(std::span<const uint8_t> key, std::span<const uint8_t> data) {
+    std::array<uint8_t, BLOCK_SIZE> block{};
+
+    if (key.size() > BLOCK_SIZE) {
+        const Hash keyHash = hash(key);
+        std::memcpy(block.data(), keyHash.data(), keyHash.size());
+    } else {
+        std::memcpy(block.data(), key.data(), key.size());
+    }
+
+    for (auto& b : block) b ^= 0x36;
+    Blake2s inner;
+    inner.update(block);
+    inner.update(data);
+    Hash innerHash;
+    inner.final(innerHash);
+
+    for (auto& b : block) b ^= 0x36 ^ 0x5c;
+    Blake2s outer;
+    outer.update(block);
+    outer.update(innerHash);
+    Hash result;
+    outer.final(result);
+
+    WireGuardKeys::secureZero(block.data(), block.size());
+    WireGuardKeys::secureZero(innerHash.data(), innerHash.size());
+    return result;
+}
+
+void Blake2s::hkdf(std::span<const uint8_t> key,
+                   std::span<const uint8_t> input,
+                   Hash& out1,
+                   Hash* out2,
+                   Hash* out3)
+{
+    Hash prk = hmac(key, input);
+
+    std::array<uint8_t, HASH_SIZE + 1> chained;
+    chained[0] = 0x01;
+    out1 = hmac(prk, std::span(chained).first(1));
+
+    if (out2 || out3) {
+        Hash t2;
+        std::memcpy(chained.data(), out1.data(), HASH_SIZE);
+        chained[HASH_SIZE] = 0x02;
+        t2 = hmac(prk, chained);
+
+        if (out3) {
+            std::memcpy(chained.data(), t2.data(), HASH_SIZE);
+            chained[HASH_SIZE] = 0x03;
+            *out3 = hmac(prk, chained);
+        }
+        if (out2) {
+            *out2 = t2;
+        }
+        WireGuardKeys::secureZero(t2.data(), t2.size());
+    }
+
+    WireGuardKeys::secureZero(prk.data(), prk.size());
+    WireGuardKeys::secureZero(chained.data(), chained.size());
+}
+
+} // namespace obsidian
@@ -0,0 +1,626 @@
+#include "ChaCha20Poly1305.h"
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define OBSIDIAN_CHACHA_X86 1
+#include <immintrin.h>
+#endif
+
+namespace obsidian {
+
+namespace {
+
+constexpr size_t CHACHA_BLOCK_SIZE = 64;
+
+inline uint32_t load32_le(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline void store32_le(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+inline uint64_t load64_le(const uint8_t* p) {
+    return uint64_t(load32_le(p)) | (uint64_t(load32_le(p + 4)) << 32);
+}
+
+inline void store64_le(uint8_t* p, uint64_t v) {
+    store32_le(p, static_cast<uint32_t>(v));
+    store32_le(p + 4, static_cast<uint32_t>(v >> 32));
+}
+
+inline uint32_t rotl32(uint32_t v, int n) {
+    return (v << n) | (v >> (32 - n));
+}
+
+// ---------------------------------------------------------------------------
+// ChaCha20
+
+// Начальное состояние: константы, ключ, счётчик (слово 12), nonce (слова 13..15)
+using ChaChaState = std::array<uint32_t, 16>;
+
+ChaChaState chachaInit(const ChaCha20Poly1305::Key& key, const uint8_t* nonce, uint32_t counter) {
+    ChaChaState s;
+    s[0] = 0x61707865;
+    s[1] = 0x3320646e;
+    s[2] = 0x79622d32;
+    s[3] = 0x6b206574;
+    for (int i = 0; i < 8; ++i) {
+        s[4 + i] = load32_le(key.data() + 4 * i);
+    }
+    s[12] = counter;
+    s[13] = load32_le(nonce);
+    s[14] = load32_le(nonce + 4);
+    s[15] = load32_le(nonce + 8);
+    return s;
+}
+
+#define CHACHA_QR(a, b, c, d)                   \
+    a += b; d ^= a; d = rotl32(d, 16);          \
+    c += d; b ^= c; b = rotl32(b, 12);          \
+    a += b; d ^= a; d = rotl32(d, 8);           \
+    c += d; b ^= c; b = rotl32(b, 7)
+
+void chachaRounds(uint32_t x[16]) {
+    for (int i = 0; i < 10; ++i) {
+        CHACHA_QR(x[0], x[4], x[8], x[12]);
+        CHACHA_QR(x[1], x[5], x[9], x[13]);
+        CHACHA_QR(x[2], x[6], x[10], x[14]);
+        CHACHA_QR(x[3], x[7], x[11], x[15]);
+        CHACHA_QR(x[0], x[5], x[10], x[15]);
+        CHACHA_QR(x[1], x[6], x[11], x[12]);
+        CHACHA_QR(x[2], x[7], x[8], x[13]);
+        CHACHA_QR(x[3], x[4], x[9], x[14]);
+    }
+}
+
+#undef CHACHA_QR
+
+void chachaBlock(uint8_t out[CHACHA_BLOCK_SIZE], const ChaChaState& s) {
+    uint32_t x[16];
+    std::copy(s.begin(), s.end(), x);
+    chachaRounds(x);
+    for (int i = 0; i < 16; ++i) {
+        store32_le(out + 4 * i, x[i] + s[i]);
+    }
+}
+
+// Скалярный путь: любое число байт, включая неполный последний блок
+void chachaXorScalar(uint8_t* data, size_t length, ChaChaState& s) {
+    uint8_t block[CHACHA_BLOCK_SIZE];
+    while (length > 0) {
+        chachaBlock(block, s);
+        ++s[12];
+
+        const size_t n = std::min(length, CHACHA_BLOCK_SIZE);
+        for (size_t i = 0; i < n; ++i) {
+            data[i] ^= block[i];
+        }
+        data += n;
+        length -= n;
+    }
+    std::fill(std::begin(block), std::end(block), uint8_t(0));
+}
+
+#ifdef OBSIDIAN_CHACHA_X86
+
+// Многоблочные ядра: регистр x[i] содержит слово i состояния для 4 (SSSE3)
+// или 8 (AVX2) соседних блоков, после раундов слова транспонируются обратно
+
+__attribute__((target("ssse3")))
+inline __m128i rotl16_128(__m128i v) {
+    return _mm_shuffle_epi8(v, _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+}
+
+__attribute__((target("ssse3")))
+inline __m128i rotl8_128(__m128i v) {
+    return _mm_shuffle_epi8(v, _mm_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14));
+}
+
+#define CHACHA_QR_128(a, b, c, d)                                                       \
+    a = _mm_add_epi32(a, b); d = rotl16_128(_mm_xor_si128(d, a));                       \
+    c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c);                                   \
+    b = _mm_or_si128(_mm_slli_epi32(b, 12), _mm_srli_epi32(b, 20));                     \
+    a = _mm_add_epi32(a, b); d = rotl8_128(_mm_xor_si128(d, a));                        \
+    c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c);                                   \
+    b = _mm_or_si128(_mm_slli_epi32(b, 7), _mm_srli_epi32(b, 25))
+
+// 4 блока = 256 байт
+__attribute__((target("ssse3")))
+void chachaXor4Ssse3(uint8_t* data, const ChaChaState& s) {
+    __m128i x[16];
+    __m128i orig[16];
+    for (int i = 0; i < 16; ++i) {
+        orig[i] = _mm_set1_epi32(static_cast<int>(s[i]));
+    }
+    orig[12] = _mm_add_epi32(orig[12], _mm_setr_epi32(0, 1, 2, 3));
+    std::copy(std::begin(orig), std::end(orig), x);
+
+    for (int i = 0; i < 10; ++i) {
+        CHACHA_QR_128(x[0], x[4], x[8], x[12]);
+        CHACHA_QR_128(x[1], x[5], x[9], x[13]);
+        CHACHA_QR_128(x[2], x[6], x[10], x[14]);
+        CHACHA_QR_128(x[3], x[7], x[11], x[15]);
+        CHACHA_QR_128(x[0], x[5], x[10], x[15]);
+        CHACHA_QR_128(x[1], x[6], x[11], x[12]);
+        CHACHA_QR_128(x[2], x[7], x[8], x[13]);
+        CHACHA_QR_128(x[3], x[4], x[9], x[14]);
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        x[i] = _mm_add_epi32(x[i], orig[i]);
+    }
+
+    // Транспонирование 4x4 для каждой группы из 4 слов
+    for (int a = 0; a < 16; a += 4) {
+        const __m128i t0 = _mm_unpacklo_epi32(x[a], x[a + 1]);
+        const __m128i t1 = _mm_unpacklo_epi32(x[a + 2], x[a + 3]);
+        const __m128i t2 = _mm_unpackhi_epi32(x[a], x[a + 1]);
+        const __m128i t3 = _mm_unpackhi_epi32(x[a + 2], x[a + 3]);
+        const __m128i blocks[4] = {
+            _mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1),
+            _mm_unpacklo_epi64(t2, t3), _mm_unpackhi_epi64(t2, t3),
+        };
+        for (int b = 0; b < 4; ++b) {
+            __m128i* p = reinterpret_cast<__m128i*>(data + b * CHACHA_BLOCK_SIZE + a * 4);
+            _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), blocks[b]));
+        }
+    }
+}
+
+#undef CHACHA_QR_128
+
+__attribute__((target("avx2")))
+inline __m256i rotl16_256(__m256i v) {
+    return _mm256_shuffle_epi8(v, _mm256_setr_epi8(
+        2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+        2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+}
+
+__attribute__((target("avx2")))
+inline __m256i rotl8_256(__m256i v) {
+    return _mm256_shuffle_epi8(v, _mm256_setr_epi8(
+        3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+        3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14));
+}
+
+#define CHACHA_QR_256(a, b, c, d)                                                       \
+    a = _mm256_add_epi32(a, b); d = rotl16_256(_mm256_xor_si256(d, a));                 \
+    c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c);                             \
+    b = _mm256_or_si256(_mm256_slli_epi32(b, 12), _mm256_srli_epi32(b, 20));            \
+    a = _mm256_add_epi32(a, b); d = rotl8_256(_mm256_xor_si256(d, a));                  \
+    c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c);                             \
+    b = _mm256_or_si256(_mm256_slli_epi32(b, 7), _mm256_srli_epi32(b, 25))
+
+// 8 блоков = 512 байт
+__attribute__((target("avx2")))
+void chachaXor8Avx2(uint8_t* data, const ChaChaState& s) {
+    __m256i x[16];
+    __m256i orig[16];
+    for (int i = 0; i < 16; ++i) {
+        orig[i] = _mm256_set1_epi32(static_cast<int>(s[i]));
+    }
+    orig[12] = _mm256_add_epi32(orig[12], _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    std::copy(std::begin(orig), std::end(orig), x);
+
+    for (int i = 0; i < 10; ++i) {
+        CHACHA_QR_256(x[0], x[4], x[8], x[12]);
+        CHACHA_QR_256(x[1], x[5], x[9], x[13]);
+        CHACHA_QR_256(x[2], x[6], x[10], x[14]);
+        CHACHA_QR_256(x[3], x[7], x[11], x[15]);
+        CHACHA_QR_256(x[0], x[5], x[10], x[15]);
+        CHACHA_QR_256(x[1], x[6], x[11], x[12]);
+        CHACHA_QR_256(x[2], x[7], x[8], x[13]);
+        CHACHA_QR_256(x[3], x[4], x[9], x[14]);
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        x[i] = _mm256_add_epi32(x[i], orig[i]);
+    }
+
+    // Транспонирование внутри 128-битных половин: для группы слов a
+    // y[b] содержит слова a..a+3 блока b (нижняя половина) и блока b + 4 (верхняя)
+    __m256i y[4][4];
+    for (int g = 0; g < 4; ++g) {
+        const int a = g * 4;
+        const __m256i t0 = _mm256_unpacklo_epi32(x[a], x[a + 1]);
+        const __m256i t1 = _mm256_unpacklo_epi32(x[a + 2], x[a + 3]);
+        const __m256i t2 = _mm256_unpackhi_epi32(x[a], x[a + 1]);
+        const __m256i t3 = _mm256_unpackhi_epi32(x[a + 2], x[a + 3]);
+        y[g][0] = _mm256_unpacklo_epi64(t0, t1);
+        y[g][1] = _mm256_unpackhi_epi64(t0, t1);
+        y[g][2] = _mm256_unpacklo_epi64(t2, t3);
+        y[g][3] = _mm256_unpackhi_epi64(t2, t3);
+    }
+
+    for (int b = 0; b < 4; ++b) {
+        const __m256i lo01 = _mm256_permute2x128_si256(y[0][b], y[1][b], 0x20);
+        const __m256i lo23 = _mm256_permute2x128_si256(y[2][b], y[3][b], 0x20);
+        const __m256i hi01 = _mm256_permute2x128_si256(y[0][b], y[1][b], 0x31);
+        const __m256i hi23 = _mm256_permute2x128_si256(y[2][b], y[3][b], 0x31);
+
+        __m256i* p = reinterpret_cast<__m256i*>(data + b * CHACHA_BLOCK_SIZE);
+        _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), lo01));
+        _mm256_storeu_si256(p + 1, _mm256_xor_si256(_mm256_loadu_si256(p + 1), lo23));
+
+        __m256i* q = reinterpret_cast<__m256i*>(data + (b + 4) * CHACHA_BLOCK_SIZE);
+        _mm256_storeu_si256(q, _mm256_xor_si256(_mm256_loadu_si256(q), hi01));
+        _mm256_storeu_si256(q + 1, _mm256_xor_si256(_mm256_loadu_si256(q + 1), hi23));
+    }
+}
+
+#undef CHACHA_QR_256
+
+#endif // OBSIDIAN_CHACHA_X86
+
+enum class ChaChaKernel { Scalar, Ssse3, Avx2 };
+
+ChaChaKernel selectChaChaKernel() {
+#ifdef OBSIDIAN_CHACHA_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return ChaChaKernel::Avx2;
+    if (__builtin_cpu_supports("ssse3")) return ChaChaKernel::Ssse3;
+#endif
+    return ChaChaKernel::Scalar;
+}
+
+ChaChaKernel chachaKernel() {
+    static const ChaChaKernel kernel = selectChaChaKernel();
+    return kernel;
+}
+
+void chachaXor(uint8_t* data, size_t length, ChaChaState& s) {
+#ifdef OBSIDIAN_CHACHA_X86
+    const ChaChaKernel kernel = chachaKernel();
+    if (kernel == ChaChaKernel::Avx2) {
+        while (length >= 8 * CHACHA_BLOCK_SIZE) {
+            chachaXor8Avx2(data, s);
+            s[12] += 8;
+            data += 8 * CHACHA_BLOCK_SIZE;
+            length -= 8 * CHACHA_BLOCK_SIZE;
+        }
+    }
+    if (kernel != ChaChaKernel::Scalar) {
+        while (length >= 4 * CHACHA_BLOCK_SIZE) {
+            chachaXor4Ssse3(data, s);
+            s[12] += 4;
+            data += 4 * CHACHA_BLOCK_SIZE;
+            length -= 4 * CHACHA_BLOCK_SIZE;
+        }
+    }
+#endif
+    chachaXorScalar(data, length, s);
+}
+
+// ---------------------------------------------------------------------------
+// Poly1305, 44/44/42-битные limbs (poly1305-donna-64)
+
+using uint128 = unsigned __int128;
+
+class Poly1305 {
+public:
+    explicit Poly1305(const uint8_t key[32]) {
+        const uint64_t t0 = load64_le(key);
+        const uint64_t t1 = load64_le(key + 8);
+
+        // r &= 0xffffffc0ffffffc0ffffffc0fffffff
+        m_r[0] = t0 & 0xffc0fffffffULL;
+        m_r[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffffULL;
+        m_r[2] = (t1 >> 24) & 0x00ffffffc0fULL;
+
+        m_pad[0] = load64_le(key + 16);
+        m_pad[1] = load64_le(key + 24);
+    }
+
+    ~Poly1305() {
+        WireGuardKeys::secureZero(this, sizeof(*this));
+    }
+
+    void update(const uint8_t* data, size_t length) {
+        if (m_leftover > 0) {
+            const size_t take = std::min(length, BLOCK - m_leftover);
+            std::memcpy(m_buffer + m_leftover, data, take);
+            m_leftover += take;
+            data += take;
+            length -= take;
+            if (m_leftover < BLOCK) return;
+            blocks(m_buffer, BLOCK, HIBIT);
+            m_leftover = 0;
+        }
+
+        const size_t full = length & ~(BLOCK - 1);
+        if (full > 0) {
+            blocks(data, full, HIBIT);
+            data += full;
+            length -= full;
+        }
+
+        if (length > 0) {
+            std::memcpy(m_buffer, data, length);
+            m_leftover = length;
+        }
+    }
+
+    // Дополнение нулями до границы 16 байт (формат AEAD из RFC 8439)
+    void pad16() {
+        if (m_leftover > 0) {
+            std::memset(m_buffer + m_leftover, 0, BLOCK - m_leftover);
+            blocks(m_buffer, BLOCK, HIBIT);
+            m_leftover = 0;
+        }
+    }
+
+    void final(uint8_t mac[16]) {
+        if (m_leftover > 0) {
+            m_buffer[m_leftover] = 1;
+            std::memset(m_buffer + m_leftover + 1, 0, BLOCK - m_leftover - 1);
+            blocks(m_buffer, BLOCK, 0);
+        }
+
+        uint64_t h0 = m_h[0], h1 = m_h[1], h2 = m_h[2];
+        uint64_t c;
+
+        c = h1 >> 44; h1 &= MASK44;
+        h2 += c;      c = h2 >> 42; h2 &= MASK42;
+        h0 += c * 5;  c = h0 >> 44; h0 &= MASK44;
+        h1 += c;      c = h1 >> 44; h1 &= MASK44;
+        h2 += c;      c = h2 >> 42; h2 &= MASK42;
+        h0 += c * 5;  c = h0 >> 44; h0 &= MASK44;
+        h1 += c;
+
+        // g = h + 5 - 2^130; выбираем h или g без ветвлений
+        uint64_t g0 = h0 + 5; c = g0 >> 44; g0 &= MASK44;
+        uint64_t g1 = h1 + c; c = g1 >> 44; g1 &= MASK44;
+        uint64_t g2 = h2 + c - (uint64_t(1) << 42);
+
+        c = (g2 >> 63) - 1;
+        g0 &= c; g1 &= c; g2 &= c;
+        c = ~c;
+        h0 = (h0 & c) | g0;
+        h1 = (h1 & c) | g1;
+        h2 = (h2 & c) | g2;
+
+        // mac = (h + pad) mod 2^128
+        const uint64_t t0 = m_pad[0];
+        const uint64_t t1 = m_pad[1];
+
+        h0 += t0 & MASK44;                                  c = h0 >> 44; h0 &= MASK44;
+        h1 += (((t0 >> 44) | (t1 << 20)) & MASK44) + c;     c = h1 >> 44; h1 &= MASK44;
+        h2 += ((t1 >> 24) & MASK42) + c;                    h2 &= MASK42;
+
+        store64_le(mac, h0 | (h1 << 44));
+        store64_le(mac + 8, (h1 >> 20) | (h2 << 24));
+    }
+
+private:
+    static constexpr size_t BLOCK = 16;
+    static constexpr uint64_t MASK44 = 0xfffffffffffULL;
+    static constexpr uint64_t MASK42 = 0x3ffffffffffULL;
+    static constexpr uint64_t HIBIT = uint64_t(1) << 40;
+
+    void blocks(const uint8_t* m, size_t length, uint64_t hibit) {
+        const uint64_t r0 = m_r[0], r1 = m_r[1], r2 = m_r[2];
+        const uint64_t s1 = r1 * (5 << 2);
+        const uint64_t s2 = r2 * (5 << 2);
+        uint64_t h0 = m_h[0], h1 = m_h[1], h2 = m_h[2];
+
+        while (length >= BLOCK) {
+            const uint64_t t0 = load64_le(m);
+            const uint64_t t1 = load64_le(m + 8);
+
+            h0 += t0 & MASK44;
+            h1 += ((t0 >> 44) | (t1 << 20)) & MASK44;
+            h2 += (((t1 >> 24)) & MASK42) | hibit;
+
+            const uint128 d0 = uint128(h0) * r0 + uint128(h1) * s2 + uint128(h2) * s1;
+            uint128 d1 = uint128(h0) * r1 + uint128(h1) * r0 + uint128(h2) * s2;
+            uint128 d2 = uint128(h0) * r2 + uint128(h1) * r1 + uint128(h2) * r0;
+
+            uint64_t c = static_cast<uint64_t>(d0 >> 44); h0 = static_cast<uint64_t>(d0) & MASK44;
+            d1 += c; c = static_cast<uint64_t>(d1 >> 44); h1 = static_cast<uint64_t>(d1) & MASK44;
+            d2 += c; c = static_cast<uint64_t>(d2 >> 42); h2 = static_cast<uint64_t>(d2) & MASK42;
+            h0 += c * 5; c = h0 >> 44; h0 &= MASK44;
+            h1 += c;
+
+            m += BLOCK;
+            length -= BLOCK;
+        }
+
+        m_h[0] = h0;
+        m_h[1] = h1;
+        m_h[2] = h2;
+    }
+
+    uint64_t m_r[3];
+    uint64_t m_h[3] = {0, 0, 0};
+    uint64_t m_pad[2];
+    uint8_t m_buffer[BLOCK];
+    size_t m_leftover = 0;
+};
+
+// Тег AEAD: Poly1305(ad || pad16 || ciphertext || pad16 || len(ad) || len(ct))
+void aeadTag(uint8_t tag[16],
+             std::span<const uint8_t> associatedData,
+             const uint8_t* ciphertext, size_t length,
+             const ChaCha20Poly1305::Key& key, const uint8_t* nonce)
+{
+    ChaChaState s = chachaInit(key, nonce, 0);
+    uint8_t block0[CHACHA_BLOCK_SIZE];
+    chachaBlock(block0, s);
+
+    Poly1305 mac(block0);
+    mac.update(associatedData.data(), associatedData.size());
+    mac.pad16();
+    mac.update(ciphertext, length);
+    mac.pad16();
+
+    uint8_t lengths[16];
+    store64_le(lengths, associatedData.size());
+    store64_le(lengths + 8, length);
+    mac.update(lengths, sizeof(lengths));
+    mac.final(tag);
+
+    WireGuardKeys::secureZero(block0, sizeof(block0));
+    WireGuardKeys::secureZero(s.data(), sizeof(s));
+}
+
+bool constantTimeEqual(const uint8_t* a, const uint8_t* b, size_t length) {
+    uint8_t diff = 0;
+    for (size_t i = 0; i < length; ++i) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+bool sealImpl(std::span<uint8_t> buffer, std::span<const uint8_t> associatedData,
+              const uint8_t* nonce, const ChaCha20Poly1305::Key& key)
+{
+    if (buffer.size() < ChaCha20Poly1305::TAG_SIZE) {
+        return false;
+    }
+    const size_t length = buffer.size() - ChaCha20Poly1305::TAG_SIZE;
+
+    ChaChaState s = chachaInit(key, nonce, 1);
+    chachaXor(buffer.data(), length, s);
+    WireGuardKeys::secureZero(s.data(), sizeof(s));
+
+    aeadTag(buffer.data() + length, associatedData, buffer.data(), length, key, nonce);
+    return true;
+}
+
+bool openImpl(std::span<uint8_t> buffer, std::span<const uint8_t> associatedData,
+              const uint8_t* nonce, const ChaCha20Poly1305::Key& key)
+{
+    if (buffer.size() < ChaCha20Poly1305::TAG_SIZE) {
+        return false;
+    }
+    const size_t length = buffer.size() - ChaCha20Poly1305::TAG_SIZE;
+
+    uint8_t expected[ChaCha20Poly1305::TAG_SIZE];
+    aeadTag(expected, associatedData, buffer.data(), length, key, nonce);
+    if (!constantTimeEqual(expected, buffer.data() + length, sizeof(expected))) {
+        return false;
+    }
+
+    ChaChaState s = chachaInit(key, nonce, 1);
+    chachaXor(buffer.data(), length, s);
+    WireGuardKeys::secureZero(s.data(), sizeof(s));
+    return true;
+}
+
+// XChaCha20: подключ HChaCha20(key, nonce[0..16)), nonce = 0^4 || nonce[16..24)
+ChaCha20Poly1305::Nonce xchachaSubNonce(const ChaCha20Poly1305::XNonce& nonce) {
+    ChaCha20Poly1305::Nonce sub{};
+    std::memcpy(sub.data() + 4, nonce.data() + 16, 8);
+    return sub;
+}
+
+} // anonymous namespace
+
+ChaCha20Poly1305::Nonce ChaCha20Poly1305::counterNonce(uint64_t counter) {
+    Nonce nonce{};
+    store64_le(nonce.data() + 4, counter);
+    return nonce;
+}
+
+bool ChaCha20Poly1305::seal(std::span<uint8_t> buffer,
+                            std::span<const uint8_t> associatedData,
+                            const Nonce& nonce,
+                            const Key& key)
+{
+    return sealImpl(buffer, associatedData, nonce.data(), key);
+}
+
+bool ChaCha20Poly1305::open(std::span<uint8_t> buffer,
+                            std::span<const uint8_t> associatedData,
+                            const Nonce& nonce,
+                            const Key& key)
+{
+    return openImpl(buffer, associatedData, nonce.data(), key);
+}
+
+bool ChaCha20Poly1305::xseal(std::span<uint8_t> buffer,
+                             std::span<const uint8_t> associatedData,
+                             const XNonce& nonce,
+                             const Key& key)
+{
+    Key subKey = hchacha20(key, std::span<const uint8_t, 16>(nonce.data(), 16));
+    const bool ok = sealImpl(buffer, associatedData, xchachaSubNonce(nonce).data(), subKey);
+    WireGuardKeys::secureZero(subKey.data(), subKey.size());
+    return ok;
+}
+
+bool ChaCha20Poly1305::xopen(std::span<uint8_t> buffer,
+                             std::span<const uint8_t> associatedData,
+                             const XNonce& nonce,
+                             const Key& key)
+{
+    Key subKey = hchacha20(key, std::span<const uint8_t, 16>(nonce.data(), 16));
+    const bool ok = openImpl(buffer, associatedData, xchachaSubNonce(nonce).data(), subKey);
+    WireGuardKeys::secureZero(subKey.data(), subKey.size());
+    return ok;
+}
+
+void ChaCha20Poly1305::chacha20Xor(std::span<uint8_t> data,
+                                   const Key& key,
+                                   const Nonce& nonce,
+                                   uint32_t counter)
+{
+    ChaChaState s = chachaInit(key, nonce.data(), counter);
+    chachaXor(data.data(), data.size(), s);
+    WireGuardKeys::secureZero(s.data(), sizeof(s));
+}
+
+void ChaCha20Poly1305::xchacha20Xor(std::span<uint8_t> data,
+                                    const Key& key,
+                                    const XNonce& nonce,
+                                    uint32_t counter)
+{
+    Key subKey = hchacha20(key, std::span<const uint8_t, 16>(nonce.data(), 16));
+    chacha20Xor(data, subKey, xchachaSubNonce(nonce), counter);
+    WireGuardKeys::secureZero(subKey.data(), subKey.size());
+}
+
+ChaCha20Poly1305::Key ChaCha20Poly1305::hchacha20(const Key& key, std::span<const uint8_t, 16> nonce) {
+    // Состояние как у ChaCha20, но слова 12..15 - это 16 байт nonce
+    ChaChaState s = chachaInit(key, nonce.data() + 4, load32_le(nonce.data()));
+
+    uint32_t x[16];
+    std::copy(s.begin(), s.end(), x);
+    chachaRounds(x);
+
+    Key out;
+    for (int i = 0; i < 4; ++i) {
+        store32_le(out.data() + 4 * i, x[i]);
+        store32_le(out.data() + 16 + 4 * i, x[12 + i]);
+    }
+
+    WireGuardKeys::secureZero(x, sizeof(x));
+    WireGuardKeys::secureZero(s.data(), sizeof(s));
+    return out;
+}
+
+std::array<uint8_t, ChaCha20Poly1305::TAG_SIZE> ChaCha20Poly1305::poly1305(
+    std::span<const uint8_t> data, const Key& oneTimeKey)
+{
+    std::array<uint8_t, TAG_SIZE> tag;
+    Poly1305 mac(oneTimeKey.data());
+    mac.update(data.data(), data.size());
+    mac.final(tag.data());
+    return tag;
+}
+
+const char* ChaCha20Poly1305::chachaKernelName() {
+    switch (chachaKernel()) {
+    case ChaChaKernel::Avx2: return "avx2";
+    case ChaChaKernel::Ssse3: return "ssse3";
+    case ChaChaKernel::Scalar: break;
+    }
+    return "scalar";
+}
+
+} // namespace obsidian
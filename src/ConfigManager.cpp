@@ -30,6 +30,16 @@ QString ConfigManager::configFilePath(const QString& peerId) {
     return configDirectory() + "/wg0.conf";
 }
 
+QString ConfigManager::tlsSessionCachePath() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation)
+           + "/tls_sessions.json";
+}
+
+QString ConfigManager::metricsFilePath() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation)
+           + "/metrics.prom";
+}
+
 QString ConfigManager::serverUrl() const {
     return m_settings.value("server/url", "http://127.0.0.1:8081").toString();
 }
@@ -63,6 +73,30 @@ void ConfigManager::setCurrentPeerId(const QString& peerId) {
     }
 }
 
+int ConfigManager::keyPoolSize() const {
+    return m_settings.value("keys/poolSize", 4).toInt();
+}
+
+std::optional<bool> ConfigManager::http2Enabled() const {
+    const QVariant value = m_settings.value("network/http2");
+    if (!value.isValid()) {
+        return std::nullopt;
+    }
+    return value.toBool();
+}
+
+int ConfigManager::bulkConcurrency() const {
+    return m_settings.value("network/bulkConcurrency", 4).toInt();
+}
+
+int ConfigManager::backgroundConcurrency() const {
+    return m_settings.value("network/backgroundConcurrency", 2).toInt();
+}
+
+int ConfigManager::metricsInterval() const {
+    return m_settings.value("diagnostics/metricsInterval", 0).toInt();
+}
+
 void ConfigManager::saveTokens(const QString& accessToken, const QString& refreshToken) {
     // В продакшене использовать безопасное хранилище (Keychain/Credential Manager)
     m_settings.setValue("auth/accessToken", accessToken);
@@ -0,0 +1,202 @@
+#include "HandshakeProbe.h"
+#include <QUdpSocket>
+#include <QTimer>
+#include <QUrl>
+#include <QRandomGenerator>
+
+namespace obsidian {
+
+namespace {
+
+std::optional<WireGuardHandshake::Key> decodeKey(const QString& base64) {
+    const QByteArray latin1 = base64.trimmed().toLatin1();
+    WireGuardHandshake::Key key;
+    if (!WireGuardKeys::fromBase64(std::string_view(latin1.constData(), latin1.size()), key)) {
+        return std::nullopt;
+    }
+    return key;
+}
+
+} // anonymous namespace
+
+HandshakeProbe::HandshakeProbe(QObject* parent)
+    : QObject(parent)
+{
+}
+
+HandshakeProbe::~HandshakeProbe() {
+    for (auto& [id, probe] : m_probes) {
+        if (probe.lookupId >= 0) {
+            QHostInfo::abortHostLookup(probe.lookupId);
+        }
+    }
+}
+
+int HandshakeProbe::probe(const QString& endpoint,
+                          const QString& serverPublicKey,
+                          const QString& privateKey,
+                          const QString& presharedKey,
+                          int timeoutMs)
+{
+    const int probeId = m_nextProbeId++;
+    Probe& entry = m_probes[probeId];
+    entry.endpoint = endpoint;
+    emit pendingProbesChanged();
+
+    auto fail = [this, probeId](const QString& error) {
+        QTimer::singleShot(0, this, [this, probeId, error]() {
+            finish(probeId, false, -1.0, error);
+        });
+        return probeId;
+    };
+
+    // QUrl разбирает и "host:port", и "[ipv6]:port"
+    const QUrl url("udp://" + endpoint.trimmed());
+    if (!url.isValid() || url.host().isEmpty() || url.port() <= 0) {
+        return fail("Invalid endpoint: " + endpoint);
+    }
+    entry.port = static_cast<quint16>(url.port());
+
+    const auto serverKey = decodeKey(serverPublicKey);
+    auto localKey = decodeKey(privateKey);
+    if (!serverKey || !localKey) {
+        return fail("Invalid key");
+    }
+
+    WireGuardHandshake::Key psk{};
+    if (!presharedKey.trimmed().isEmpty()) {
+        auto decoded = decodeKey(presharedKey);
+        if (!decoded) {
+            WireGuardKeys::secureZero(localKey->data(), localKey->size());
+            return fail("Invalid preshared key");
+        }
+        psk = *decoded;
+        WireGuardKeys::secureZero(decoded->data(), decoded->size());
+    }
+
+    entry.handshake = std::make_unique<WireGuardHandshake>(*localKey, *serverKey, psk);
+    WireGuardKeys::secureZero(localKey->data(), localKey->size());
+    WireGuardKeys::secureZero(psk.data(), psk.size());
+
+    // Таймаут покрывает и разрешение имени, и ожидание ответа
+    entry.timer = new QTimer(this);
+    entry.timer->setSingleShot(true);
+    connect(entry.timer, &QTimer::timeout, this, [this, probeId]() {
+        finish(probeId, false, -1.0, "Handshake timed out");
+    });
+    entry.timer->start(qMax(1, timeoutMs));
+
+    entry.lookupId = QHostInfo::lookupHost(url.host(), this, [this, probeId](const QHostInfo& info) {
+        onHostResolved(probeId, info);
+    });
+
+    return probeId;
+}
+
+void HandshakeProbe::cancel(int probeId) {
+    finish(probeId, false, -1.0, "Cancelled");
+}
+
+void HandshakeProbe::onHostResolved(int probeId, const QHostInfo& info) {
+    auto it = m_probes.find(probeId);
+    if (it == m_probes.end()) {
+        return;
+    }
+    Probe& probe = it->second;
+    probe.lookupId = -1;
+
+    if (info.error() != QHostInfo::NoError || info.addresses().isEmpty()) {
+        finish(probeId, false, -1.0, "Host lookup failed: " + info.errorString());
+        return;
+    }
+
+    std::array<uint8_t, WireGuardHandshake::INITIATION_SIZE> initiation;
+    if (!probe.handshake->createInitiation(QRandomGenerator::system()->generate(), initiation)) {
+        finish(probeId, false, -1.0, "Failed to create handshake initiation");
+        return;
+    }
+
+    // "Подключённый" UDP-сокет принимает датаграммы только от сервера,
+    // а ICMP port unreachable приходит как ConnectionRefusedError
+    probe.socket = new QUdpSocket(this);
+    connect(probe.socket, &QUdpSocket::readyRead, this, [this, probeId]() {
+        onReadyRead(probeId);
+    });
+    connect(probe.socket, &QUdpSocket::errorOccurred, this, [this, probeId](QAbstractSocket::SocketError) {
+        auto it = m_probes.find(probeId);
+        if (it != m_probes.end()) {
+            finish(probeId, false, -1.0, it->second.socket->errorString());
+        }
+    });
+
+    probe.socket->connectToHost(info.addresses().first(), probe.port);
+    probe.elapsed.start();
+    const qint64 written = probe.socket->write(reinterpret_cast<const char*>(initiation.data()),
+                                               static_cast<qint64>(initiation.size()));
+    if (written != static_cast<qint64>(initiation.size())) {
+        finish(probeId, false, -1.0, "Failed to send handshake initiation");
+    }
+}
+
+void HandshakeProbe::onReadyRead(int probeId) {
+    auto it = m_probes.find(probeId);
+    if (it == m_probes.end()) {
+        return;
+    }
+    Probe& probe = it->second;
+
+    while (probe.socket->hasPendingDatagrams()) {
+        const double rttMs = probe.elapsed.nsecsElapsed() / 1e6;
+
+        const qint64 pending = probe.socket->pendingDatagramSize();
+        QByteArray datagram(static_cast<int>(qMax<qint64>(0, pending)), Qt::Uninitialized);
+        const qint64 size = probe.socket->readDatagram(datagram.data(), datagram.size());
+        if (size < 0) {
+            continue;
+        }
+
+        const auto status = probe.handshake->consumeResponse(std::span<const uint8_t>(
+            reinterpret_cast<const uint8_t*>(datagram.constData()), static_cast<size_t>(size)));
+
+        switch (status) {
+        case WireGuardHandshake::ResponseStatus::Valid:
+            finish(probeId, true, rttMs, QString());
+            return;
+        case WireGuardHandshake::ResponseStatus::CookieReply:
+            // Сервер жив, но под нагрузкой: рукопожатие без cookie не завершить
+            finish(probeId, false, rttMs, "Server is under load (cookie reply)");
+            return;
+        case WireGuardHandshake::ResponseStatus::Invalid:
+            // Посторонние пакеты игнорируем, ждём до таймаута
+            break;
+        }
+    }
+}
+
+void HandshakeProbe::finish(int probeId, bool success, double rttMs, const QString& error) {
+    auto it = m_probes.find(probeId);
+    if (it == m_probes.end()) {
+        return;
+    }
+
+    Probe probe = std::move(it->second);
+    m_probes.erase(it);
+
+    if (probe.lookupId >= 0) {
+        QHostInfo::abortHostLookup(probe.lookupId);
+    }
+    // Вызов может прийти из слотов самих сокета и таймера
+    if (probe.socket) {
+        probe.socket->disconnect(this);
+        probe.socket->deleteLater();
+    }
+    if (probe.timer) {
+        probe.timer->stop();
+        probe.timer->deleteLater();
+    }
+
+    emit probeFinished(probeId, probe.endpoint, success, rttMs, error);
+    emit pendingProbesChanged();
+}
+
+} // namespace obsidian
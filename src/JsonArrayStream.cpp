@@ -0,0 +1,127 @@
+#include "JsonArrayStream.h"
+
+namespace obsidian {
+
+namespace {
+
+bool isJsonSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+} // anonymous namespace
+
+void JsonArrayStream::emitElement(std::string_view chunk, size_t begin, size_t end,
+                                  const ElementHandler& onElement)
+{
+    // Trailing whitespace of a scalar element ("1 ,")
+    while (end > begin && isJsonSpace(chunk[end - 1])) {
+        --end;
+    }
+
+    if (m_partial.empty()) {
+        onElement(chunk.substr(begin, end - begin));
+    } else {
+        m_partial.append(chunk.substr(begin, end - begin));
+        while (!m_partial.empty() && isJsonSpace(m_partial.back())) {
+            m_partial.pop_back();
+        }
+        onElement(m_partial);
+        m_partial.clear();
+    }
+}
+
+bool JsonArrayStream::feed(std::string_view chunk, const ElementHandler& onElement) {
+    size_t elementBegin = 0;
+
+    for (size_t i = 0; i < chunk.size() && m_state != State::Error; ++i) {
+        const char c = chunk[i];
+
+        switch (m_state) {
+        case State::BeforeArray:
+            if (c == '[') {
+                m_state = State::BeforeFirstElement;
+            } else if (!isJsonSpace(c) && c != '\xEF' && c != '\xBB' && c != '\xBF') {    // UTF-8 BOM
+                m_state = State::Error;
+            }
+            break;
+
+        case State::BeforeFirstElement:
+        case State::BeforeElement:
+            if (isJsonSpace(c)) {
+                break;
+            }
+            if (c == ']' && m_state == State::BeforeFirstElement) {
+                m_state = State::Done;
+                break;
+            }
+            if (c == ',' || c == ']' || c == '}') {
+                m_state = State::Error;
+                break;
+            }
+            m_state = State::InElement;
+            elementBegin = i;
+            m_depth = 0;
+            m_inString = false;
+            m_escape = false;
+            [[fallthrough]];
+
+        case State::InElement:
+            if (m_inString) {
+                if (m_escape) {
+                    m_escape = false;
+                } else if (c == '\\') {
+                    m_escape = true;
+                } else if (c == '"') {
+                    m_inString = false;
+                    if (m_depth == 0) {     // string element
+                        emitElement(chunk, elementBegin, i + 1, onElement);
+                        m_state = State::AfterElement;
+                    }
+                }
+            } else if (c == '"') {
+                m_inString = true;
+            } else if (c == '{' || c == '[') {
+                ++m_depth;
+            } else if (c == '}' || c == ']') {
+                if (m_depth == 0) {
+                    // ']' right after a scalar element closes the array
+                    emitElement(chunk, elementBegin, i, onElement);
+                    m_state = c == ']' ? State::Done : State::Error;
+                } else if (--m_depth == 0) {
+                    emitElement(chunk, elementBegin, i + 1, onElement);
+                    m_state = State::AfterElement;
+                }
+            } else if (c == ',' && m_depth == 0) {
+                emitElement(chunk, elementBegin, i, onElement);
+                m_state = State::BeforeElement;
+            }
+            break;
+
+        case State::AfterElement:
+            if (c == ',') {
+                m_state = State::BeforeElement;
+            } else if (c == ']') {
+                m_state = State::Done;
+            } else if (!isJsonSpace(c)) {
+                m_state = State::Error;
+            }
+            break;
+
+        case State::Done:
+            if (!isJsonSpace(c)) {
+                m_state = State::Error;
+            }
+            break;
+
+        case State::Error:
+            break;
+        }
+    }
+
+    if (m_state == State::InElement) {
+        m_partial.append(chunk.substr(elementBegin));
+    }
+    return m_state != State::Error;
+}
+
+} // namespace obsidian
@@ -0,0 +1,108 @@
+#include "KeyPool.h"
+#include <QMutexLocker>
+
+namespace obsidian {
+
+KeyPool::KeyPool(int capacity, QObject* parent)
+    : QObject(parent)
+    , m_capacity(static_cast<size_t>(qMax(0, capacity)))
+    , m_worker(QThread::create([this]() { refillLoop(); }))
+{
+    m_worker->setObjectName("KeyPoolWorker");
+    // Пул пополняется только когда системе больше нечего делать
+    m_worker->start(QThread::IdlePriority);
+}
+
+KeyPool::~KeyPool() {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_needKeys.wakeAll();
+    }
+    m_worker->wait();
+
+    // Неиспользованные приватные ключи не должны остаться в памяти процесса
+    for (auto& keyPair : m_keys) {
+        WireGuardKeys::secureZero(keyPair);
+    }
+    m_keys.clear();
+}
+
+int KeyPool::capacity() const {
+    QMutexLocker locker(&m_mutex);
+    return static_cast<int>(m_capacity);
+}
+
+void KeyPool::setCapacity(int capacity) {
+    const size_t newCapacity = static_cast<size_t>(qMax(0, capacity));
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_capacity == newCapacity) {
+            return;
+        }
+        m_capacity = newCapacity;
+
+        while (m_keys.size() > m_capacity) {
+            WireGuardKeys::secureZero(m_keys.back());
+            m_keys.pop_back();
+        }
+        m_needKeys.wakeAll();
+    }
+    emit capacityChanged();
+}
+
+int KeyPool::available() const {
+    QMutexLocker locker(&m_mutex);
+    return static_cast<int>(m_keys.size());
+}
+
+std::optional<KeyPair> KeyPool::take() {
+    std::optional<KeyPair> result;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_keys.empty()) {
+            result = m_keys.front();
+            WireGuardKeys::secureZero(m_keys.front());
+            m_keys.pop_front();
+            m_needKeys.wakeAll();
+        }
+    }
+
+    if (result) {
+        m_hits.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+    }
+    emit statsChanged();
+
+    return result;
+}
+
+void KeyPool::refillLoop() {
+    QMutexLocker locker(&m_mutex);
+
+    while (!m_stopping) {
+        if (m_keys.size() >= m_capacity) {
+            m_needKeys.wait(&m_mutex);
+            continue;
+        }
+
+        // Скалярное умножение выполняется без блокировки
+        locker.unlock();
+        auto keyPair = WireGuardKeys::generateKeyPair();
+        locker.relock();
+
+        if (!keyPair) {
+            // Источник энтропии недоступен: не крутимся впустую
+            m_needKeys.wait(&m_mutex, 1000);
+            continue;
+        }
+
+        if (!m_stopping && m_keys.size() < m_capacity) {
+            m_keys.push_back(*keyPair);
+        }
+        WireGuardKeys::secureZero(*keyPair);
+    }
+}
+
+} // namespace obsidian
@@ -0,0 +1,67 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace obsidian {
+
+size_t LatencyHistogram::bucketIndex(uint64_t micros) noexcept {
+    micros = std::min(micros, MAX_VALUE);
+    if (micros < SUB_BUCKETS) {
+        return static_cast<size_t>(micros);     // exact below SUB_BUCKETS
+    }
+    // Power of two of the value, then its top SUB_BUCKET_BITS bits below the leading one
+    const int exponent = static_cast<int>(std::bit_width(micros)) - 1;
+    const int shift = exponent - SUB_BUCKET_BITS;
+    const uint64_t subBucket = (micros >> shift) - SUB_BUCKETS;
+    return static_cast<size_t>((shift + 1) * SUB_BUCKETS + subBucket);
+}
+
+uint64_t LatencyHistogram::bucketHighestValue(size_t index) noexcept {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    const int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+    const uint64_t lowest = (SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    return lowest + (uint64_t(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t micros) noexcept {
+    m_buckets[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(micros, std::memory_order_relaxed);
+
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (max < micros && !m_max.compare_exchange_weak(max, micros, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::percentile(double q) const noexcept {
+    const uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * total)));
+    const uint64_t max = maxMicros();
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(bucketHighestValue(i), max);
+        }
+    }
+    // A sample counted in m_count but not yet in its bucket
+    return max;
+}
+
+void LatencyHistogram::reset() noexcept {
+    for (std::atomic<uint64_t>& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+} // namespace obsidian
@@ -0,0 +1,321 @@
+#include "PeerListModel.h"
+#include <QSet>
+#include <utility>
+#include <vector>
+
+namespace obsidian {
+
+namespace {
+
+// Roles of the PeerTable::Field bits of PeerTable::differences()
+QList<int> changedRoles(int fields) {
+    QList<int> roles;
+    if (fields & PeerTable::DeviceName) {
+        roles.append(PeerListModel::DeviceNameRole);
+    }
+    if (fields & PeerTable::Protocol) {
+        roles.append(PeerListModel::ProtocolRole);
+    }
+    if (fields & PeerTable::IpAddress) {
+        roles.append(PeerListModel::IpAddressRole);
+    }
+    if (fields & PeerTable::PublicKey) {
+        roles.append(PeerListModel::PublicKeyRole);
+    }
+    if (fields & PeerTable::Active) {
+        roles.append(PeerListModel::IsActiveRole);
+    }
+    return roles;
+}
+
+} // anonymous namespace
+
+PeerListModel::PeerListModel(QObject* parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int PeerListModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : count();
+}
+
+QVariant PeerListModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_peers.size()) {
+        return QVariant();
+    }
+    const qsizetype row = index.row();
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case DeviceNameRole:
+        return m_peers.deviceName(row);
+    case PeerIdRole:
+        return m_peers.id(row);
+    case ProtocolRole:
+        return m_peers.protocol(row);
+    case IpAddressRole:
+        return m_peers.ipAddress(row);
+    case PublicKeyRole:
+        return m_peers.publicKey(row);
+    case IsActiveRole:
+        return m_peers.isActive(row);
+    case IsCurrentDeviceRole:
+        return !m_currentPeerId.isEmpty() && m_peers.idEquals(row, m_currentPeerId);
+    case SelectedRole:
+        return !m_selectedPeerId.isEmpty() && m_peers.idEquals(row, m_selectedPeerId);
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> PeerListModel::roleNames() const {
+    return {
+        {PeerIdRole, "peerId"},
+        {DeviceNameRole, "deviceName"},
+        {ProtocolRole, "protocol"},
+        {IpAddressRole, "ipAddress"},
+        {PublicKeyRole, "publicKey"},
+        {IsActiveRole, "isActive"},
+        {IsCurrentDeviceRole, "isCurrentDevice"},
+        {SelectedRole, "selected"},
+    };
+}
+
+QVariantMap PeerListModel::get(int row) const {
+    QVariantMap result;
+    const QModelIndex modelIndex = index(row);
+    if (!modelIndex.isValid()) {
+        return result;
+    }
+    const QHash<int, QByteArray> names = roleNames();
+    for (auto it = names.constBegin(); it != names.constEnd(); ++it) {
+        result.insert(QString::fromLatin1(it.value()), data(modelIndex, it.key()));
+    }
+    return result;
+}
+
+void PeerListModel::emitRowChanged(const QString& peerId, int role) {
+    const int row = indexOf(peerId);
+    if (row >= 0) {
+        emit dataChanged(index(row), index(row), {role});
+    }
+}
+
+void PeerListModel::setPeers(const QList<PeerInfo>& peers) {
+    const int oldCount = count();
+    const bool hadCurrentPeer = hasCurrentPeer();
+
+    // The server sends every id once; a repeated one would break the walk
+    // below, so only its first occurrence is kept
+    QSet<QString> ids;
+    ids.reserve(peers.size());
+    QList<PeerInfo> unique;
+    bool repeated = false;
+    for (qsizetype i = 0; i < peers.size(); ++i) {
+        if (!ids.contains(peers[i].id)) {
+            ids.insert(peers[i].id);
+            if (repeated) {
+                unique.append(peers[i]);
+            }
+        } else if (!repeated) {
+            repeated = true;
+            unique = peers.first(i);
+        }
+    }
+    const QList<PeerInfo>& target = repeated ? unique : peers;
+
+    // Rows still in target, marked through the index of the shown ones
+    std::vector<bool> kept(m_peers.size());
+    for (const PeerInfo& peer : target) {
+        const int row = indexOf(peer.id);
+        if (row >= 0) {
+            kept[row] = true;
+        }
+    }
+
+    // Removed rows, in contiguous ranges from the end so that the row
+    // numbers of the ranges still to go stay valid
+    for (qsizetype row = m_peers.size() - 1; row >= 0;) {
+        if (kept[row]) {
+            --row;
+            continue;
+        }
+        qsizetype first = row;
+        while (first > 0 && !kept[first - 1]) {
+            --first;
+        }
+        beginRemoveRows(QModelIndex(), static_cast<int>(first), static_cast<int>(row));
+        m_peers.remove(first, row - first + 1);
+        endRemoveRows();
+        row = first - 1;
+    }
+
+    // Which peers of target were shown; the walk below moves rows, so the
+    // index is not asked during it
+    m_index.rebuild(m_peers);
+    std::vector<bool> shown(target.size());
+    for (qsizetype i = 0; i < target.size(); ++i) {
+        shown[i] = contains(target[i].id);
+    }
+
+    // The rows before `row` match target; the ones from `row` on are the
+    // peers of target[row..] that were already shown, in their old order
+    for (qsizetype row = 0; row < target.size();) {
+        const PeerInfo& peer = target[row];
+
+        if (row < m_peers.size() && m_peers.idEquals(row, peer.id)) {
+            updateRow(static_cast<int>(row), peer);
+            ++row;
+            continue;
+        }
+
+        if (!shown[row]) {
+            qsizetype last = row;
+            while (last + 1 < target.size() && !shown[last + 1]) {
+                ++last;
+            }
+            beginInsertRows(QModelIndex(), static_cast<int>(row), static_cast<int>(last));
+            m_peers.insert(row, target.sliced(row, last - row + 1));
+            endInsertRows();
+            row = last + 1;
+            continue;
+        }
+
+        // Shown further down: moved up here. Reordering is rare, so the
+        // old row is searched for
+        qsizetype from = row + 1;
+        while (!m_peers.idEquals(from, peer.id)) {
+            ++from;
+        }
+        beginMoveRows(QModelIndex(), static_cast<int>(from), static_cast<int>(from),
+                      QModelIndex(), static_cast<int>(row));
+        m_peers.move(from, row);
+        endMoveRows();
+
+        updateRow(static_cast<int>(row), peer);
+        ++row;
+    }
+    m_index.rebuild(m_peers);
+
+    if (count() != oldCount) {
+        emit countChanged();
+    }
+    if (hasCurrentPeer() != hadCurrentPeer) {
+        emit hasCurrentPeerChanged();
+    }
+}
+
+void PeerListModel::beginLoad(int requestId) {
+    m_loadId = requestId;
+    m_incoming.clear();
+    m_streaming = m_peers.isEmpty();
+}
+
+void PeerListModel::addBatch(int requestId, const QList<PeerInfo>& peers, bool last) {
+    if (requestId != m_loadId) {
+        return;
+    }
+    if (m_streaming) {
+        appendPeers(peers);
+    }
+    m_incoming.append(peers);
+
+    if (last) {
+        m_streaming = false;
+        m_loadId = 0;
+        setPeers(std::exchange(m_incoming, {}));
+    }
+}
+
+void PeerListModel::upsertPeer(const PeerInfo& peer) {
+    appendPeers({peer});
+}
+
+void PeerListModel::appendPeers(const QList<PeerInfo>& peers) {
+    const bool hadCurrentPeer = hasCurrentPeer();
+
+    // New peers are inserted as one range
+    QList<PeerInfo> fresh;
+    QHash<QString, qsizetype> freshRows;    // id -> position in fresh
+    for (const PeerInfo& peer : peers) {
+        const int row = indexOf(peer.id);
+        if (row >= 0) {
+            updateRow(row, peer);
+        } else if (const auto it = freshRows.constFind(peer.id); it != freshRows.constEnd()) {
+            fresh[*it] = peer;              // repeated within peers
+        } else {
+            freshRows.insert(peer.id, fresh.size());
+            fresh.append(peer);
+        }
+    }
+    if (fresh.isEmpty()) {
+        return;
+    }
+
+    const int first = count();
+    beginInsertRows(QModelIndex(), first, first + static_cast<int>(fresh.size()) - 1);
+    m_peers.append(fresh);
+    for (qsizetype row = first; row < m_peers.size(); ++row) {
+        m_index.insert(m_peers, row);
+    }
+    endInsertRows();
+
+    emit countChanged();
+    if (hasCurrentPeer() != hadCurrentPeer) {
+        emit hasCurrentPeerChanged();
+    }
+}
+
+void PeerListModel::updateRow(int row, const PeerInfo& peer) {
+    const QList<int> roles = changedRoles(m_peers.differences(row, peer));
+    if (!roles.isEmpty()) {
+        m_peers.replace(row, peer);
+        emit dataChanged(index(row), index(row), roles);
+    }
+}
+
+void PeerListModel::removePeer(const QString& peerId) {
+    const int row = indexOf(peerId);
+    if (row < 0) {
+        return;
+    }
+
+    const bool hadCurrentPeer = hasCurrentPeer();
+    beginRemoveRows(QModelIndex(), row, row);
+    m_peers.remove(row);
+    m_index.rebuild(m_peers);
+    endRemoveRows();
+
+    emit countChanged();
+    if (hasCurrentPeer() != hadCurrentPeer) {
+        emit hasCurrentPeerChanged();
+    }
+}
+
+void PeerListModel::setCurrentPeerId(const QString& peerId) {
+    if (m_currentPeerId == peerId) {
+        return;
+    }
+    const bool hadCurrentPeer = hasCurrentPeer();
+    const QString previous = std::exchange(m_currentPeerId, peerId);
+
+    emitRowChanged(previous, IsCurrentDeviceRole);
+    emitRowChanged(peerId, IsCurrentDeviceRole);
+    emit currentPeerIdChanged();
+    if (hasCurrentPeer() != hadCurrentPeer) {
+        emit hasCurrentPeerChanged();
+    }
+}
+
+void PeerListModel::setSelectedPeerId(const QString& peerId) {
+    if (m_selectedPeerId == peerId) {
+        return;
+    }
+    const QString previous = std::exchange(m_selectedPeerId, peerId);
+
+    emitRowChanged(previous, SelectedRole);
+    emitRowChanged(peerId, SelectedRole);
+    emit selectedPeerIdChanged();
+}
+
+} // namespace obsidian
@@ -0,0 +1,83 @@
+#include "PeerStore.h"
+#include <QSet>
+#include <vector>
+
+namespace obsidian {
+
+void PeerStore::clear() {
+    m_peers.clear();
+    m_index.clear();
+}
+
+PeerStore::Changes PeerStore::apply(const QList<PeerInfo>& upserts, const QStringList& deleted) {
+    Changes changes;
+
+    for (const PeerInfo& peer : upserts) {
+        const qsizetype row = indexOf(peer.id);
+        if (row < 0) {
+            m_peers.append(peer);
+            m_index.insert(m_peers, m_peers.size() - 1);
+            changes.added.append(peer);
+        } else if (m_peers.differences(row, peer) != 0) {
+            m_peers.replace(row, peer);
+            changes.updated.append(peer);
+        }
+    }
+
+    // Deletions are compacted in one pass instead of erasing one by one
+    std::vector<bool> drop(m_peers.size());
+    for (const QString& id : deleted) {
+        const qsizetype row = indexOf(id);
+        if (row >= 0 && !drop[row]) {
+            drop[row] = true;
+            changes.removed.append(id);
+        }
+    }
+    if (!changes.removed.isEmpty()) {
+        m_peers.removeRows(drop);
+        m_index.rebuild(m_peers);
+    }
+
+    return changes;
+}
+
+PeerStore::Changes PeerStore::replace(const QList<PeerInfo>& snapshot) {
+    Changes changes;
+
+    // Ids are looked up through the index, which finds one row per id: a
+    // repeated id keeps only its first occurrence, as in PeerListModel
+    QSet<QString> ids;
+    ids.reserve(snapshot.size());
+    QList<PeerInfo> unique;
+    unique.reserve(snapshot.size());
+
+    std::vector<bool> present(m_peers.size());
+    for (const PeerInfo& peer : snapshot) {
+        if (ids.contains(peer.id)) {
+            continue;
+        }
+        ids.insert(peer.id);
+        unique.append(peer);
+
+        const qsizetype row = indexOf(peer.id);
+        if (row < 0) {
+            changes.added.append(peer);
+        } else {
+            present[row] = true;
+            if (m_peers.differences(row, peer) != 0) {
+                changes.updated.append(peer);
+            }
+        }
+    }
+    for (qsizetype row = 0; row < m_peers.size(); ++row) {
+        if (!present[row]) {
+            changes.removed.append(m_peers.id(row));
+        }
+    }
+
+    m_peers = PeerTable(unique);
+    m_index.rebuild(m_peers);
+    return changes;
+}
+
+} // namespace obsidian
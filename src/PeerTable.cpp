@@ -0,0 +1,632 @@
+#include "PeerTable.h"
+#include "WireGuardKeys.h"
+#include <QAnyStringView>
+#include <QHashFunctions>
+#include <QHostAddress>
+#include <algorithm>
+#include <cstring>
+
+namespace obsidian {
+
+namespace {
+
+constexpr char HEX[] = "0123456789abcdef";
+constexpr qsizetype UUID_SIZE = 36;
+constexpr qsizetype IPV4_TEXT_SIZE = 18;   // "255.255.255.255/32"
+
+size_t hashBytes(const void* data, size_t size) {
+    return qHashBits(data, size, 0);
+}
+
+int hexValue(char16_t c) {
+    if (c >= u'0' && c <= u'9') {
+        return c - u'0';
+    }
+    if (c >= u'a' && c <= u'f') {
+        return c - u'a' + 10;
+    }
+    return -1;
+}
+
+bool isDash(qsizetype i) {
+    return i == 8 || i == 13 || i == 18 || i == 23;
+}
+
+// Canonical lowercase UUID text, as the server sends it; anything else is
+// kept as text so that it comes back unchanged
+bool parseUuid(QStringView text, std::array<uint8_t, 16>& out) {
+    if (text.size() != UUID_SIZE) {
+        return false;
+    }
+    size_t byte = 0;
+    for (qsizetype i = 0; i < UUID_SIZE;) {
+        if (isDash(i)) {
+            if (text[i] != u'-') {
+                return false;
+            }
+            ++i;
+            continue;
+        }
+        const int high = hexValue(text[i].unicode());
+        const int low = hexValue(text[i + 1].unicode());
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        out[byte++] = static_cast<uint8_t>(high << 4 | low);
+        i += 2;
+    }
+    return true;
+}
+
+void formatUuid(const std::array<uint8_t, 16>& id, char* out) {
+    size_t byte = 0;
+    for (qsizetype i = 0; i < UUID_SIZE;) {
+        if (isDash(i)) {
+            out[i++] = '-';
+            continue;
+        }
+        out[i++] = HEX[id[byte] >> 4];
+        out[i++] = HEX[id[byte] & 0xf];
+        ++byte;
+    }
+}
+
+// Decimal without sign or leading zeros
+bool parseDecimal(QStringView text, unsigned max, unsigned& value) {
+    if (text.isEmpty() || text.size() > 3 || (text.size() > 1 && text[0] == u'0')) {
+        return false;
+    }
+    value = 0;
+    for (const QChar c : text) {
+        if (c < u'0' || c > u'9') {
+            return false;
+        }
+        value = value * 10 + (c.unicode() - u'0');
+    }
+    return value <= max;
+}
+
+bool parseIpv4(QStringView text, std::array<uint8_t, 16>& out) {
+    qsizetype start = 0;
+    for (size_t part = 0; part < 4; ++part) {
+        qsizetype end = part < 3 ? text.indexOf(u'.', start) : text.size();
+        unsigned value = 0;
+        if (end < 0 || !parseDecimal(text.sliced(start, end - start), 255, value)) {
+            return false;
+        }
+        out[part] = static_cast<uint8_t>(value);
+        start = end + 1;
+    }
+    return true;
+}
+
+char* formatDecimal(unsigned value, char* out) {
+    if (value >= 100) {
+        *out++ = static_cast<char>('0' + value / 100);
+    }
+    if (value >= 10) {
+        *out++ = static_cast<char>('0' + value / 10 % 10);
+    }
+    *out++ = static_cast<char>('0' + value % 10);
+    return out;
+}
+
+qsizetype formatIpv4(const std::array<uint8_t, 16>& address, bool hasPrefix, uint8_t prefix, char* out) {
+    char* end = out;
+    for (size_t part = 0; part < 4; ++part) {
+        if (part > 0) {
+            *end++ = '.';
+        }
+        end = formatDecimal(address[part], end);
+    }
+    if (hasPrefix) {
+        *end++ = '/';
+        end = formatDecimal(prefix, end);
+    }
+    return end - out;
+}
+
+// Exactly size ASCII characters of text into out
+bool toAscii(QStringView text, char* out, qsizetype size) {
+    if (text.size() != size) {
+        return false;
+    }
+    for (qsizetype i = 0; i < size; ++i) {
+        if (text[i].unicode() >= 0x80) {
+            return false;
+        }
+        out[i] = static_cast<char>(text[i].unicode());
+    }
+    return true;
+}
+
+// A pool index in the bytes of a column whose value is kept as text
+template <size_t N>
+void storeIndex(std::array<uint8_t, N>& field, uint32_t index) {
+    field = {};
+    std::memcpy(field.data(), &index, sizeof(index));
+}
+
+template <size_t N>
+uint32_t loadIndex(const std::array<uint8_t, N>& field) {
+    uint32_t index;
+    std::memcpy(&index, field.data(), sizeof(index));
+    return index;
+}
+
+bool equal(QUtf8StringView pooled, QStringView text) {
+    return QAnyStringView::equal(pooled, text);
+}
+
+} // anonymous namespace
+
+// --- StringPool ---
+
+uint32_t StringPool::intern(QStringView text) {
+    return intern(QByteArrayView(text.toUtf8()));
+}
+
+uint32_t StringPool::intern(QByteArrayView utf8) {
+    if ((count() + 1) * 2 > m_slots.size()) {
+        rehash(std::max<size_t>(16, m_slots.size() * 2));
+    }
+
+    const size_t mask = m_slots.size() - 1;
+    size_t slot = hashBytes(utf8.data(), utf8.size()) & mask;
+    while (m_slots[slot] != 0) {
+        const uint32_t index = m_slots[slot] - 1;
+        if (QByteArrayView(text(index).data(), text(index).size()) == utf8) {
+            return index;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    const uint32_t index = count();
+    m_text.append(utf8.data(), utf8.size());
+    m_offsets.push_back(static_cast<uint32_t>(m_text.size()));
+    m_slots[slot] = index + 1;
+    return index;
+}
+
+void StringPool::rehash(size_t slots) {
+    m_slots.assign(slots, 0);
+    const size_t mask = slots - 1;
+    for (uint32_t index = 0; index < count(); ++index) {
+        const QUtf8StringView value = text(index);
+        size_t slot = hashBytes(value.data(), value.size()) & mask;
+        while (m_slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        m_slots[slot] = index + 1;
+    }
+}
+
+size_t StringPool::memoryUsage() const {
+    return m_text.capacity() + (m_offsets.capacity() + m_slots.capacity()) * sizeof(uint32_t);
+}
+
+// --- PeerTable ---
+
+PeerTable::PeerTable()
+    : d(new Data)
+{
+}
+
+PeerTable::PeerTable(const QList<PeerInfo>& peers)
+    : d(new Data)
+{
+    append(peers);
+}
+
+PeerTable::Row PeerTable::encode(const PeerInfo& peer) {
+    Row row;
+    if (peer.isActive) {
+        row.flags |= ActiveFlag;
+    }
+    if (!parseUuid(peer.id, row.id)) {
+        row.flags |= IdText;
+        storeIndex(row.id, d->strings.intern(peer.id));
+    }
+    row.deviceName = d->strings.intern(peer.deviceName);
+    row.protocol = d->strings.intern(peer.protocol);
+
+    // The key is packed only if it encodes back to the same text
+    char base64[KEY_BASE64_SIZE];
+    char check[KEY_BASE64_SIZE];
+    bool packed = toAscii(peer.publicKey, base64, KEY_BASE64_SIZE)
+        && WireGuardKeys::fromBase64(std::string_view(base64, KEY_BASE64_SIZE), row.key);
+    if (packed) {
+        WireGuardKeys::toBase64(row.key, check);
+        packed = std::memcmp(base64, check, KEY_BASE64_SIZE) == 0;
+    }
+    if (!packed) {
+        row.flags |= KeyText;
+        storeIndex(row.key, d->strings.intern(peer.publicKey));
+    }
+
+    // Address: IPv4 or IPv6 with an optional "/prefix"; again only if it
+    // formats back to the same text
+    QStringView address = peer.ipAddress;
+    unsigned prefix = 0;
+    packed = true;
+    const qsizetype slash = address.lastIndexOf(u'/');
+    if (slash >= 0) {
+        packed = parseDecimal(address.sliced(slash + 1), 128, prefix);
+        address = address.first(slash);
+        row.flags |= HasPrefix;
+        row.prefix = static_cast<uint8_t>(prefix);
+    }
+    if (packed && parseIpv4(address, row.address)) {
+        packed = prefix <= 32;
+    } else if (packed && address.contains(u':')) {
+        QHostAddress host;
+        packed = host.setAddress(address.toString())
+            && host.protocol() == QAbstractSocket::IPv6Protocol
+            && host.scopeId().isEmpty()
+            && host.toString() == address;
+        if (packed) {
+            const Q_IPV6ADDR bytes = host.toIPv6Address();
+            std::memcpy(row.address.data(), bytes.c, row.address.size());
+            row.flags |= Ipv6;
+        }
+    } else {
+        packed = false;
+    }
+    if (!packed) {
+        row.flags = static_cast<uint8_t>((row.flags & ~(Ipv6 | HasPrefix)) | AddressText);
+        row.prefix = 0;
+        storeIndex(row.address, d->strings.intern(peer.ipAddress));
+    }
+
+    return row;
+}
+
+PeerTable::Row PeerTable::row(qsizetype index) const {
+    Row row;
+    row.id = d->ids[index];
+    row.key = d->keys[index];
+    row.address = d->addresses[index];
+    row.deviceName = d->deviceNames[index];
+    row.protocol = d->protocols[index];
+    row.prefix = d->prefixes[index];
+    row.flags = d->flags[index];
+    return row;
+}
+
+void PeerTable::store(qsizetype index, const Row& row) {
+    d->ids[index] = row.id;
+    d->keys[index] = row.key;
+    d->addresses[index] = row.address;
+    d->deviceNames[index] = row.deviceName;
+    d->protocols[index] = row.protocol;
+    d->prefixes[index] = row.prefix;
+    d->flags[index] = row.flags;
+}
+
+PeerInfo PeerTable::at(qsizetype row) const {
+    PeerInfo peer;
+    peer.id = id(row);
+    peer.deviceName = deviceName(row);
+    peer.protocol = protocol(row);
+    peer.ipAddress = ipAddress(row);
+    peer.publicKey = publicKey(row);
+    peer.isActive = isActive(row);
+    return peer;
+}
+
+QList<PeerInfo> PeerTable::toList() const {
+    QList<PeerInfo> peers;
+    peers.reserve(size());
+    for (qsizetype row = 0; row < size(); ++row) {
+        peers.append(at(row));
+    }
+    return peers;
+}
+
+QString PeerTable::id(qsizetype row) const {
+    if (d->flags[row] & IdText) {
+        return d->strings.toString(loadIndex(d->ids[row]));
+    }
+    char text[UUID_SIZE];
+    formatUuid(d->ids[row], text);
+    return QString::fromLatin1(text, UUID_SIZE);
+}
+
+QString PeerTable::publicKey(qsizetype row) const {
+    if (d->flags[row] & KeyText) {
+        return d->strings.toString(loadIndex(d->keys[row]));
+    }
+    char text[KEY_BASE64_SIZE];
+    WireGuardKeys::toBase64(d->keys[row], text);
+    return QString::fromLatin1(text, KEY_BASE64_SIZE);
+}
+
+QString PeerTable::ipAddress(qsizetype row) const {
+    const uint8_t flags = d->flags[row];
+    if (flags & AddressText) {
+        return d->strings.toString(loadIndex(d->addresses[row]));
+    }
+    if (flags & Ipv6) {
+        Q_IPV6ADDR bytes;
+        std::memcpy(bytes.c, d->addresses[row].data(), sizeof(bytes.c));
+        QString text = QHostAddress(bytes).toString();
+        if (flags & HasPrefix) {
+            text += u'/' + QString::number(d->prefixes[row]);
+        }
+        return text;
+    }
+    char text[IPV4_TEXT_SIZE];
+    const qsizetype length = formatIpv4(d->addresses[row], flags & HasPrefix, d->prefixes[row], text);
+    return QString::fromLatin1(text, length);
+}
+
+bool PeerTable::idEquals(qsizetype row, QStringView id) const {
+    if (d->flags[row] & IdText) {
+        return equal(d->strings.text(loadIndex(d->ids[row])), id);
+    }
+    std::array<uint8_t, 16> bytes;
+    return parseUuid(id, bytes) && bytes == d->ids[row];
+}
+
+bool PeerTable::keyEquals(qsizetype row, QStringView key) const {
+    if (d->flags[row] & KeyText) {
+        return equal(d->strings.text(loadIndex(d->keys[row])), key);
+    }
+    char text[KEY_BASE64_SIZE];
+    WireGuardKeys::toBase64(d->keys[row], text);
+    return key == QLatin1String(text, KEY_BASE64_SIZE);
+}
+
+bool PeerTable::addressEquals(qsizetype row, QStringView address) const {
+    const uint8_t flags = d->flags[row];
+    if (flags & AddressText) {
+        return equal(d->strings.text(loadIndex(d->addresses[row])), address);
+    }
+    if (flags & Ipv6) {
+        return address == ipAddress(row);   // rare, not worth a formatter
+    }
+    char text[IPV4_TEXT_SIZE];
+    const qsizetype length = formatIpv4(d->addresses[row], flags & HasPrefix, d->prefixes[row], text);
+    return address == QLatin1String(text, length);
+}
+
+size_t PeerTable::idHash(qsizetype row) const {
+    if (d->flags[row] & IdText) {
+        const QUtf8StringView text = d->strings.text(loadIndex(d->ids[row]));
+        return hashBytes(text.data(), text.size());
+    }
+    return hashBytes(d->ids[row].data(), d->ids[row].size());
+}
+
+size_t PeerTable::idHash(QStringView id) {
+    std::array<uint8_t, 16> bytes;
+    if (parseUuid(id, bytes)) {
+        return hashBytes(bytes.data(), bytes.size());
+    }
+    const QByteArray text = id.toUtf8();
+    return hashBytes(text.constData(), text.size());
+}
+
+int PeerTable::differences(qsizetype row, const PeerInfo& peer) const {
+    int fields = 0;
+    if (!idEquals(row, peer.id)) {
+        fields |= Id;
+    }
+    if (!equal(d->strings.text(d->deviceNames[row]), peer.deviceName)) {
+        fields |= DeviceName;
+    }
+    if (!equal(d->strings.text(d->protocols[row]), peer.protocol)) {
+        fields |= Protocol;
+    }
+    if (!addressEquals(row, peer.ipAddress)) {
+        fields |= IpAddress;
+    }
+    if (!keyEquals(row, peer.publicKey)) {
+        fields |= PublicKey;
+    }
+    if (isActive(row) != peer.isActive) {
+        fields |= Active;
+    }
+    return fields;
+}
+
+void PeerTable::insert(qsizetype at, const QList<PeerInfo>& peers) {
+    if (peers.isEmpty()) {
+        return;
+    }
+    std::vector<Row> rows;
+    rows.reserve(peers.size());
+    for (const PeerInfo& peer : peers) {
+        rows.push_back(encode(peer));
+    }
+
+    const auto column = [&](auto& values, auto member) {
+        const auto position = values.insert(values.begin() + at, rows.size(), {});
+        for (size_t i = 0; i < rows.size(); ++i) {
+            position[i] = rows[i].*member;
+        }
+    };
+    column(d->ids, &Row::id);
+    column(d->keys, &Row::key);
+    column(d->addresses, &Row::address);
+    column(d->deviceNames, &Row::deviceName);
+    column(d->protocols, &Row::protocol);
+    column(d->prefixes, &Row::prefix);
+    column(d->flags, &Row::flags);
+}
+
+void PeerTable::replace(qsizetype row, const PeerInfo& peer) {
+    store(row, encode(peer));
+    compactStrings();
+}
+
+void PeerTable::remove(qsizetype row, qsizetype count) {
+    const auto column = [&](auto& values) {
+        values.erase(values.begin() + row, values.begin() + row + count);
+    };
+    column(d->ids);
+    column(d->keys);
+    column(d->addresses);
+    column(d->deviceNames);
+    column(d->protocols);
+    column(d->prefixes);
+    column(d->flags);
+    compactStrings();
+}
+
+void PeerTable::removeRows(const std::vector<bool>& drop) {
+    const auto column = [&](auto& values) {
+        size_t kept = 0;
+        for (size_t row = 0; row < values.size(); ++row) {
+            if (row >= drop.size() || !drop[row]) {
+                values[kept++] = values[row];
+            }
+        }
+        values.resize(kept);
+    };
+    column(d->ids);
+    column(d->keys);
+    column(d->addresses);
+    column(d->deviceNames);
+    column(d->protocols);
+    column(d->prefixes);
+    column(d->flags);
+    compactStrings();
+}
+
+void PeerTable::move(qsizetype from, qsizetype to) {
+    if (from == to) {
+        return;
+    }
+    const auto column = [&](auto& values) {
+        const auto begin = values.begin();
+        if (from < to) {
+            std::rotate(begin + from, begin + from + 1, begin + to + 1);
+        } else {
+            std::rotate(begin + to, begin + from, begin + from + 1);
+        }
+    };
+    column(d->ids);
+    column(d->keys);
+    column(d->addresses);
+    column(d->deviceNames);
+    column(d->protocols);
+    column(d->prefixes);
+    column(d->flags);
+}
+
+void PeerTable::clear() {
+    d.reset(new Data);
+}
+
+void PeerTable::compactStrings() {
+    const uint32_t count = d->strings.count();
+    if (count <= 2 * d->compactedCount + 64) {
+        return;
+    }
+
+    // Strings still referenced, in a fresh pool; old index -> new index
+    StringPool strings;
+    std::vector<uint32_t> remap(count, UINT32_MAX);
+    const auto moveString = [&](uint32_t index) {
+        if (remap[index] == UINT32_MAX) {
+            const QUtf8StringView text = d->strings.text(index);
+            remap[index] = strings.intern(QByteArrayView(text.data(), text.size()));
+        }
+        return remap[index];
+    };
+    const auto moveText = [&](auto& field) {
+        storeIndex(field, moveString(loadIndex(field)));
+    };
+
+    for (qsizetype row = 0; row < size(); ++row) {
+        const uint8_t flags = d->flags[row];
+        if (flags & IdText) {
+            moveText(d->ids[row]);
+        }
+        if (flags & KeyText) {
+            moveText(d->keys[row]);
+        }
+        if (flags & AddressText) {
+            moveText(d->addresses[row]);
+        }
+        d->deviceNames[row] = moveString(d->deviceNames[row]);
+        d->protocols[row] = moveString(d->protocols[row]);
+    }
+    d->strings = std::move(strings);
+    d->compactedCount = d->strings.count();
+}
+
+size_t PeerTable::memoryUsage() const {
+    return sizeof(*this) + sizeof(Data)
+        + d->ids.capacity() * sizeof(d->ids[0])
+        + d->keys.capacity() * sizeof(d->keys[0])
+        + d->addresses.capacity() * sizeof(d->addresses[0])
+        + (d->deviceNames.capacity() + d->protocols.capacity()) * sizeof(uint32_t)
+        + d->prefixes.capacity() + d->flags.capacity()
+        + d->strings.memoryUsage();
+}
+
+// --- PeerIndex ---
+
+void PeerIndex::clear() {
+    m_slots.clear();
+    m_count = 0;
+}
+
+void PeerIndex::rebuild(const PeerTable& table) {
+    size_t slots = 16;
+    while (slots < static_cast<size_t>(table.size()) * 2) {
+        slots *= 2;
+    }
+    m_slots.assign(slots, Slot{});
+    m_count = 0;
+    for (qsizetype row = 0; row < table.size(); ++row) {
+        place(static_cast<uint32_t>(row), table.idHash(row));
+    }
+}
+
+void PeerIndex::insert(const PeerTable& table, qsizetype row) {
+    if ((m_count + 1) * 2 > m_slots.size()) {
+        resize(std::max<size_t>(16, m_slots.size() * 2));
+    }
+    place(static_cast<uint32_t>(row), table.idHash(row));
+}
+
+void PeerIndex::resize(size_t slots) {
+    // The slots keep enough of the hash to be placed again without the ids
+    std::vector<Slot> old = std::exchange(m_slots, std::vector<Slot>(slots));
+    m_count = 0;
+    for (const Slot& slot : old) {
+        if (slot.row != 0) {
+            place(slot.row - 1, slot.hash);
+        }
+    }
+}
+
+void PeerIndex::place(uint32_t row, size_t hash) {
+    const size_t mask = m_slots.size() - 1;
+    size_t slot = hash & mask;
+    while (m_slots[slot].row != 0) {
+        slot = (slot + 1) & mask;
+    }
+    m_slots[slot] = {row + 1, static_cast<uint32_t>(hash)};
+    ++m_count;
+}
+
+qsizetype PeerIndex::find(const PeerTable& table, QStringView id) const {
+    if (m_slots.empty()) {
+        return -1;
+    }
+    const size_t hash = PeerTable::idHash(id);
+    const size_t mask = m_slots.size() - 1;
+    for (size_t slot = hash & mask; m_slots[slot].row != 0; slot = (slot + 1) & mask) {
+        const Slot& entry = m_slots[slot];
+        if (entry.hash == static_cast<uint32_t>(hash) && table.idEquals(entry.row - 1, id)) {
+            return entry.row - 1;
+        }
+    }
+    return -1;
+}
+
+} // namespace obsidian
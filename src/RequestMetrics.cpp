@@ -0,0 +1,169 @@
+#include "RequestMetrics.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace obsidian {
+
+namespace {
+
+const char* const PHASE_NAMES[RequestMetrics::PHASE_COUNT] = {
+    "queue", "connect", "ttfb", "download", "decode", "dispatch", "total"
+};
+
+constexpr double QUANTILES[] = {0.5, 0.9, 0.99};
+
+double toMs(uint64_t micros) {
+    return static_cast<double>(micros) / 1e3;
+}
+
+double toSeconds(uint64_t micros) {
+    return static_cast<double>(micros) / 1e6;
+}
+
+// {count, mean, p50, p90, p99, max} of a non-empty histogram, in ms
+QVariantMap summary(const LatencyHistogram& histogram) {
+    const uint64_t count = histogram.count();
+    return QVariantMap{
+        {"count", static_cast<double>(count)},
+        {"mean", toMs(histogram.sumMicros()) / static_cast<double>(count)},
+        {"p50", toMs(histogram.percentile(0.50))},
+        {"p90", toMs(histogram.percentile(0.90))},
+        {"p99", toMs(histogram.percentile(0.99))},
+        {"max", toMs(histogram.maxMicros())},
+    };
+}
+
+// Label values escape backslash, double quote and line feed
+QByteArray labelValue(const QString& value) {
+    QByteArray escaped = value.toUtf8();
+    escaped.replace('\\', "\\\\");
+    escaped.replace('"', "\\\"");
+    escaped.replace('\n', "\\n");
+    return escaped;
+}
+
+} // anonymous namespace
+
+const char* RequestMetrics::phaseName(Phase phase) {
+    return PHASE_NAMES[static_cast<size_t>(phase)];
+}
+
+void RequestMetrics::record(const QString& endpoint, Phase phase, qint64 nanoseconds) {
+    std::unique_ptr<LatencyHistogram>& histogram = m_endpoints[endpoint][static_cast<size_t>(phase)];
+    if (!histogram) {
+        histogram = std::make_unique<LatencyHistogram>();
+    }
+    histogram->record(static_cast<uint64_t>(qMax<qint64>(nanoseconds, 0) / 1000));
+}
+
+void RequestMetrics::recordQueueWait(const QString& priorityClass, qint64 nanoseconds) {
+    std::unique_ptr<LatencyHistogram>& histogram = m_queueWaits[priorityClass];
+    if (!histogram) {
+        histogram = std::make_unique<LatencyHistogram>();
+    }
+    histogram->record(static_cast<uint64_t>(qMax<qint64>(nanoseconds, 0) / 1000));
+}
+
+QVariantMap RequestMetrics::snapshot() const {
+    QVariantMap result;
+
+    for (const auto& [endpoint, histograms] : m_endpoints) {
+        QVariantMap phases;
+        for (size_t i = 0; i < PHASE_COUNT; ++i) {
+            const LatencyHistogram* histogram = histograms[i].get();
+            const uint64_t count = histogram ? histogram->count() : 0;
+            if (count == 0) {
+                continue;
+            }
+            phases.insert(QLatin1String(PHASE_NAMES[i]), summary(*histogram));
+        }
+        if (!phases.isEmpty()) {
+            result.insert(endpoint, phases);
+        }
+    }
+
+    return result;
+}
+
+QVariantMap RequestMetrics::queueWaitSnapshot() const {
+    QVariantMap result;
+    for (const auto& [priorityClass, histogram] : m_queueWaits) {
+        if (histogram->count() > 0) {
+            result.insert(priorityClass, summary(*histogram));
+        }
+    }
+    return result;
+}
+
+QByteArray RequestMetrics::prometheusText() const {
+    QByteArray out;
+    out += "# HELP obsidian_api_request_phase_seconds Phase timings of successful API requests.\n";
+    out += "# TYPE obsidian_api_request_phase_seconds summary\n";
+
+    for (const auto& [endpoint, histograms] : m_endpoints) {
+        for (size_t i = 0; i < PHASE_COUNT; ++i) {
+            const LatencyHistogram* histogram = histograms[i].get();
+            if (!histogram || histogram->count() == 0) {
+                continue;
+            }
+
+            const QByteArray labels = "endpoint=\"" + labelValue(endpoint) + "\",phase=\"" + PHASE_NAMES[i] + '"';
+            for (const double q : QUANTILES) {
+                out += "obsidian_api_request_phase_seconds{" + labels + ",quantile=\"" + QByteArray::number(q)
+                     + "\"} " + QByteArray::number(toSeconds(histogram->percentile(q))) + '\n';
+            }
+            out += "obsidian_api_request_phase_seconds_sum{" + labels + "} "
+                 + QByteArray::number(toSeconds(histogram->sumMicros())) + '\n';
+            out += "obsidian_api_request_phase_seconds_count{" + labels + "} "
+                 + QByteArray::number(histogram->count()) + '\n';
+        }
+    }
+
+    out += "# HELP obsidian_api_queue_wait_seconds Time API requests waited for the request scheduler.\n";
+    out += "# TYPE obsidian_api_queue_wait_seconds summary\n";
+
+    for (const auto& [priorityClass, histogram] : m_queueWaits) {
+        if (histogram->count() == 0) {
+            continue;
+        }
+        const QByteArray labels = "priority=\"" + labelValue(priorityClass) + '"';
+        for (const double q : QUANTILES) {
+            out += "obsidian_api_queue_wait_seconds{" + labels + ",quantile=\"" + QByteArray::number(q)
+                 + "\"} " + QByteArray::number(toSeconds(histogram->percentile(q))) + '\n';
+        }
+        out += "obsidian_api_queue_wait_seconds_sum{" + labels + "} "
+             + QByteArray::number(toSeconds(histogram->sumMicros())) + '\n';
+        out += "obsidian_api_queue_wait_seconds_count{" + labels + "} "
+             + QByteArray::number(histogram->count()) + '\n';
+    }
+
+    return out;
+}
+
+bool RequestMetrics::writePrometheusFile(const QString& path) const {
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(prometheusText());
+    return file.commit();
+}
+
+void RequestMetrics::reset() {
+    // Cleared in place: a reader may hold on to a histogram
+    for (auto& [endpoint, histograms] : m_endpoints) {
+        for (const std::unique_ptr<LatencyHistogram>& histogram : histograms) {
+            if (histogram) {
+                histogram->reset();
+            }
+        }
+    }
+    for (auto& [priorityClass, histogram] : m_queueWaits) {
+        histogram->reset();
+    }
+}
+
+} // namespace obsidian
@@ -0,0 +1,144 @@
+#include "RequestScheduler.h"
+#include <algorithm>
+#include <utility>
+
+namespace obsidian {
+
+RequestScheduler::RequestScheduler(int maxActive, int maxBackground)
+    : m_maxActive(std::max(maxActive, 1))
+    , m_maxBackground(std::clamp(maxBackground, 1, m_maxActive))
+{
+}
+
+const char* RequestScheduler::priorityName(RequestPriority priority) {
+    switch (priority) {
+    case RequestPriority::Interactive:
+        return "interactive";
+    case RequestPriority::Normal:
+        return "normal";
+    case RequestPriority::Background:
+        return "background";
+    }
+    return "normal";
+}
+
+bool RequestScheduler::hasRoom(RequestPriority priority) const {
+    if (priority == RequestPriority::Interactive) {
+        return true;
+    }
+    // A class with nothing running always gets one slot, so a steady stream
+    // of more urgent requests cannot starve it
+    if (active(priority) == 0) {
+        return true;
+    }
+    int running = 0;
+    for (const int count : m_active) {
+        running += count;
+    }
+    if (running >= m_maxActive) {
+        return false;
+    }
+    return priority != RequestPriority::Background || active(priority) < m_maxBackground;
+}
+
+void RequestScheduler::run(RequestPriority priority, Start start, Clock::duration waited) {
+    ++m_active[index(priority)];
+    start(waited);
+}
+
+RequestScheduler::Ticket RequestScheduler::submit(RequestPriority priority, Start start, Clock::time_point now) {
+    bool overtakes = hasRoom(priority);
+    // The slot kept for an idle class is not taken by more urgent queues
+    const size_t first = active(priority) == 0 ? index(priority) : 0;
+    for (size_t i = first; overtakes && i <= index(priority); ++i) {
+        overtakes = m_queues[i].empty();
+    }
+    if (overtakes) {
+        run(priority, std::move(start), Clock::duration::zero());
+        return 0;
+    }
+
+    const Ticket ticket = m_nextTicket++;
+    m_queues[index(priority)].push_back({ticket, std::move(start), now});
+    return ticket;
+}
+
+bool RequestScheduler::promote(Ticket ticket, RequestPriority priority, Clock::time_point now) {
+    for (size_t i = index(priority) + 1; i < PRIORITY_COUNT; ++i) {
+        std::deque<Waiting>& queue = m_queues[i];
+        const auto it = std::find_if(queue.begin(), queue.end(),
+                                     [ticket](const Waiting& waiting) { return waiting.ticket == ticket; });
+        if (it == queue.end()) {
+            continue;
+        }
+
+        // Keeps its place in time: ahead of the class's later arrivals
+        Waiting waiting = std::move(*it);
+        queue.erase(it);
+        std::deque<Waiting>& target = m_queues[index(priority)];
+        const auto position = std::find_if(target.begin(), target.end(),
+                                           [&waiting](const Waiting& other) { return other.since > waiting.since; });
+        target.insert(position, std::move(waiting));
+
+        pump(now);
+        return true;
+    }
+
+    // Already queued at that class or more urgent
+    const std::deque<Waiting>& queue = m_queues[index(priority)];
+    return std::any_of(queue.begin(), queue.end(),
+                       [ticket](const Waiting& waiting) { return waiting.ticket == ticket; });
+}
+
+bool RequestScheduler::cancel(Ticket ticket) {
+    for (std::deque<Waiting>& queue : m_queues) {
+        const auto it = std::find_if(queue.begin(), queue.end(),
+                                     [ticket](const Waiting& waiting) { return waiting.ticket == ticket; });
+        if (it != queue.end()) {
+            queue.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+void RequestScheduler::finished(RequestPriority priority, Clock::time_point now) {
+    int& count = m_active[index(priority)];
+    count = std::max(count - 1, 0);
+    pump(now);
+}
+
+void RequestScheduler::setLimits(int maxActive, int maxBackground, Clock::time_point now) {
+    m_maxActive = std::max(maxActive, 1);
+    m_maxBackground = std::clamp(maxBackground, 1, m_maxActive);
+    pump(now);
+}
+
+void RequestScheduler::pump(Clock::time_point now) {
+    // A request started from here may finish (or be submitted) synchronously;
+    // the outer loop picks up whatever that changed
+    if (m_pumping) {
+        return;
+    }
+    m_pumping = true;
+
+    bool started = true;
+    while (started) {
+        started = false;
+        for (size_t i = 0; i < PRIORITY_COUNT; ++i) {
+            const auto priority = static_cast<RequestPriority>(i);
+            if (m_queues[i].empty() || !hasRoom(priority)) {
+                continue;
+            }
+            Waiting waiting = std::move(m_queues[i].front());
+            m_queues[i].pop_front();
+            run(priority, std::move(waiting.start), now - waiting.since);
+            started = true;
+            break;
+        }
+    }
+
+    m_pumping = false;
+}
+
+} // namespace obsidian
@@ -0,0 +1,71 @@
+#include "Resilience.h"
+#include <algorithm>
+
+namespace obsidian {
+
+int ResiliencePolicy::backoffDelayMs(int attempt, double random01) const {
+    // The shift is bounded so that the cap is reached without overflow
+    const int exponent = std::clamp(attempt - 2, 0, 20);
+    const long long ceiling = std::min<long long>(backoffMaxMs,
+                                                  static_cast<long long>(backoffBaseMs) << exponent);
+    return static_cast<int>(static_cast<double>(ceiling) * std::clamp(random01, 0.0, 1.0));
+}
+
+CircuitBreaker::CircuitBreaker(int failureThreshold, std::chrono::milliseconds openDuration)
+    : m_failureThreshold(failureThreshold)
+    , m_openDuration(openDuration)
+{
+}
+
+bool CircuitBreaker::allowRequest(Clock::time_point now) {
+    switch (m_state) {
+    case State::Closed:
+        return true;
+
+    case State::Open:
+        if (now - m_openedAt < m_openDuration) {
+            return false;
+        }
+        m_state = State::HalfOpen;
+        m_probeInFlight = false;
+        [[fallthrough]];
+
+    case State::HalfOpen:
+        // One probe at a time; a probe whose outcome was never reported
+        // (e.g. the request was dropped) does not block forever
+        if (m_probeInFlight && now - m_probeStartedAt < m_openDuration) {
+            return false;
+        }
+        m_probeInFlight = true;
+        m_probeStartedAt = now;
+        return true;
+    }
+    return true;
+}
+
+void CircuitBreaker::recordSuccess() {
+    m_state = State::Closed;
+    m_failures = 0;
+    m_probeInFlight = false;
+}
+
+void CircuitBreaker::recordFailure(Clock::time_point now) {
+    m_probeInFlight = false;
+
+    // Late failures of requests sent before the circuit opened
+    if (m_state == State::Open) {
+        return;
+    }
+
+    if (m_state == State::HalfOpen || ++m_failures >= m_failureThreshold) {
+        m_state = State::Open;
+        m_openedAt = now;
+        m_failures = 0;
+    }
+}
+
+void CircuitBreaker::reset() {
+    recordSuccess();
+}
+
+} // namespace obsidian
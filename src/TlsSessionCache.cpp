@@ -0,0 +1,110 @@
+#include "TlsSessionCache.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimeZone>
+
+namespace obsidian {
+
+TlsSessionCache::TlsSessionCache(const QString& filePath)
+    : m_filePath(filePath)
+{
+    load();
+}
+
+QString TlsSessionCache::originKey(const QUrl& url) {
+    const int defaultPort = url.scheme() == QLatin1String("https") ? 443 : 80;
+    return url.scheme() + "://" + url.host().toLower() + ':' + QString::number(url.port(defaultPort));
+}
+
+QByteArray TlsSessionCache::ticket(const QUrl& serverUrl) const {
+    const auto it = m_entries.constFind(originKey(serverUrl));
+    if (it == m_entries.constEnd() || it->expires <= QDateTime::currentDateTimeUtc()) {
+        return QByteArray();
+    }
+    return it->ticket;
+}
+
+void TlsSessionCache::store(const QUrl& serverUrl, const QByteArray& ticket, int lifetimeHint) {
+    if (ticket.isEmpty()) {
+        return;
+    }
+
+    const QString key = originKey(serverUrl);
+    auto it = m_entries.find(key);
+    if (it != m_entries.end() && it->ticket == ticket) {
+        return;
+    }
+
+    const int lifetime = lifetimeHint > 0 ? qMin(lifetimeHint, MAX_LIFETIME) : DEFAULT_LIFETIME;
+    m_entries.insert(key, Entry{ticket, QDateTime::currentDateTimeUtc().addSecs(lifetime)});
+
+    dropExpired();
+    save();
+}
+
+void TlsSessionCache::remove(const QUrl& serverUrl) {
+    if (m_entries.remove(originKey(serverUrl)) > 0) {
+        save();
+    }
+}
+
+void TlsSessionCache::dropExpired() {
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->expires <= now) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void TlsSessionCache::load() {
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = root.begin(); it != root.end(); ++it) {
+        const QJsonObject obj = it.value().toObject();
+        Entry entry;
+        entry.ticket = QByteArray::fromBase64(obj.value(QLatin1String("ticket")).toString().toLatin1());
+        entry.expires = QDateTime::fromSecsSinceEpoch(
+            static_cast<qint64>(obj.value(QLatin1String("expires")).toDouble()), QTimeZone::utc());
+        if (!entry.ticket.isEmpty()) {
+            m_entries.insert(it.key(), entry);
+        }
+    }
+
+    dropExpired();
+}
+
+bool TlsSessionCache::save() const {
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+
+    QJsonObject root;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        QJsonObject obj;
+        obj["ticket"] = QString::fromLatin1(it->ticket.toBase64());
+        obj["expires"] = static_cast<double>(it->expires.toSecsSinceEpoch());
+        root[it.key()] = obj;
+    }
+
+    // Permissions are restricted before anything is written to the file
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+#ifdef Q_OS_UNIX
+    file.setPermissions(QFile::ReadOwner | QFile::WriteOwner);
+#endif
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+} // namespace obsidian
@@ -0,0 +1,244 @@
+#include "WireGuardHandshake.h"
+#include "ChaCha20Poly1305.h"
+#include <chrono>
+#include <cstring>
+
+namespace obsidian {
+
+namespace {
+
+constexpr char CONSTRUCTION[] = "Noise_IKpsk2_25519_ChaChaPoly_BLAKE2s";
+constexpr char IDENTIFIER[] = "WireGuard v1 zx2c4 Jason@zx2c4.com";
+constexpr char LABEL_MAC1[] = "mac1----";
+
+constexpr size_t MAC_SIZE = 16;
+
+// Смещения полей сообщения 1
+constexpr size_t INIT_SENDER = 4;
+constexpr size_t INIT_EPHEMERAL = 8;
+constexpr size_t INIT_STATIC = 40;
+constexpr size_t INIT_TIMESTAMP = 88;
+constexpr size_t INIT_MAC1 = 116;
+
+// Смещения полей сообщения 2
+constexpr size_t RESP_SENDER = 4;
+constexpr size_t RESP_RECEIVER = 8;
+constexpr size_t RESP_EPHEMERAL = 12;
+constexpr size_t RESP_EMPTY = 44;
+constexpr size_t RESP_MAC1 = 60;
+
+// Cookie reply: type, reserved, receiver index
+constexpr size_t COOKIE_RECEIVER = 4;
+
+std::span<const uint8_t> bytes(const char* text, size_t length) {
+    return {reinterpret_cast<const uint8_t*>(text), length};
+}
+
+uint32_t load32_le(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+void store32_le(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+// TAI64N: секунды + 2^62 и наносекунды, big-endian
+void tai64n(uint8_t out[12]) {
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(now);
+    const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(now - seconds);
+
+    const uint64_t s = (uint64_t(1) << 62) + static_cast<uint64_t>(seconds.count());
+    const uint32_t n = static_cast<uint32_t>(nanos.count());
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<uint8_t>(s >> (56 - 8 * i));
+    }
+    for (int i = 0; i < 4; ++i) {
+        out[8 + i] = static_cast<uint8_t>(n >> (24 - 8 * i));
+    }
+}
+
+// mac1 = MAC(HASH(LABEL_MAC1 || receiverPublic), message[0..offset))
+void mac1(uint8_t out[MAC_SIZE], const WireGuardHandshake::Key& receiverPublic,
+          std::span<const uint8_t> covered)
+{
+    Blake2s keyState;
+    keyState.update(bytes(LABEL_MAC1, sizeof(LABEL_MAC1) - 1));
+    keyState.update(receiverPublic);
+    Blake2s::Hash macKey;
+    keyState.final(macKey);
+
+    Blake2s::hash(std::span<uint8_t>(out, MAC_SIZE), covered, macKey);
+}
+
+bool constantTimeEqual(const uint8_t* a, const uint8_t* b, size_t length) {
+    uint8_t diff = 0;
+    for (size_t i = 0; i < length; ++i) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+} // anonymous namespace
+
+WireGuardHandshake::WireGuardHandshake(const Key& localPrivateKey,
+                                       const Key& remotePublicKey,
+                                       const Key& presharedKey)
+    : m_localPrivate(localPrivateKey)
+    , m_localPublic(WireGuardKeys::derivePublicKey(localPrivateKey))
+    , m_remotePublic(remotePublicKey)
+    , m_presharedKey(presharedKey)
+{
+}
+
+WireGuardHandshake::~WireGuardHandshake() {
+    WireGuardKeys::secureZero(m_localPrivate.data(), m_localPrivate.size());
+    WireGuardKeys::secureZero(m_presharedKey.data(), m_presharedKey.size());
+    WireGuardKeys::secureZero(m_chainingKey.data(), m_chainingKey.size());
+    WireGuardKeys::secureZero(m_ephemeral);
+}
+
+void WireGuardHandshake::mixHash(std::span<const uint8_t> data) {
+    Blake2s state;
+    state.update(m_hash);
+    state.update(data);
+    state.final(m_hash);
+}
+
+bool WireGuardHandshake::createInitiation(uint32_t senderIndex,
+                                          std::span<uint8_t, INITIATION_SIZE> out)
+{
+    m_initiated = false;
+
+    auto ephemeral = WireGuardKeys::generateKeyPair();
+    if (!ephemeral) {
+        return false;
+    }
+    m_ephemeral = *ephemeral;
+    WireGuardKeys::secureZero(*ephemeral);
+
+    auto dhEphemeralStatic = WireGuardKeys::sharedSecret(m_ephemeral.privateKey, m_remotePublic);
+    auto dhStaticStatic = WireGuardKeys::sharedSecret(m_localPrivate, m_remotePublic);
+    if (!dhEphemeralStatic || !dhStaticStatic) {
+        return false;
+    }
+
+    std::fill(out.begin(), out.end(), uint8_t(0));
+    out[0] = static_cast<uint8_t>(MessageType::Initiation);
+    store32_le(out.data() + INIT_SENDER, senderIndex);
+
+    // Ci = HASH(CONSTRUCTION), Hi = HASH(Ci || IDENTIFIER || Spub_r)
+    m_chainingKey = Blake2s::hash(bytes(CONSTRUCTION, sizeof(CONSTRUCTION) - 1));
+    m_hash = m_chainingKey;
+    mixHash(bytes(IDENTIFIER, sizeof(IDENTIFIER) - 1));
+    mixHash(m_remotePublic);
+
+    // e
+    std::memcpy(out.data() + INIT_EPHEMERAL, m_ephemeral.publicKey.data(), KEY_SIZE);
+    Blake2s::hkdf(m_chainingKey, m_ephemeral.publicKey, m_chainingKey);
+    mixHash(m_ephemeral.publicKey);
+
+    // es, s
+    ChaCha20Poly1305::Key key;
+    Blake2s::hkdf(m_chainingKey, *dhEphemeralStatic, m_chainingKey, &key);
+    std::span<uint8_t> encryptedStatic(out.data() + INIT_STATIC, KEY_SIZE + ChaCha20Poly1305::TAG_SIZE);
+    std::memcpy(encryptedStatic.data(), m_localPublic.data(), KEY_SIZE);
+    ChaCha20Poly1305::seal(encryptedStatic, m_hash, ChaCha20Poly1305::counterNonce(0), key);
+    mixHash(encryptedStatic);
+
+    // ss, timestamp
+    Blake2s::hkdf(m_chainingKey, *dhStaticStatic, m_chainingKey, &key);
+    std::span<uint8_t> encryptedTimestamp(out.data() + INIT_TIMESTAMP, 12 + ChaCha20Poly1305::TAG_SIZE);
+    tai64n(encryptedTimestamp.data());
+    ChaCha20Poly1305::seal(encryptedTimestamp, m_hash, ChaCha20Poly1305::counterNonce(0), key);
+    mixHash(encryptedTimestamp);
+
+    // mac2 остаётся нулевым: cookie от сервера у нас нет
+    mac1(out.data() + INIT_MAC1, m_remotePublic, out.first(INIT_MAC1));
+
+    WireGuardKeys::secureZero(key.data(), key.size());
+    WireGuardKeys::secureZero(dhEphemeralStatic->data(), KEY_SIZE);
+    WireGuardKeys::secureZero(dhStaticStatic->data(), KEY_SIZE);
+
+    m_senderIndex = senderIndex;
+    m_initiated = true;
+    return true;
+}
+
+WireGuardHandshake::ResponseStatus WireGuardHandshake::consumeResponse(std::span<const uint8_t> message) {
+    if (!m_initiated || message.empty()) {
+        return ResponseStatus::Invalid;
+    }
+
+    const auto type = static_cast<MessageType>(message[0]);
+
+    if (type == MessageType::CookieReply) {
+        if (message.size() == COOKIE_REPLY_SIZE &&
+            load32_le(message.data() + COOKIE_RECEIVER) == m_senderIndex) {
+            return ResponseStatus::CookieReply;
+        }
+        return ResponseStatus::Invalid;
+    }
+
+    if (type != MessageType::Response || message.size() != RESPONSE_SIZE ||
+        message[1] != 0 || message[2] != 0 || message[3] != 0 ||
+        load32_le(message.data() + RESP_RECEIVER) != m_senderIndex) {
+        return ResponseStatus::Invalid;
+    }
+
+    // mac1 проверяется до любых DH, как это делает сам WireGuard
+    uint8_t expectedMac[MAC_SIZE];
+    mac1(expectedMac, m_localPublic, message.first(RESP_MAC1));
+    if (!constantTimeEqual(expectedMac, message.data() + RESP_MAC1, MAC_SIZE)) {
+        return ResponseStatus::Invalid;
+    }
+
+    Key remoteEphemeral;
+    std::memcpy(remoteEphemeral.data(), message.data() + RESP_EPHEMERAL, KEY_SIZE);
+
+    auto dhEphemeralEphemeral = WireGuardKeys::sharedSecret(m_ephemeral.privateKey, remoteEphemeral);
+    auto dhStaticEphemeral = WireGuardKeys::sharedSecret(m_localPrivate, remoteEphemeral);
+    if (!dhEphemeralEphemeral || !dhStaticEphemeral) {
+        return ResponseStatus::Invalid;
+    }
+
+    // Работаем с копией состояния: чужой пакет не должен его испортить
+    Blake2s::Hash chainingKey = m_chainingKey;
+    const Blake2s::Hash savedHash = m_hash;
+
+    // e, ee, se
+    Blake2s::hkdf(chainingKey, remoteEphemeral, chainingKey);
+    mixHash(remoteEphemeral);
+    Blake2s::hkdf(chainingKey, *dhEphemeralEphemeral, chainingKey);
+    Blake2s::hkdf(chainingKey, *dhStaticEphemeral, chainingKey);
+
+    // psk
+    Blake2s::Hash tau;
+    ChaCha20Poly1305::Key key;
+    Blake2s::hkdf(chainingKey, m_presharedKey, chainingKey, &tau, &key);
+    mixHash(tau);
+
+    // empty: только тег над текущим хешем
+    std::array<uint8_t, ChaCha20Poly1305::TAG_SIZE> empty;
+    std::memcpy(empty.data(), message.data() + RESP_EMPTY, empty.size());
+    const bool valid = ChaCha20Poly1305::open(empty, m_hash, ChaCha20Poly1305::counterNonce(0), key);
+
+    m_hash = savedHash;
+    WireGuardKeys::secureZero(chainingKey.data(), chainingKey.size());
+    WireGuardKeys::secureZero(tau.data(), tau.size());
+    WireGuardKeys::secureZero(key.data(), key.size());
+    WireGuardKeys::secureZero(dhEphemeralEphemeral->data(), KEY_SIZE);
+    WireGuardKeys::secureZero(dhStaticEphemeral->data(), KEY_SIZE);
+
+    if (!valid) {
+        return ResponseStatus::Invalid;
+    }
+
+    m_remoteIndex = load32_le(message.data() + RESP_SENDER);
+    return ResponseStatus::Valid;
+}
+
+} // namespace obsidian
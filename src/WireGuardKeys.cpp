@@ -1,12 +1,21 @@
 #include "WireGuardKeys.h"
-#include <random>
 #include <algorithm>
 #include <cstring>
+#include <cerrno>
 #include <stdexcept>
-
-// Base64 encoding table
-static const char BASE64_CHARS[] =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+#include <thread>
+
+#if defined(__linux__)
+#include <sys/random.h>
+#elif defined(__APPLE__)
+#include <stdlib.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <bcrypt.h>
+#endif
 
 namespace obsidian {
 
@@ -18,16 +27,55 @@ std::string KeyPair::publicKeyBase64() const {
     return WireGuardKeys::toBase64(publicKey);
 }
 
+namespace {
+
+// Ниже этого размера пакета запуск потоков дороже самих вычислений
+constexpr size_t MIN_KEYS_PER_THREAD = 32;
+
+// 4096 ключей = 128 КиБ энтропии на один вызов getrandom
+constexpr size_t ENTROPY_BLOCK_KEYS = 4096;
+
+} // anonymous namespace
+
+bool WireGuardKeys::fillRandom(uint8_t* buffer, size_t length) {
+#if defined(__linux__)
+    while (length > 0) {
+        ssize_t n = getrandom(buffer, length, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        buffer += n;
+        length -= static_cast<size_t>(n);
+    }
+    return true;
+#elif defined(__APPLE__)
+    arc4random_buf(buffer, length);
+    return true;
+#elif defined(_WIN32)
+    while (length > 0) {
+        ULONG chunk = static_cast<ULONG>(std::min<size_t>(length, 0x7fffffff));
+        if (!BCRYPT_SUCCESS(BCryptGenRandom(nullptr, buffer, chunk,
+                                            BCRYPT_USE_SYSTEM_PREFERRED_RNG))) {
+            return false;
+        }
+        buffer += chunk;
+        length -= chunk;
+    }
+    return true;
+#else
+    (void)buffer;
+    (void)length;
+    return false;
+#endif
+}
+
 std::optional<KeyPair> WireGuardKeys::generateKeyPair() {
     KeyPair keyPair;
 
     // Генерация случайных байтов для приватного ключа
-    std::random_device rd;
-    std::mt19937_64 gen(rd());
-    std::uniform_int_distribution<uint8_t> dis(0, 255);
-
-    for (auto& byte : keyPair.privateKey) {
-        byte = dis(gen);
+    if (!fillRandom(keyPair.privateKey.data(), KEY_SIZE)) {
+        return std::nullopt;
     }
 
     // Clamp private key согласно Curve25519
@@ -39,237 +87,776 @@ std::optional<KeyPair> WireGuardKeys::generateKeyPair() {
     return keyPair;
 }
 
+std::vector<KeyPair> WireGuardKeys::generateKeyPairs(size_t count) {
+    std::vector<KeyPair> pairs(count);
+    if (!generateKeyPairs(pairs)) {
+        return {};
+    }
+    return pairs;
+}
+
+bool WireGuardKeys::generateKeyPairs(std::span<KeyPair> out) {
+    if (out.empty()) {
+        return true;
+    }
+
+    // Энтропия читается блоками по ENTROPY_BLOCK_KEYS ключей за один системный вызов
+    std::vector<uint8_t> block(std::min(out.size(), ENTROPY_BLOCK_KEYS) * KEY_SIZE);
+
+    for (size_t i = 0; i < out.size(); ) {
+        const size_t n = std::min(ENTROPY_BLOCK_KEYS, out.size() - i);
+
+        if (!fillRandom(block.data(), n * KEY_SIZE)) {
+            std::fill(block.begin(), block.end(), uint8_t(0));
+            std::fill(out.begin(), out.end(), KeyPair());
+            return false;
+        }
+
+        for (size_t j = 0; j < n; ++j) {
+            auto& key = out[i + j].privateKey;
+            std::memcpy(key.data(), block.data() + j * KEY_SIZE, KEY_SIZE);
+            clampPrivateKey(key);
+        }
+        i += n;
+    }
+    std::fill(block.begin(), block.end(), uint8_t(0));
+
+    const size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    const size_t threadCount = std::min(hardware,
+        (out.size() + MIN_KEYS_PER_THREAD - 1) / MIN_KEYS_PER_THREAD);
+
+    if (threadCount <= 1) {
+        derivePublicKeys(out);
+        return true;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount - 1);
+
+    const size_t chunk = (out.size() + threadCount - 1) / threadCount;
+    for (size_t begin = chunk; begin < out.size(); begin += chunk) {
+        auto part = out.subspan(begin, std::min(chunk, out.size() - begin));
+        workers.emplace_back([part]() { derivePublicKeys(part); });
+    }
+
+    // Первую часть считаем в вызывающем потоке
+    derivePublicKeys(out.first(std::min(chunk, out.size())));
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    return true;
+}
+
+void WireGuardKeys::derivePublicKeys(std::span<KeyPair> pairs) {
+    for (auto& pair : pairs) {
+        pair.publicKey = derivePublicKey(pair.privateKey);
+    }
+}
+
+void WireGuardKeys::secureZero(void* data, size_t size) {
+    volatile uint8_t* p = static_cast<volatile uint8_t*>(data);
+    while (size--) {
+        *p++ = 0;
+    }
+}
+
 void WireGuardKeys::clampPrivateKey(std::array<uint8_t, KEY_SIZE>& key) {
     key[0] &= 248;
     key[31] &= 127;
     key[31] |= 64;
 }
 
-// Упрощённая реализация Curve25519 scalar multiplication
-// В прод следует использовать libsodium или аналог
+// Вычисление публичного ключа из приватного: X25519(privateKey, 9).
+// База фиксирована, поэтому используется табличный путь вместо лестницы
 std::array<uint8_t, KEY_SIZE> WireGuardKeys::derivePublicKey(
     const std::array<uint8_t, KEY_SIZE>& privateKey)
 {
     std::array<uint8_t, KEY_SIZE> result;
-    std::array<uint8_t, KEY_SIZE> basePoint = {9}; // Curve25519 base point
 
-    curve25519ScalarMult(result, privateKey, basePoint);
+    curve25519ScalarMultBase(result, privateKey);
 
     return result;
 }
 
-// Curve25519 implementation (simplified)
-// Based on TweetNaCl's curve25519 implementation
+// Curve25519 field arithmetic, radix 2^51 (5 x 51-bit limbs).
+// Element h represents h[0] + h[1]*2^51 + h[2]*2^102 + h[3]*2^153 + h[4]*2^204
+// modulo p = 2^255 - 19. All operations are branch-free on secret data.
 namespace {
 
-using fe = std::array<int64_t, 16>;
+using fe = std::array<uint64_t, 5>;
 
-constexpr void fe_frombytes(fe& h, const uint8_t* s) {
-    int64_t h0 = static_cast<int64_t>(s[0]);
-    int64_t h1 = static_cast<int64_t>(s[1]) << 8;
-    int64_t h2 = static_cast<int64_t>(s[2]) << 16;
-    int64_t h3 = static_cast<int64_t>(s[3]) << 24;
+constexpr uint64_t MASK51 = (uint64_t(1) << 51) - 1;
+
+using uint128 = unsigned __int128;
 
-    // Simplified - full implementation would handle all 32 bytes
-    for (int i = 0; i < 16; ++i) {
-        h[i] = (static_cast<int64_t>(s[i * 2]) |
-                (static_cast<int64_t>(s[i * 2 + 1]) << 8));
+constexpr uint64_t load64_le(const uint8_t* s) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) {
+        v = (v << 8) | s[i];
     }
+    return v;
+}
+
+constexpr void store64_le(uint8_t* s, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        s[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+}
+
+// Decodes a little-endian u-coordinate; the top bit is ignored (RFC 7748 §5).
+constexpr void fe_frombytes(fe& h, const uint8_t* s) {
+    const uint64_t w0 = load64_le(s);
+    const uint64_t w1 = load64_le(s + 8);
+    const uint64_t w2 = load64_le(s + 16);
+    const uint64_t w3 = load64_le(s + 24);
+
+    h[0] = w0 & MASK51;
+    h[1] = ((w0 >> 51) | (w1 << 13)) & MASK51;
+    h[2] = ((w1 >> 38) | (w2 << 26)) & MASK51;
+    h[3] = ((w2 >> 25) | (w3 << 39)) & MASK51;
+    h[4] = (w3 >> 12) & MASK51;
 }
 
+// Encodes the canonical (fully reduced) representative of h.
 constexpr void fe_tobytes(uint8_t* s, const fe& h) {
-    for (int i = 0; i < 16; ++i) {
-        s[i * 2] = static_cast<uint8_t>(h[i] & 0xff);
-        s[i * 2 + 1] = static_cast<uint8_t>((h[i] >> 8) & 0xff);
+    fe t = h;
+
+    // Two carry passes bring every limb below 2^51 (t[0] may exceed it by < 19)
+    for (int pass = 0; pass < 2; ++pass) {
+        t[1] += t[0] >> 51; t[0] &= MASK51;
+        t[2] += t[1] >> 51; t[1] &= MASK51;
+        t[3] += t[2] >> 51; t[2] &= MASK51;
+        t[4] += t[3] >> 51; t[3] &= MASK51;
+        t[0] += 19 * (t[4] >> 51); t[4] &= MASK51;
     }
+
+    // q = 1 iff t >= p, then t -= q * p
+    uint64_t q = (t[0] + 19) >> 51;
+    q = (t[1] + q) >> 51;
+    q = (t[2] + q) >> 51;
+    q = (t[3] + q) >> 51;
+    q = (t[4] + q) >> 51;
+
+    t[0] += 19 * q;
+    t[1] += t[0] >> 51; t[0] &= MASK51;
+    t[2] += t[1] >> 51; t[1] &= MASK51;
+    t[3] += t[2] >> 51; t[2] &= MASK51;
+    t[4] += t[3] >> 51; t[3] &= MASK51;
+    t[4] &= MASK51;
+
+    store64_le(s,      t[0] | (t[1] << 51));
+    store64_le(s + 8,  (t[1] >> 13) | (t[2] << 38));
+    store64_le(s + 16, (t[2] >> 26) | (t[3] << 25));
+    store64_le(s + 24, (t[3] >> 39) | (t[4] << 12));
 }
 
-void fe_add(fe& h, const fe& f, const fe& g) {
-    for (int i = 0; i < 16; ++i) {
+constexpr void fe_0(fe& h) { h = {0, 0, 0, 0, 0}; }
+constexpr void fe_1(fe& h) { h = {1, 0, 0, 0, 0}; }
+
+// No carry: outputs stay well within the 2^54 input bound of fe_mul/fe_sq
+constexpr void fe_add(fe& h, const fe& f, const fe& g) {
+    for (int i = 0; i < 5; ++i) {
         h[i] = f[i] + g[i];
     }
 }
 
-void fe_sub(fe& h, const fe& f, const fe& g) {
-    for (int i = 0; i < 16; ++i) {
-        h[i] = f[i] - g[i];
+// h = f - g + 2p; g must be a carried fe_mul/fe_sq output (limbs < 2^52 - 38)
+constexpr void fe_sub(fe& h, const fe& f, const fe& g) {
+    h[0] = (f[0] + 0xfffffffffffdaULL) - g[0];
+    h[1] = (f[1] + 0xffffffffffffeULL) - g[1];
+    h[2] = (f[2] + 0xffffffffffffeULL) - g[2];
+    h[3] = (f[3] + 0xffffffffffffeULL) - g[3];
+    h[4] = (f[4] + 0xffffffffffffeULL) - g[4];
+}
+
+// Carries 128-bit column sums into 51-bit limbs
+constexpr void fe_carry(fe& h, uint128 t0, uint128 t1, uint128 t2, uint128 t3, uint128 t4) {
+    t1 += static_cast<uint64_t>(t0 >> 51);
+    t2 += static_cast<uint64_t>(t1 >> 51);
+    t3 += static_cast<uint64_t>(t2 >> 51);
+    t4 += static_cast<uint64_t>(t3 >> 51);
+
+    const uint128 r0 = static_cast<uint128>(static_cast<uint64_t>(t4 >> 51)) * 19
+                     + (static_cast<uint64_t>(t0) & MASK51);
+
+    h[0] = static_cast<uint64_t>(r0) & MASK51;
+    h[1] = (static_cast<uint64_t>(t1) & MASK51) + static_cast<uint64_t>(r0 >> 51);
+    h[2] = static_cast<uint64_t>(t2) & MASK51;
+    h[3] = static_cast<uint64_t>(t3) & MASK51;
+    h[4] = static_cast<uint64_t>(t4) & MASK51;
+}
+
+constexpr void fe_mul(fe& h, const fe& f, const fe& g) {
+    const uint64_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    const uint64_t g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+
+    // 2^255 = 19 (mod p): wrapped-around products are pre-multiplied by 19
+    const uint64_t g1_19 = 19 * g1, g2_19 = 19 * g2, g3_19 = 19 * g3, g4_19 = 19 * g4;
+
+    const uint128 t0 = uint128(f0) * g0 + uint128(f1) * g4_19 + uint128(f2) * g3_19
+                     + uint128(f3) * g2_19 + uint128(f4) * g1_19;
+    const uint128 t1 = uint128(f0) * g1 + uint128(f1) * g0 + uint128(f2) * g4_19
+                     + uint128(f3) * g3_19 + uint128(f4) * g2_19;
+    const uint128 t2 = uint128(f0) * g2 + uint128(f1) * g1 + uint128(f2) * g0
+                     + uint128(f3) * g4_19 + uint128(f4) * g3_19;
+    const uint128 t3 = uint128(f0) * g3 + uint128(f1) * g2 + uint128(f2) * g1
+                     + uint128(f3) * g0 + uint128(f4) * g4_19;
+    const uint128 t4 = uint128(f0) * g4 + uint128(f1) * g3 + uint128(f2) * g2
+                     + uint128(f3) * g1 + uint128(f4) * g0;
+
+    fe_carry(h, t0, t1, t2, t3, t4);
+}
+
+// Dedicated squaring: 15 multiplications instead of 25
+constexpr void fe_sq(fe& h, const fe& f) {
+    const uint64_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    const uint64_t f0_2 = 2 * f0, f1_2 = 2 * f1;
+    const uint64_t f3_19 = 19 * f3, f4_19 = 19 * f4;
+    const uint64_t f3_38 = 2 * f3_19, f4_38 = 2 * f4_19;
+
+    const uint128 t0 = uint128(f0) * f0 + uint128(f1) * f4_38 + uint128(f2) * f3_38;
+    const uint128 t1 = uint128(f0_2) * f1 + uint128(f2) * f4_38 + uint128(f3) * f3_19;
+    const uint128 t2 = uint128(f0_2) * f2 + uint128(f1) * f1 + uint128(f3) * f4_38;
+    const uint128 t3 = uint128(f0_2) * f3 + uint128(f1_2) * f2 + uint128(f4) * f4_19;
+    const uint128 t4 = uint128(f0_2) * f4 + uint128(f1_2) * f3 + uint128(f2) * f2;
+
+    fe_carry(h, t0, t1, t2, t3, t4);
+}
+
+// h = f^(2^n)
+constexpr void fe_sqn(fe& h, const fe& f, int n) {
+    fe_sq(h, f);
+    for (int i = 1; i < n; ++i) {
+        fe_sq(h, h);
     }
 }
 
-void fe_mul(fe& h, const fe& f, const fe& g) {
-    // Simplified multiplication - full implementation is more complex
-    fe result = {};
-    for (int i = 0; i < 16; ++i) {
-        for (int j = 0; j < 16; ++j) {
-            if (i + j < 16) {
-                result[i + j] += f[i] * g[j];
-            }
+// h = f * 121665 (a24 = (486662 - 2) / 4)
+constexpr void fe_mul_a24(fe& h, const fe& f) {
+    constexpr uint64_t A24 = 121665;
+    fe_carry(h, uint128(f[0]) * A24, uint128(f[1]) * A24, uint128(f[2]) * A24,
+             uint128(f[3]) * A24, uint128(f[4]) * A24);
+}
+
+// out = z^(p - 2) = z^(2^255 - 21): 254 squarings, 11 multiplications
+constexpr void fe_invert(fe& out, const fe& z) {
+    fe z2, z9, z11, z2_5_0, z2_10_0, z2_20_0, z2_50_0, z2_100_0, t;
+
+    fe_sq(z2, z);
+    fe_sqn(t, z2, 2);
+    fe_mul(z9, t, z);
+    fe_mul(z11, z9, z2);
+    fe_sq(t, z11);
+    fe_mul(z2_5_0, t, z9);
+
+    fe_sqn(t, z2_5_0, 5);
+    fe_mul(z2_10_0, t, z2_5_0);
+    fe_sqn(t, z2_10_0, 10);
+    fe_mul(z2_20_0, t, z2_10_0);
+    fe_sqn(t, z2_20_0, 20);
+    fe_mul(t, t, z2_20_0);
+    fe_sqn(t, t, 10);
+    fe_mul(z2_50_0, t, z2_10_0);
+    fe_sqn(t, z2_50_0, 50);
+    fe_mul(z2_100_0, t, z2_50_0);
+    fe_sqn(t, z2_100_0, 100);
+    fe_mul(t, t, z2_100_0);
+    fe_sqn(t, t, 50);
+    fe_mul(t, t, z2_50_0);
+    fe_sqn(t, t, 5);
+    fe_mul(out, t, z11);
+}
+
+constexpr void fe_cswap(fe& f, fe& g, uint64_t b) {
+    const uint64_t mask = 0 - b;
+    for (int i = 0; i < 5; ++i) {
+        const uint64_t t = mask & (f[i] ^ g[i]);
+        f[i] ^= t;
+        g[i] ^= t;
+    }
+}
+
+// h = f - g + 4p, then a carry pass; accepts any g with limbs < 2^53,
+// e.g. an uncarried fe_add result
+constexpr void fe_sub_wide(fe& h, const fe& f, const fe& g) {
+    uint64_t t0 = (f[0] + 0x1fffffffffffb4ULL) - g[0];
+    uint64_t t1 = (f[1] + 0x1ffffffffffffcULL) - g[1];
+    uint64_t t2 = (f[2] + 0x1ffffffffffffcULL) - g[2];
+    uint64_t t3 = (f[3] + 0x1ffffffffffffcULL) - g[3];
+    uint64_t t4 = (f[4] + 0x1ffffffffffffcULL) - g[4];
+
+    t1 += t0 >> 51; t0 &= MASK51;
+    t2 += t1 >> 51; t1 &= MASK51;
+    t3 += t2 >> 51; t2 &= MASK51;
+    t4 += t3 >> 51; t3 &= MASK51;
+    t0 += 19 * (t4 >> 51); t4 &= MASK51;
+
+    h = {t0, t1, t2, t3, t4};
+}
+
+// Twisted Edwards curve -x^2 + y^2 = 1 + d*x^2*y^2, birationally equivalent
+// to Curve25519 via u = (1 + y) / (1 - y). Formulas follow ref10.
+
+// Projective (X : Y : Z)
+struct ge_p2 { fe X, Y, Z; };
+
+// Extended (X : Y : Z : T), x = X/Z, y = Y/Z, x*y = T/Z
+struct ge_p3 { fe X, Y, Z, T; };
+
+// Completed ((X : Z), (Y : T))
+struct ge_p1p1 { fe X, Y, Z, T; };
+
+// Affine precomputed (y + x, y - x, 2*d*x*y)
+struct ge_precomp { fe yplusx, yminusx, xy2d; };
+
+// 2 * d, d = -121665 / 121666
+constexpr fe ED25519_D2 = {
+    0x69b9426b2f159, 0x35050762add7a, 0x3cf44c0038052, 0x6738cc7407977, 0x2406d9dc56dff
+};
+
+// Ed25519 base point (x, 4/5), image of the Curve25519 base point u = 9
+constexpr fe ED25519_BX = {
+    0x62d608f25d51a, 0x412a4b4f6592a, 0x75b7171a4b31d, 0x1ff60527118fe, 0x216936d3cd6e5
+};
+constexpr fe ED25519_BY = {
+    0x6666666666658, 0x4cccccccccccc, 0x1999999999999, 0x3333333333333, 0x6666666666666
+};
+
+constexpr void ge_p3_0(ge_p3& h) {
+    fe_0(h.X);
+    fe_1(h.Y);
+    fe_1(h.Z);
+    fe_0(h.T);
+}
+
+constexpr void ge_p1p1_to_p2(ge_p2& r, const ge_p1p1& p) {
+    fe_mul(r.X, p.X, p.T);
+    fe_mul(r.Y, p.Y, p.Z);
+    fe_mul(r.Z, p.Z, p.T);
+}
+
+constexpr void ge_p1p1_to_p3(ge_p3& r, const ge_p1p1& p) {
+    fe_mul(r.X, p.X, p.T);
+    fe_mul(r.Y, p.Y, p.Z);
+    fe_mul(r.Z, p.Z, p.T);
+    fe_mul(r.T, p.X, p.Y);
+}
+
+// r = 2 * p
+constexpr void ge_p2_dbl(ge_p1p1& r, const ge_p2& p) {
+    fe t0;
+    fe_sq(r.X, p.X);
+    fe_sq(r.Z, p.Y);
+    fe_sq(r.T, p.Z);
+    fe_add(r.T, r.T, r.T);
+    fe_add(r.Y, p.X, p.Y);
+    fe_sq(t0, r.Y);
+    fe_add(r.Y, r.Z, r.X);
+    fe_sub(r.Z, r.Z, r.X);
+    fe_sub_wide(r.X, t0, r.Y);
+    fe_sub_wide(r.T, r.T, r.Z);
+}
+
+constexpr void ge_p3_dbl(ge_p1p1& r, const ge_p3& p) {
+    ge_p2_dbl(r, ge_p2{p.X, p.Y, p.Z});
+}
+
+// r = p + q, q affine
+constexpr void ge_madd(ge_p1p1& r, const ge_p3& p, const ge_precomp& q) {
+    fe t0;
+    fe_add(r.X, p.Y, p.X);
+    fe_sub(r.Y, p.Y, p.X);
+    fe_mul(r.Z, r.X, q.yplusx);
+    fe_mul(r.Y, r.Y, q.yminusx);
+    fe_mul(r.T, q.xy2d, p.T);
+    fe_add(t0, p.Z, p.Z);
+    fe_sub(r.X, r.Z, r.Y);
+    fe_add(r.Y, r.Z, r.Y);
+    fe_add(r.Z, t0, r.T);
+    fe_sub(r.T, t0, r.T);
+}
+
+// Projective precomputed (Y + X, Y - X, Z, 2*d*T), used only for table generation
+struct ge_cached { fe YplusX, YminusX, Z, T2d; };
+
+constexpr void ge_p3_to_cached(ge_cached& r, const ge_p3& p) {
+    fe_add(r.YplusX, p.Y, p.X);
+    fe_sub(r.YminusX, p.Y, p.X);
+    r.Z = p.Z;
+    fe_mul(r.T2d, p.T, ED25519_D2);
+}
+
+// r = p + q
+constexpr void ge_add(ge_p1p1& r, const ge_p3& p, const ge_cached& q) {
+    fe t0;
+    fe_add(r.X, p.Y, p.X);
+    fe_sub(r.Y, p.Y, p.X);
+    fe_mul(r.Z, r.X, q.YplusX);
+    fe_mul(r.Y, r.Y, q.YminusX);
+    fe_mul(r.T, q.T2d, p.T);
+    fe_mul(r.X, p.Z, q.Z);
+    fe_add(t0, r.X, r.X);
+    fe_sub(r.X, r.Z, r.Y);
+    fe_add(r.Y, r.Z, r.Y);
+    fe_add(r.Z, t0, r.T);
+    fe_sub(r.T, t0, r.T);
+}
+
+// BASE_TABLE[i][j] = (j + 1) * 256^i * B, i = 0..31, j = 0..7
+using BaseTable = std::array<std::array<ge_precomp, 8>, 32>;
+
+constexpr BaseTable makeBaseTable() {
+    constexpr size_t ROWS = 32;
+    constexpr size_t COLS = 8;
+
+    // Multiples are computed projectively and normalized with a single
+    // batch inversion: per-entry fe_invert would exceed the compiler's
+    // constexpr evaluation budget
+    std::array<ge_p3, ROWS * COLS> points{};
+
+    ge_p3 base{};
+    base.X = ED25519_BX;
+    base.Y = ED25519_BY;
+    fe_1(base.Z);
+    fe_mul(base.T, ED25519_BX, ED25519_BY);
+
+    for (size_t i = 0; i < ROWS; ++i) {
+        ge_cached baseCached{};
+        ge_p3_to_cached(baseCached, base);
+
+        points[i * COLS] = base;
+        for (size_t j = 1; j < COLS; ++j) {
+            ge_p1p1 sum{};
+            ge_add(sum, points[i * COLS + j - 1], baseCached);
+            ge_p1p1_to_p3(points[i * COLS + j], sum);
         }
+
+        // base *= 256
+        ge_p1p1 doubled{};
+        ge_p2 half{base.X, base.Y, base.Z};
+        for (int k = 0; k < 7; ++k) {
+            ge_p2_dbl(doubled, half);
+            ge_p1p1_to_p2(half, doubled);
+        }
+        ge_p2_dbl(doubled, half);
+        ge_p1p1_to_p3(base, doubled);
     }
-    // Reduce
-    for (int i = 0; i < 16; ++i) {
-        h[i] = result[i] & 0xffff;
-        if (i + 1 < 16) {
-            result[i + 1] += result[i] >> 16;
+
+    // Montgomery batch inversion of all Z coordinates
+    std::array<fe, ROWS * COLS> prefix{};
+    prefix[0] = points[0].Z;
+    for (size_t n = 1; n < points.size(); ++n) {
+        fe_mul(prefix[n], prefix[n - 1], points[n].Z);
+    }
+
+    fe inv{};
+    fe_invert(inv, prefix[points.size() - 1]);
+
+    BaseTable table{};
+    fe zero{};
+    fe_0(zero);
+
+    for (size_t n = points.size(); n-- > 0; ) {
+        fe zinv{};
+        if (n > 0) {
+            fe_mul(zinv, inv, prefix[n - 1]);
+            fe_mul(inv, inv, points[n].Z);
+        } else {
+            zinv = inv;
         }
+
+        fe x{}, y{}, xy{};
+        fe_mul(x, points[n].X, zinv);
+        fe_mul(y, points[n].Y, zinv);
+
+        // Table entries are fed straight into fe_mul: keep them fully carried
+        ge_precomp& entry = table[n / COLS][n % COLS];
+        fe_add(entry.yplusx, y, x);
+        fe_sub_wide(entry.yplusx, entry.yplusx, zero);
+        fe_sub_wide(entry.yminusx, y, x);
+        fe_mul(xy, x, y);
+        fe_mul(entry.xy2d, xy, ED25519_D2);
     }
+
+    return table;
 }
 
-void fe_sq(fe& h, const fe& f) {
-    fe_mul(h, f, f);
-}
-
-void fe_invert(fe& out, const fe& z) {
-    fe t0, t1, t2, t3;
-    fe_sq(t0, z);
-    fe_sq(t1, t0);
-    fe_sq(t1, t1);
-    fe_mul(t1, z, t1);
-    fe_mul(t0, t0, t1);
-    fe_sq(t2, t0);
-    fe_mul(t1, t1, t2);
-    fe_sq(t2, t1);
-    for (int i = 0; i < 4; ++i) fe_sq(t2, t2);
-    fe_mul(t1, t2, t1);
-    fe_sq(t2, t1);
-    for (int i = 0; i < 9; ++i) fe_sq(t2, t2);
-    fe_mul(t2, t2, t1);
-    fe_sq(t3, t2);
-    for (int i = 0; i < 19; ++i) fe_sq(t3, t3);
-    fe_mul(t2, t3, t2);
-    fe_sq(t2, t2);
-    for (int i = 0; i < 9; ++i) fe_sq(t2, t2);
-    fe_mul(t1, t2, t1);
-    fe_sq(t2, t1);
-    for (int i = 0; i < 49; ++i) fe_sq(t2, t2);
-    fe_mul(t2, t2, t1);
-    fe_sq(t3, t2);
-    for (int i = 0; i < 99; ++i) fe_sq(t3, t3);
-    fe_mul(t2, t3, t2);
-    fe_sq(t2, t2);
-    for (int i = 0; i < 49; ++i) fe_sq(t2, t2);
-    fe_mul(t1, t2, t1);
-    fe_sq(t1, t1);
-    for (int i = 0; i < 4; ++i) fe_sq(t1, t1);
-    fe_mul(out, t1, t0);
-}
-
-void fe_cswap(fe& f, fe& g, int b) {
-    int64_t mask = -b;
-    for (int i = 0; i < 16; ++i) {
-        int64_t t = mask & (f[i] ^ g[i]);
-        f[i] ^= t;
-        g[i] ^= t;
+// Вычисляется компилятором, в рантайме таблица только читается (~30 КиБ)
+constexpr BaseTable BASE_TABLE = makeBaseTable();
+
+constexpr uint64_t ct_equal(int8_t b, int8_t c) {
+    const uint8_t x = static_cast<uint8_t>(b ^ c);
+    return (static_cast<uint64_t>(x) - 1) >> 63;
+}
+
+constexpr void fe_cmov(fe& f, const fe& g, uint64_t b) {
+    const uint64_t mask = 0 - b;
+    for (int i = 0; i < 5; ++i) {
+        f[i] ^= mask & (f[i] ^ g[i]);
     }
 }
 
-} // anonymous namespace
+constexpr void ge_precomp_cmov(ge_precomp& t, const ge_precomp& u, uint64_t b) {
+    fe_cmov(t.yplusx, u.yplusx, b);
+    fe_cmov(t.yminusx, u.yminusx, b);
+    fe_cmov(t.xy2d, u.xy2d, b);
+}
 
-void WireGuardKeys::curve25519ScalarMult(
-    std::array<uint8_t, KEY_SIZE>& result,
-    const std::array<uint8_t, KEY_SIZE>& scalar,
-    const std::array<uint8_t, KEY_SIZE>& point)
-{
-    fe x1, x2, x3, z2, z3, tmp0, tmp1;
+// t = b * 256^pos * B, b in [-8, 8]; reads every entry of the row
+// so the memory access pattern does not depend on b
+void ge_select(ge_precomp& t, size_t pos, int8_t b) {
+    const uint64_t negative = static_cast<uint64_t>(static_cast<int64_t>(b)) >> 63;
+    const int8_t babs = static_cast<int8_t>(b - static_cast<int8_t>(((0 - negative) & static_cast<uint64_t>(b)) << 1));
+
+    fe_1(t.yplusx);
+    fe_1(t.yminusx);
+    fe_0(t.xy2d);
+    for (int8_t j = 0; j < 8; ++j) {
+        ge_precomp_cmov(t, BASE_TABLE[pos][j], ct_equal(babs, static_cast<int8_t>(j + 1)));
+    }
+
+    ge_precomp minus;
+    fe zero;
+    fe_0(zero);
+    minus.yplusx = t.yminusx;
+    minus.yminusx = t.yplusx;
+    fe_sub_wide(minus.xy2d, zero, t.xy2d);
+    ge_precomp_cmov(t, minus, negative);
+}
 
-    fe_frombytes(x1, point.data());
+// Montgomery ladder (RFC 7748 §5) for an already clamped scalar.
+// Returns the projective result (x2 : z2); z2 == 0 for low-order inputs
+void montgomeryLadder(fe& x2, fe& z2, const uint8_t* scalar, const uint8_t* point) {
+    fe x1, x3, z3;
+    fe a, aa, b, bb, c, d, e, da, cb;
 
-    // Initialize
-    x2 = {};
-    x2[0] = 1;
-    z2 = {};
+    fe_frombytes(x1, point);
+    fe_1(x2);
+    fe_0(z2);
     x3 = x1;
-    z3 = {};
-    z3[0] = 1;
+    fe_1(z3);
 
-    int swap = 0;
+    uint64_t swap = 0;
 
-    // Montgomery ladder
     for (int pos = 254; pos >= 0; --pos) {
-        int b = (scalar[pos / 8] >> (pos & 7)) & 1;
-        swap ^= b;
+        const uint64_t bit = (scalar[pos / 8] >> (pos & 7)) & 1;
+        swap ^= bit;
         fe_cswap(x2, x3, swap);
         fe_cswap(z2, z3, swap);
-        swap = b;
-
-        fe_sub(tmp0, x3, z3);
-        fe_sub(tmp1, x2, z2);
-        fe_add(x2, x2, z2);
-        fe_add(z2, x3, z3);
-        fe_mul(z3, tmp0, x2);
-        fe_mul(z2, z2, tmp1);
-        fe_sq(tmp0, tmp1);
-        fe_sq(tmp1, x2);
-        fe_add(x3, z3, z2);
-        fe_sub(z2, z3, z2);
-        fe_mul(x2, tmp1, tmp0);
-        fe_sub(tmp1, tmp1, tmp0);
-        fe_sq(z2, z2);
-        // Simplified - full implementation uses curve constant
-        fe_mul(z3, tmp1, tmp1);
+        swap = bit;
+
+        fe_add(a, x2, z2);
+        fe_sq(aa, a);
+        fe_sub(b, x2, z2);
+        fe_sq(bb, b);
+        fe_sub(e, aa, bb);
+        fe_add(c, x3, z3);
+        fe_sub(d, x3, z3);
+        fe_mul(da, d, a);
+        fe_mul(cb, c, b);
+
+        fe_add(x3, da, cb);
         fe_sq(x3, x3);
-        fe_add(tmp0, tmp0, z3);
-        fe_mul(z3, x1, z2);
-        fe_mul(z2, tmp1, tmp0);
+        fe_sub(z3, da, cb);
+        fe_sq(z3, z3);
+        fe_mul(z3, z3, x1);
+        fe_mul(x2, aa, bb);
+        fe_mul_a24(z2, e);
+        fe_add(z2, z2, aa);
+        fe_mul(z2, z2, e);
     }
 
     fe_cswap(x2, x3, swap);
     fe_cswap(z2, z3, swap);
+}
 
-    fe_invert(z2, z2);
-    fe_mul(x2, x2, z2);
-    fe_tobytes(result.data(), x2);
+// 1 if f == 0 (mod p), 0 otherwise; constant-time
+uint64_t fe_iszero(const fe& f) {
+    uint8_t bytes[KEY_SIZE];
+    fe_tobytes(bytes, f);
+    uint8_t acc = 0;
+    for (uint8_t byte : bytes) {
+        acc |= byte;
+    }
+    return (static_cast<uint64_t>(acc) - 1) >> 63;
 }
 
-std::string WireGuardKeys::toBase64(const std::array<uint8_t, KEY_SIZE>& key) {
-    std::string result;
-    result.reserve(((KEY_SIZE + 2) / 3) * 4);
+// Montgomery's simultaneous inversion: out[i] = 1 / z[i] with one fe_invert
+// and 3(n - 1) multiplications. All z[i] must be non-zero
+void fe_batch_invert(std::span<fe> out, std::span<const fe> z, std::span<fe> scratch) {
+    const size_t n = z.size();
+    if (n == 0) return;
+
+    scratch[0] = z[0];
+    for (size_t i = 1; i < n; ++i) {
+        fe_mul(scratch[i], scratch[i - 1], z[i]);
+    }
 
-    for (size_t i = 0; i < KEY_SIZE; i += 3) {
-        uint32_t val = static_cast<uint32_t>(key[i]) << 16;
-        if (i + 1 < KEY_SIZE) val |= static_cast<uint32_t>(key[i + 1]) << 8;
-        if (i + 2 < KEY_SIZE) val |= static_cast<uint32_t>(key[i + 2]);
+    fe inv;
+    fe_invert(inv, scratch[n - 1]);
 
-        result += BASE64_CHARS[(val >> 18) & 0x3F];
-        result += BASE64_CHARS[(val >> 12) & 0x3F];
-        result += (i + 1 < KEY_SIZE) ? BASE64_CHARS[(val >> 6) & 0x3F] : '=';
-        result += (i + 2 < KEY_SIZE) ? BASE64_CHARS[val & 0x3F] : '=';
+    for (size_t i = n - 1; i > 0; --i) {
+        fe_mul(out[i], inv, scratch[i - 1]);
+        fe_mul(inv, inv, z[i]);
     }
+    out[0] = inv;
+}
 
-    return result;
+} // anonymous namespace
+
+// Fixed-base X25519: [k]B on the Edwards curve using the precomputed
+// radix-16 comb table (64 table additions, 4 doublings), then u = (Z + Y) / (Z - Y)
+void WireGuardKeys::curve25519ScalarMultBase(
+    std::array<uint8_t, KEY_SIZE>& result,
+    const std::array<uint8_t, KEY_SIZE>& scalar)
+{
+    std::array<uint8_t, KEY_SIZE> k = scalar;
+    clampPrivateKey(k);
+
+    // Signed radix-16 digits e[i] in [-8, 8], k = sum(e[i] * 16^i)
+    std::array<int8_t, 64> e;
+    for (size_t i = 0; i < KEY_SIZE; ++i) {
+        e[2 * i] = static_cast<int8_t>(k[i] & 15);
+        e[2 * i + 1] = static_cast<int8_t>(k[i] >> 4);
+    }
+
+    int8_t carry = 0;
+    for (size_t i = 0; i < 63; ++i) {
+        e[i] = static_cast<int8_t>(e[i] + carry);
+        carry = static_cast<int8_t>((e[i] + 8) >> 4);
+        e[i] = static_cast<int8_t>(e[i] - carry * 16);
+    }
+    e[63] = static_cast<int8_t>(e[63] + carry);
+
+    ge_p3 h;
+    ge_p1p1 r;
+    ge_p2 s;
+    ge_precomp t;
+
+    // Odd digits first, then multiply by 16 and add the even digits
+    ge_p3_0(h);
+    for (size_t i = 1; i < 64; i += 2) {
+        ge_select(t, i / 2, e[i]);
+        ge_madd(r, h, t);
+        ge_p1p1_to_p3(h, r);
+    }
+
+    ge_p3_dbl(r, h);
+    ge_p1p1_to_p2(s, r);
+    ge_p2_dbl(r, s);
+    ge_p1p1_to_p2(s, r);
+    ge_p2_dbl(r, s);
+    ge_p1p1_to_p2(s, r);
+    ge_p2_dbl(r, s);
+    ge_p1p1_to_p3(h, r);
+
+    for (size_t i = 0; i < 64; i += 2) {
+        ge_select(t, i / 2, e[i]);
+        ge_madd(r, h, t);
+        ge_p1p1_to_p3(h, r);
+    }
+
+    fe zplusy, zminusy, u;
+    fe_add(zplusy, h.Z, h.Y);
+    fe_sub(zminusy, h.Z, h.Y);
+    fe_invert(zminusy, zminusy);
+    fe_mul(u, zplusy, zminusy);
+    fe_tobytes(result.data(), u);
+
+    std::fill(k.begin(), k.end(), uint8_t(0));
+    std::fill(e.begin(), e.end(), int8_t(0));
 }
 
-std::optional<std::array<uint8_t, KEY_SIZE>> WireGuardKeys::fromBase64(const std::string& base64) {
-    if (base64.length() != 44) { // 32 bytes = 44 base64 chars with padding
+std::optional<std::array<uint8_t, KEY_SIZE>> WireGuardKeys::sharedSecret(
+    const std::array<uint8_t, KEY_SIZE>& privateKey,
+    const std::array<uint8_t, KEY_SIZE>& publicKey)
+{
+    std::array<uint8_t, KEY_SIZE> k = privateKey;
+    clampPrivateKey(k);
+
+    fe x2, z2;
+    montgomeryLadder(x2, z2, k.data(), publicKey.data());
+    std::fill(k.begin(), k.end(), uint8_t(0));
+
+    // Точка малого порядка даёт z2 == 0 и нулевой секрет
+    if (fe_iszero(z2)) {
         return std::nullopt;
     }
 
     std::array<uint8_t, KEY_SIZE> result;
-    size_t resultIdx = 0;
+    fe_invert(z2, z2);
+    fe_mul(x2, x2, z2);
+    fe_tobytes(result.data(), x2);
+    return result;
+}
+
+size_t WireGuardKeys::sharedSecrets(
+    const std::array<uint8_t, KEY_SIZE>& privateKey,
+    std::span<const std::array<uint8_t, KEY_SIZE>> publicKeys,
+    std::span<std::array<uint8_t, KEY_SIZE>> out,
+    std::span<bool> valid)
+{
+    return sharedSecrets(std::span(&privateKey, 1), publicKeys, out, valid);
+}
 
-    for (size_t i = 0; i < base64.length() && resultIdx < KEY_SIZE; i += 4) {
-        uint32_t val = 0;
-        int validChars = 0;
+size_t WireGuardKeys::sharedSecrets(
+    std::span<const std::array<uint8_t, KEY_SIZE>> privateKeys,
+    std::span<const std::array<uint8_t, KEY_SIZE>> publicKeys,
+    std::span<std::array<uint8_t, KEY_SIZE>> out,
+    std::span<bool> valid)
+{
+    if (privateKeys.empty() || (privateKeys.size() != 1 && privateKeys.size() != publicKeys.size())) {
+        return 0;
+    }
 
-        for (int j = 0; j < 4 && i + j < base64.length(); ++j) {
-            char c = base64[i + j];
-            if (c == '=') break;
+    // Пачками по SHARED_SECRET_CHUNK: одно fe_invert на пачку, рабочие
+    // массивы помещаются в стек и L1
+    constexpr size_t SHARED_SECRET_CHUNK = 128;
+    std::array<fe, SHARED_SECRET_CHUNK> x, z, zinv, scratch;
+    std::array<uint64_t, SHARED_SECRET_CHUNK> lowOrder;
+    std::array<uint8_t, KEY_SIZE> k;
 
-            const char* pos = std::strchr(BASE64_CHARS, c);
-            if (!pos) return std::nullopt;
+    fe one;
+    fe_1(one);
 
-            val = (val << 6) | static_cast<uint32_t>(pos - BASE64_CHARS);
-            ++validChars;
-        }
+    const size_t count = std::min(publicKeys.size(), out.size());
+    size_t computed = 0;
+
+    for (size_t begin = 0; begin < count; begin += SHARED_SECRET_CHUNK) {
+        const size_t n = std::min(SHARED_SECRET_CHUNK, count - begin);
+
+        for (size_t i = 0; i < n; ++i) {
+            k = privateKeys.size() == 1 ? privateKeys[0] : privateKeys[begin + i];
+            clampPrivateKey(k);
+            montgomeryLadder(x[i], z[i], k.data(), publicKeys[begin + i].data());
 
-        val <<= (4 - validChars) * 6;
+            // Нулевой z испортил бы общее произведение: подменяем на 1
+            lowOrder[i] = fe_iszero(z[i]);
+            fe_cmov(z[i], one, lowOrder[i]);
+        }
 
-        if (validChars >= 2 && resultIdx < KEY_SIZE) result[resultIdx++] = (val >> 16) & 0xFF;
-        if (validChars >= 3 && resultIdx < KEY_SIZE) result[resultIdx++] = (val >> 8) & 0xFF;
-        if (validChars >= 4 && resultIdx < KEY_SIZE) result[resultIdx++] = val & 0xFF;
+        fe_batch_invert(std::span(zinv.data(), n), std::span<const fe>(z.data(), n),
+                        std::span(scratch.data(), n));
+
+        for (size_t i = 0; i < n; ++i) {
+            const bool ok = lowOrder[i] == 0;
+            if (ok) {
+                fe_mul(x[i], x[i], zinv[i]);
+                fe_tobytes(out[begin + i].data(), x[i]);
+                ++computed;
+            } else {
+                out[begin + i].fill(0);
+            }
+            if (begin + i < valid.size()) {
+                valid[begin + i] = ok;
+            }
+        }
     }
 
-    return result;
+    std::fill(k.begin(), k.end(), uint8_t(0));
+    return computed;
 }
 
 } // namespace obsidian
@@ -0,0 +1,362 @@
+#include "WireGuardKeys.h"
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define OBSIDIAN_BASE64_X86 1
+#include <immintrin.h>
+#endif
+
+// Base64 для ключей WireGuard: 32 байта <-> 44 символа ("...=").
+// Первые 24 байта (32 символа) обрабатываются SIMD-ядром (AVX2 или SSSE3,
+// выбирается в рантайме), остаток и машины без SIMD - табличный скалярный код.
+
+namespace obsidian {
+
+namespace {
+
+constexpr char BASE64_CHARS[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+constexpr uint8_t INVALID = 0xFF;
+
+constexpr std::array<uint8_t, 256> makeDecodeTable() {
+    std::array<uint8_t, 256> table{};
+    for (auto& v : table) v = INVALID;
+    for (uint8_t i = 0; i < 64; ++i) {
+        table[static_cast<uint8_t>(BASE64_CHARS[i])] = i;
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> DECODE_TABLE = makeDecodeTable();
+
+// 3 байта -> 4 символа
+inline void encodeTriple(const uint8_t* in, char* out) {
+    const uint32_t v = (uint32_t(in[0]) << 16) | (uint32_t(in[1]) << 8) | in[2];
+    out[0] = BASE64_CHARS[(v >> 18) & 0x3F];
+    out[1] = BASE64_CHARS[(v >> 12) & 0x3F];
+    out[2] = BASE64_CHARS[(v >> 6) & 0x3F];
+    out[3] = BASE64_CHARS[v & 0x3F];
+}
+
+// 4 символа -> 3 байта; false при недопустимом символе
+inline bool decodeQuad(const char* in, uint8_t* out) {
+    const uint32_t a = DECODE_TABLE[static_cast<uint8_t>(in[0])];
+    const uint32_t b = DECODE_TABLE[static_cast<uint8_t>(in[1])];
+    const uint32_t c = DECODE_TABLE[static_cast<uint8_t>(in[2])];
+    const uint32_t d = DECODE_TABLE[static_cast<uint8_t>(in[3])];
+    if ((a | b | c | d) & 0x80) return false;
+
+    const uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+    out[0] = static_cast<uint8_t>(v >> 16);
+    out[1] = static_cast<uint8_t>(v >> 8);
+    out[2] = static_cast<uint8_t>(v);
+    return true;
+}
+
+// Байты 24..31 -> символы 32..43, включая завершающий '='
+inline void encodeTail(const uint8_t* key, char* out) {
+    encodeTriple(key + 24, out + 32);
+    encodeTriple(key + 27, out + 36);
+
+    const uint32_t v = (uint32_t(key[30]) << 8) | key[31];
+    out[40] = BASE64_CHARS[(v >> 10) & 0x3F];
+    out[41] = BASE64_CHARS[(v >> 4) & 0x3F];
+    out[42] = BASE64_CHARS[(v << 2) & 0x3F];
+    out[43] = '=';
+}
+
+// Символы 32..43 -> байты 24..31. Строгая проверка: ровно один '=' в конце
+// и нулевые младшие 2 бита последнего значащего символа (канонический вид)
+inline bool decodeTail(const char* in, uint8_t* key) {
+    if (!decodeQuad(in + 32, key + 24)) return false;
+
+    uint8_t last[3];
+    if (!decodeQuad(in + 36, last)) return false;
+    key[27] = last[0];
+    key[28] = last[1];
+    key[29] = last[2];
+
+    if (in[43] != '=') return false;
+
+    const uint32_t a = DECODE_TABLE[static_cast<uint8_t>(in[40])];
+    const uint32_t b = DECODE_TABLE[static_cast<uint8_t>(in[41])];
+    const uint32_t c = DECODE_TABLE[static_cast<uint8_t>(in[42])];
+    if ((a | b | c) & 0x80) return false;
+    if (c & 0x03) return false;
+
+    const uint32_t v = (a << 12) | (b << 6) | c;
+    key[30] = static_cast<uint8_t>(v >> 10);
+    key[31] = static_cast<uint8_t>(v >> 2);
+    return true;
+}
+
+void encodeKeyScalar(const uint8_t* key, char* out) {
+    for (size_t i = 0; i < 8; ++i) {
+        encodeTriple(key + 3 * i, out + 4 * i);
+    }
+    encodeTail(key, out);
+}
+
+bool decodeKeyScalar(const char* in, uint8_t* key) {
+    for (size_t i = 0; i < 8; ++i) {
+        if (!decodeQuad(in + 4 * i, key + 3 * i)) return false;
+    }
+    return decodeTail(in, key);
+}
+
+#ifdef OBSIDIAN_BASE64_X86
+
+// Алгоритмы W. Muła / D. Lemire: 12 байт <-> 16 символов на 128-битную полосу
+
+__attribute__((target("ssse3")))
+inline __m128i encodeReshuffle(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+__attribute__((target("ssse3")))
+inline __m128i encodeTranslate(__m128i indices) {
+    __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+    const __m128i shift = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+        '/' - 63, 'A', 0, 0);
+    result = _mm_shuffle_epi8(shift, result);
+    return _mm_add_epi8(result, indices);
+}
+
+// Символы -> 6-битные значения; ok = false, если встретился символ вне алфавита
+__attribute__((target("ssse3")))
+inline __m128i decodeTranslate(__m128i in, bool& ok) {
+    const __m128i lutLo = _mm_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lutHi = _mm_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71,
+        0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask0F = _mm_set1_epi8(0x0F);
+
+    const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), mask0F);
+    const __m128i loNibbles = _mm_and_si128(in, mask0F);
+    const __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+    const __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+
+    ok = _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) == 0;
+
+    const __m128i eqSlash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+    const __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eqSlash, hiNibbles));
+    return _mm_add_epi8(in, roll);
+}
+
+__attribute__((target("ssse3")))
+inline __m128i decodePack(__m128i values) {
+    const __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(packed, _mm_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+__attribute__((target("ssse3")))
+void encodeKeySsse3(const uint8_t* key, char* out) {
+    // Загрузки по смещениям 0 и 12 читают байты 0..27 - в пределах ключа
+    const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+    const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 12));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), encodeTranslate(encodeReshuffle(lo)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), encodeTranslate(encodeReshuffle(hi)));
+    encodeTail(key, out);
+}
+
+__attribute__((target("ssse3")))
+bool decodeKeySsse3(const char* in, uint8_t* key) {
+    bool okLo = false;
+    bool okHi = false;
+    const __m128i lo = decodeTranslate(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), okLo);
+    const __m128i hi = decodeTranslate(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16)), okHi);
+    if (!(okLo && okHi)) return false;
+
+    // Каждая запись - 16 байт, из которых значимы первые 12; вторая
+    // перекрывает хвост первой, а байты 24..27 перезапишет decodeTail
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(key), decodePack(lo));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(key + 12), decodePack(hi));
+    return decodeTail(in, key);
+}
+
+__attribute__((target("avx2")))
+void encodeKeyAvx2(const uint8_t* key, char* out) {
+    const __m256i in = _mm256_setr_m128i(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(key)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 12)));
+
+    __m256i shuffled = _mm256_shuffle_epi8(in, _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    const __m256i t0 = _mm256_and_si256(shuffled, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(shuffled, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    const __m256i indices = _mm256_or_si256(t1, t3);
+
+    __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    const __m256i shift = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+        '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+        '/' - 63, 'A', 0, 0);
+    result = _mm256_add_epi8(_mm256_shuffle_epi8(shift, result), indices);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), result);
+    encodeTail(key, out);
+}
+
+__attribute__((target("avx2")))
+bool decodeKeyAvx2(const char* in, uint8_t* key) {
+    const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+
+    const __m256i lutLo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lutHi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lutRoll = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71,
+        0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71,
+        0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask0F = _mm256_set1_epi8(0x0F);
+
+    const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(chars, 4), mask0F);
+    const __m256i loNibbles = _mm256_and_si256(chars, mask0F);
+    const __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+    const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+    if (!_mm256_testz_si256(lo, hi)) return false;
+
+    const __m256i eqSlash = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('/'));
+    const __m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eqSlash, hiNibbles));
+    const __m256i values = _mm256_add_epi8(chars, roll);
+
+    const __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+    packed = _mm256_shuffle_epi8(packed, _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+    // 32-байтная запись: значимы первые 24 байта, остальное перезапишет decodeTail
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(key), packed);
+
+    // GCC превращает вызов decodeTail в хвостовой jmp без vzeroupper, и грязные
+    // старшие половины ymm замедляют весь последующий SSE-код вызывающего в разы
+    _mm256_zeroupper();
+    return decodeTail(in, key);
+}
+
+#endif // OBSIDIAN_BASE64_X86
+
+using EncodeKeyFn = void (*)(const uint8_t*, char*);
+using DecodeKeyFn = bool (*)(const char*, uint8_t*);
+
+struct Base64Kernels {
+    EncodeKeyFn encode = encodeKeyScalar;
+    DecodeKeyFn decode = decodeKeyScalar;
+};
+
+Base64Kernels selectKernels() {
+    Base64Kernels kernels;
+#ifdef OBSIDIAN_BASE64_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.encode = encodeKeyAvx2;
+        kernels.decode = decodeKeyAvx2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        kernels.encode = encodeKeySsse3;
+        kernels.decode = decodeKeySsse3;
+    }
+#endif
+    return kernels;
+}
+
+const Base64Kernels& kernels() {
+    static const Base64Kernels selected = selectKernels();
+    return selected;
+}
+
+} // anonymous namespace
+
+std::string WireGuardKeys::toBase64(const std::array<uint8_t, KEY_SIZE>& key) {
+    std::string result(KEY_BASE64_SIZE, '\0');
+    toBase64(key, result.data());
+    return result;
+}
+
+void WireGuardKeys::toBase64(const std::array<uint8_t, KEY_SIZE>& key, char* out) {
+    kernels().encode(key.data(), out);
+}
+
+std::optional<std::array<uint8_t, KEY_SIZE>> WireGuardKeys::fromBase64(const std::string& base64) {
+    std::array<uint8_t, KEY_SIZE> result;
+    if (!fromBase64(std::string_view(base64), result)) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+bool WireGuardKeys::fromBase64(std::string_view base64, std::array<uint8_t, KEY_SIZE>& out) {
+    if (base64.size() != KEY_BASE64_SIZE) {
+        return false;
+    }
+
+    // SIMD-ядра пишут блоками шире результата: декодируем во временный буфер
+    std::array<uint8_t, KEY_SIZE> key;
+    if (!kernels().decode(base64.data(), key.data())) {
+        return false;
+    }
+
+    out = key;
+    return true;
+}
+
+size_t WireGuardKeys::fromBase64(std::span<const std::string_view> base64,
+                                 std::span<std::array<uint8_t, KEY_SIZE>> out,
+                                 std::span<bool> valid)
+{
+    const size_t count = std::min(base64.size(), out.size());
+    const DecodeKeyFn decode = kernels().decode;
+    size_t decoded = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        std::array<uint8_t, KEY_SIZE> key;
+        const bool ok = base64[i].size() == KEY_BASE64_SIZE && decode(base64[i].data(), key.data());
+        if (ok) {
+            out[i] = key;
+            ++decoded;
+        } else {
+            out[i].fill(0);
+        }
+        if (i < valid.size()) {
+            valid[i] = ok;
+        }
+    }
+
+    return decoded;
+}
+
+} // namespace obsidian
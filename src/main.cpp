@@ -2,11 +2,16 @@
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
 #include <QIcon>
+#include <QTimer>
 
 #include "ApiClient.h"
 #include "ConfigManager.h"
 #include "VpnConnection.h"
 #include "KeyGenerator.h"
+#include "KeyPool.h"
+#include "HandshakeProbe.h"
+#include "TlsSessionCache.h"
+#include "PeerListModel.h"
 
 int main(int argc, char *argv[]) {
     QGuiApplication app(argc, argv);
@@ -18,11 +23,24 @@ int main(int argc, char *argv[]) {
 
     // Create core objects
     obsidian::ConfigManager configManager;
+    // Before apiClient: its replies store tickets here until it is destroyed
+    obsidian::TlsSessionCache tlsSessionCache(obsidian::ConfigManager::tlsSessionCachePath());
     obsidian::ApiClient apiClient;
     obsidian::VpnConnection vpnConnection;
+    obsidian::KeyPool keyPool(configManager.keyPoolSize());
     obsidian::KeyGenerator keyGenerator;
-
-    // Set server URL from config
+    keyGenerator.setKeyPool(&keyPool);
+    obsidian::HandshakeProbe handshakeProbe;
+    obsidian::PeerListModel peerListModel;
+
+    // Set server URL from config (this also pre-connects to the server,
+    // so HTTP/2 and the saved TLS session must be configured first)
+    if (const std::optional<bool> http2 = configManager.http2Enabled()) {
+        apiClient.setHttp2Enabled(*http2);
+    }
+    apiClient.setBulkConcurrency(configManager.bulkConcurrency());
+    apiClient.setBackgroundConcurrency(configManager.backgroundConcurrency());
+    apiClient.setTlsSessionCache(&tlsSessionCache);
     apiClient.setServerUrl(configManager.serverUrl());
 
     // Load saved tokens if available
@@ -41,6 +59,40 @@ int main(int argc, char *argv[]) {
                          configManager.saveTokens(tokens.accessToken, tokens.refreshToken);
                      });
 
+    // Keep the stored tokens in step with background refreshes
+    QObject::connect(&apiClient, &obsidian::ApiClient::tokenRefreshed,
+                     [&](const obsidian::AuthTokens& tokens) {
+                         configManager.saveTokens(tokens.accessToken, tokens.refreshToken);
+                     });
+
+    // Peer list shown in QML: every update is diffed into the model, which
+    // is connected before QML so its rows are current when QML handlers run
+    QObject::connect(&apiClient, &obsidian::ApiClient::peersLoaded,
+                     &peerListModel, &obsidian::PeerListModel::setPeers);
+    QObject::connect(&apiClient, &obsidian::ApiClient::peersBatchLoaded,
+                     &peerListModel, &obsidian::PeerListModel::addBatch);
+    QObject::connect(&apiClient, &obsidian::ApiClient::peerAdded,
+                     &peerListModel, &obsidian::PeerListModel::upsertPeer);
+    QObject::connect(&apiClient, &obsidian::ApiClient::peerUpdated,
+                     &peerListModel, &obsidian::PeerListModel::upsertPeer);
+    QObject::connect(&apiClient, &obsidian::ApiClient::peerRemoved,
+                     &peerListModel, &obsidian::PeerListModel::removePeer);
+    QObject::connect(&apiClient, &obsidian::ApiClient::peerDeleted,
+                     &peerListModel, &obsidian::PeerListModel::removePeer);
+
+    peerListModel.setCurrentPeerId(configManager.currentPeerId());
+    QObject::connect(&configManager, &obsidian::ConfigManager::currentPeerIdChanged,
+                     [&]() { peerListModel.setCurrentPeerId(configManager.currentPeerId()); });
+
+    // Periodic metrics dump, e.g. for the node_exporter textfile collector
+    QTimer metricsTimer;
+    if (configManager.metricsInterval() > 0) {
+        QObject::connect(&metricsTimer, &QTimer::timeout, [&]() {
+            apiClient.writeMetrics(obsidian::ConfigManager::metricsFilePath());
+        });
+        metricsTimer.start(configManager.metricsInterval() * 1000);
+    }
+
     // Clear tokens on logout
     QObject::connect(&apiClient, &obsidian::ApiClient::authenticationChanged,
                      [&]() {
@@ -56,6 +108,9 @@ int main(int argc, char *argv[]) {
     engine.rootContext()->setContextProperty("apiClient", &apiClient);
     engine.rootContext()->setContextProperty("vpnConnection", &vpnConnection);
     engine.rootContext()->setContextProperty("keyGenerator", &keyGenerator);
+    engine.rootContext()->setContextProperty("keyPool", &keyPool);
+    engine.rootContext()->setContextProperty("handshakeProbe", &handshakeProbe);
+    engine.rootContext()->setContextProperty("peerListModel", &peerListModel);
 
     // Register types for QML
     qmlRegisterUncreatableType<obsidian::VpnConnection>(
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Минимальные проверки для тестов без Qt: CHECK печатает место ошибки и
+// продолжает, main возвращает TEST_RESULT() - ненулевой код при провале.
+
+namespace obsidian::test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline std::vector<uint8_t> fromHex(std::string_view hex) {
+    std::vector<uint8_t> bytes(hex.size() / 2);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<uint8_t>(std::stoul(std::string(hex.substr(2 * i, 2)), nullptr, 16));
+    }
+    return bytes;
+}
+
+template <size_t N>
+std::array<uint8_t, N> arrayFromHex(std::string_view hex) {
+    std::array<uint8_t, N> out{};
+    const std::vector<uint8_t> bytes = fromHex(hex);
+    std::copy_n(bytes.begin(), std::min(N, bytes.size()), out.begin());
+    return out;
+}
+
+inline std::string toHex(std::span<const uint8_t> bytes) {
+    static constexpr char DIGITS[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(bytes.size() * 2);
+    for (const uint8_t byte : bytes) {
+        hex += DIGITS[byte >> 4];
+        hex += DIGITS[byte & 0xf];
+    }
+    return hex;
+}
+
+inline bool check(bool ok, const char* expression, const char* file, int line) {
+    if (!ok) {
+        std::fprintf(stderr, "%s:%d: FAIL: %s\n", file, line, expression);
+        ++failures();
+    }
+    return ok;
+}
+
+inline bool checkHex(std::span<const uint8_t> actual, std::string_view expected,
+                     const char* expression, const char* file, int line)
+{
+    const std::string hex = toHex(actual);
+    if (hex != expected) {
+        std::fprintf(stderr, "%s:%d: FAIL: %s\n  actual:   %s\n  expected: %.*s\n", file, line,
+                     expression, hex.c_str(), static_cast<int>(expected.size()), expected.data());
+        ++failures();
+        return false;
+    }
+    return true;
+}
+
+inline int result(const char* name) {
+    if (failures() == 0) {
+        std::printf("%s: all checks passed\n", name);
+        return 0;
+    }
+    std::printf("%s: %d check(s) failed\n", name, failures());
+    return 1;
+}
+
+} // namespace obsidian::test
+
+#define CHECK(condition) ::obsidian::test::check((condition), #condition, __FILE__, __LINE__)
+#define CHECK_HEX(bytes, hex) ::obsidian::test::checkHex((bytes), (hex), #bytes, __FILE__, __LINE__)
+#define TEST_RESULT(name) ::obsidian::test::result(name)
@@ -0,0 +1,216 @@
+#pragma once
+
+#include "Blake2s.h"
+#include "ChaCha20Poly1305.h"
+#include "WireGuardHandshake.h"
+#include "WireGuardKeys.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+
+// Сторона сервера рукопожатия WireGuard для тестов: принимает сообщение 1
+// от WireGuardHandshake и отвечает сообщением 2 или cookie reply. Без Qt;
+// известные пиры не проверяются - отвечаем любому инициатору с верным mac1.
+
+namespace obsidian::test {
+
+class WireGuardResponder {
+public:
+    using Key = WireGuardHandshake::Key;
+    using Response = std::array<uint8_t, WireGuardHandshake::RESPONSE_SIZE>;
+    using CookieReply = std::array<uint8_t, WireGuardHandshake::COOKIE_REPLY_SIZE>;
+
+    explicit WireGuardResponder(const Key& privateKey, const Key& presharedKey = {})
+        : m_private(privateKey)
+        , m_public(WireGuardKeys::derivePublicKey(privateKey))
+        , m_presharedKey(presharedKey)
+    {
+    }
+
+    const Key& publicKey() const { return m_public; }
+
+    // Сообщение 2 на сообщение 1; nullopt, если initiation не прошло проверку
+    std::optional<Response> respond(std::span<const uint8_t> initiation, uint32_t senderIndex) const {
+        if (!validInitiation(initiation)) {
+            return std::nullopt;
+        }
+
+        // Ci, Hi как у инициатора, затем e
+        Blake2s::Hash chainingKey = Blake2s::hash(bytes(CONSTRUCTION, sizeof(CONSTRUCTION) - 1));
+        Blake2s::Hash hash = chainingKey;
+        mixHash(hash, bytes(IDENTIFIER, sizeof(IDENTIFIER) - 1));
+        mixHash(hash, m_public);
+
+        Key initiatorEphemeral;
+        std::memcpy(initiatorEphemeral.data(), initiation.data() + INIT_EPHEMERAL, KEY_SIZE);
+        Blake2s::hkdf(chainingKey, initiatorEphemeral, chainingKey);
+        mixHash(hash, initiatorEphemeral);
+
+        // es, s
+        const auto dhEphemeralStatic = WireGuardKeys::sharedSecret(m_private, initiatorEphemeral);
+        if (!dhEphemeralStatic) {
+            return std::nullopt;
+        }
+        ChaCha20Poly1305::Key key;
+        Blake2s::hkdf(chainingKey, *dhEphemeralStatic, chainingKey, &key);
+        std::array<uint8_t, KEY_SIZE + ChaCha20Poly1305::TAG_SIZE> encryptedStatic;
+        std::memcpy(encryptedStatic.data(), initiation.data() + INIT_STATIC, encryptedStatic.size());
+        std::array<uint8_t, KEY_SIZE + ChaCha20Poly1305::TAG_SIZE> staticKey = encryptedStatic;
+        if (!ChaCha20Poly1305::open(staticKey, hash, ChaCha20Poly1305::counterNonce(0), key)) {
+            return std::nullopt;
+        }
+        mixHash(hash, encryptedStatic);
+        Key initiatorStatic;
+        std::memcpy(initiatorStatic.data(), staticKey.data(), KEY_SIZE);
+
+        // ss, timestamp
+        const auto dhStaticStatic = WireGuardKeys::sharedSecret(m_private, initiatorStatic);
+        if (!dhStaticStatic) {
+            return std::nullopt;
+        }
+        Blake2s::hkdf(chainingKey, *dhStaticStatic, chainingKey, &key);
+        std::array<uint8_t, 12 + ChaCha20Poly1305::TAG_SIZE> encryptedTimestamp;
+        std::memcpy(encryptedTimestamp.data(), initiation.data() + INIT_TIMESTAMP, encryptedTimestamp.size());
+        std::array<uint8_t, 12 + ChaCha20Poly1305::TAG_SIZE> timestamp = encryptedTimestamp;
+        if (!ChaCha20Poly1305::open(timestamp, hash, ChaCha20Poly1305::counterNonce(0), key)) {
+            return std::nullopt;
+        }
+        mixHash(hash, encryptedTimestamp);
+
+        // Сообщение 2: e, ee, se, psk, empty
+        const auto ephemeral = WireGuardKeys::generateKeyPair();
+        if (!ephemeral) {
+            return std::nullopt;
+        }
+        const auto dhEphemeralEphemeral = WireGuardKeys::sharedSecret(ephemeral->privateKey, initiatorEphemeral);
+        const auto dhEphemeralInitiator = WireGuardKeys::sharedSecret(ephemeral->privateKey, initiatorStatic);
+        if (!dhEphemeralEphemeral || !dhEphemeralInitiator) {
+            return std::nullopt;
+        }
+
+        Response response{};
+        response[0] = static_cast<uint8_t>(WireGuardHandshake::MessageType::Response);
+        store32_le(response.data() + RESP_SENDER, senderIndex);
+        std::memcpy(response.data() + RESP_RECEIVER, initiation.data() + INIT_SENDER, 4);
+        std::memcpy(response.data() + RESP_EPHEMERAL, ephemeral->publicKey.data(), KEY_SIZE);
+
+        Blake2s::hkdf(chainingKey, ephemeral->publicKey, chainingKey);
+        mixHash(hash, ephemeral->publicKey);
+        Blake2s::hkdf(chainingKey, *dhEphemeralEphemeral, chainingKey);
+        Blake2s::hkdf(chainingKey, *dhEphemeralInitiator, chainingKey);
+
+        Blake2s::Hash tau;
+        Blake2s::hkdf(chainingKey, m_presharedKey, chainingKey, &tau, &key);
+        mixHash(hash, tau);
+        std::span<uint8_t> empty(response.data() + RESP_EMPTY, ChaCha20Poly1305::TAG_SIZE);
+        ChaCha20Poly1305::seal(empty, hash, ChaCha20Poly1305::counterNonce(0), key);
+
+        mac1(response.data() + RESP_MAC1, initiatorStatic, std::span<const uint8_t>(response).first(RESP_MAC1));
+        return response;
+    }
+
+    // Ответ сервера под нагрузкой: cookie зашифрован XChaCha20-Poly1305
+    // ключом HASH("cookie--" || Spub_r) с mac1 инициатора в качестве AD;
+    // nullopt, если initiation не прошло проверку
+    std::optional<CookieReply> cookieReply(std::span<const uint8_t> initiation) const {
+        if (!validInitiation(initiation)) {
+            return std::nullopt;
+        }
+
+        CookieReply reply{};
+        reply[0] = static_cast<uint8_t>(WireGuardHandshake::MessageType::CookieReply);
+        std::memcpy(reply.data() + COOKIE_RECEIVER, initiation.data() + INIT_SENDER, 4);
+
+        // Настоящий сервер берёт cookie = MAC(секрет, адрес отправителя) и
+        // случайный nonce; тесту хватает значений, выведенных из самого пакета
+        const Blake2s::Hash digest = Blake2s::hash(initiation);
+        ChaCha20Poly1305::XNonce nonce;
+        std::copy_n(digest.begin(), nonce.size(), nonce.begin());
+        std::array<uint8_t, MAC_SIZE> cookie;
+        Blake2s::hash(cookie, initiation.subspan(INIT_EPHEMERAL, KEY_SIZE), m_private);
+        std::memcpy(reply.data() + COOKIE_NONCE, nonce.data(), nonce.size());
+
+        Blake2s keyState;
+        keyState.update(bytes(LABEL_COOKIE, sizeof(LABEL_COOKIE) - 1));
+        keyState.update(m_public);
+        ChaCha20Poly1305::Key key;
+        keyState.final(key);
+
+        std::span<uint8_t> encryptedCookie(reply.data() + COOKIE_ENCRYPTED, MAC_SIZE + ChaCha20Poly1305::TAG_SIZE);
+        std::memcpy(encryptedCookie.data(), cookie.data(), cookie.size());
+        ChaCha20Poly1305::xseal(encryptedCookie, initiation.subspan(INIT_MAC1, MAC_SIZE), nonce, key);
+        return reply;
+    }
+
+private:
+    static constexpr char CONSTRUCTION[] = "Noise_IKpsk2_25519_ChaChaPoly_BLAKE2s";
+    static constexpr char IDENTIFIER[] = "WireGuard v1 zx2c4 Jason@zx2c4.com";
+    static constexpr char LABEL_MAC1[] = "mac1----";
+    static constexpr char LABEL_COOKIE[] = "cookie--";
+
+    static constexpr size_t MAC_SIZE = 16;
+
+    static constexpr size_t INIT_SENDER = 4;
+    static constexpr size_t INIT_EPHEMERAL = 8;
+    static constexpr size_t INIT_STATIC = 40;
+    static constexpr size_t INIT_TIMESTAMP = 88;
+    static constexpr size_t INIT_MAC1 = 116;
+
+    static constexpr size_t RESP_SENDER = 4;
+    static constexpr size_t RESP_RECEIVER = 8;
+    static constexpr size_t RESP_EPHEMERAL = 12;
+    static constexpr size_t RESP_EMPTY = 44;
+    static constexpr size_t RESP_MAC1 = 60;
+
+    static constexpr size_t COOKIE_RECEIVER = 4;
+    static constexpr size_t COOKIE_NONCE = 8;
+    static constexpr size_t COOKIE_ENCRYPTED = 32;
+
+    static std::span<const uint8_t> bytes(const char* text, size_t length) {
+        return {reinterpret_cast<const uint8_t*>(text), length};
+    }
+
+    static void store32_le(uint8_t* p, uint32_t v) {
+        for (int i = 0; i < 4; ++i) {
+            p[i] = static_cast<uint8_t>(v >> (8 * i));
+        }
+    }
+
+    static void mixHash(Blake2s::Hash& hash, std::span<const uint8_t> data) {
+        Blake2s state;
+        state.update(hash);
+        state.update(data);
+        state.final(hash);
+    }
+
+    static void mac1(uint8_t* out, const Key& receiverPublic, std::span<const uint8_t> covered) {
+        Blake2s keyState;
+        keyState.update(bytes(LABEL_MAC1, sizeof(LABEL_MAC1) - 1));
+        keyState.update(receiverPublic);
+        Blake2s::Hash macKey;
+        keyState.final(macKey);
+
+        Blake2s::hash(std::span<uint8_t>(out, MAC_SIZE), covered, macKey);
+    }
+
+    // Размер, тип и mac1 - до любых DH, как у настоящего сервера
+    bool validInitiation(std::span<const uint8_t> initiation) const {
+        if (initiation.size() != WireGuardHandshake::INITIATION_SIZE ||
+            initiation[0] != static_cast<uint8_t>(WireGuardHandshake::MessageType::Initiation)) {
+            return false;
+        }
+        std::array<uint8_t, MAC_SIZE> expected;
+        mac1(expected.data(), m_public, initiation.first(INIT_MAC1));
+        return std::equal(expected.begin(), expected.end(), initiation.begin() + INIT_MAC1);
+    }
+
+    Key m_private;
+    Key m_public;
+    Key m_presharedKey;
+};
+
+} // namespace obsidian::test
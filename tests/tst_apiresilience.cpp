@@ -0,0 +1,130 @@
+// Повторы и circuit breaker ApiClient против MockServer со сценарием
+// отказов (injectFaults): сколько запросов доходит до сервера, в какие
+// сроки, и когда клиент перестаёт их слать.
+
+#include "ApiClient.h"
+#include "MockServer.h"
+
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QTest>
+
+#include <memory>
+
+using namespace obsidian;
+
+namespace {
+
+constexpr int TIMEOUT_MS = 10000;
+const QString PEERS = QStringLiteral("/api/vpn/peers");
+
+} // anonymous namespace
+
+class TestApiResilience : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void retriesIdempotentGet();
+    void givesUpAfterMaxAttempts();
+    void doesNotRetryPost();
+    void breakerOpensAndFailsFast();
+
+private:
+    std::unique_ptr<MockServer> m_server;
+    std::unique_ptr<ApiClient> m_client;
+};
+
+void TestApiResilience::init() {
+    m_server = std::make_unique<MockServer>(MockServer::Options{});
+    QVERIFY(m_server->listen());
+
+    m_client = std::make_unique<ApiClient>();
+    m_client->setServerUrl(QStringLiteral("http://127.0.0.1:%1").arg(m_server->serverPort()));
+
+    QSignalSpy loggedIn(m_client.get(), &ApiClient::loginSuccess);
+    m_client->login(QStringLiteral("resilience-user"), QStringLiteral("secret"));
+    QVERIFY(loggedIn.wait(TIMEOUT_MS));
+}
+
+void TestApiResilience::cleanup() {
+    m_client.reset();
+    m_server.reset();
+}
+
+// Два 503 подряд: GET повторяется и проходит с третьей попытки. Паузы
+// full jitter не длиннее потолков 250 и 500 мс политики Read
+void TestApiResilience::retriesIdempotentGet() {
+    m_server->injectFaults(PEERS, 2, MockServer::Fault::Error, 503);
+
+    QSignalSpy loaded(m_client.get(), &ApiClient::peersLoaded);
+    QSignalSpy errors(m_client.get(), &ApiClient::apiError);
+    QElapsedTimer elapsed;
+    elapsed.start();
+    m_client->getPeers();
+    QVERIFY(loaded.wait(TIMEOUT_MS));
+
+    QCOMPARE(m_server->requestsReceived(PEERS), 3);
+    QCOMPARE(errors.size(), 0);
+    QVERIFY2(elapsed.elapsed() < 250 + 500 + 500, qPrintable(QString::number(elapsed.elapsed())));
+    QVERIFY(m_client->serverAvailable());
+}
+
+// Отказы не кончаются: ровно maxAttempts (4) запроса, затем apiError
+void TestApiResilience::givesUpAfterMaxAttempts() {
+    m_server->injectFaults(PEERS, 100, MockServer::Fault::Error, 503);
+
+    QSignalSpy loaded(m_client.get(), &ApiClient::peersLoaded);
+    QSignalSpy errors(m_client.get(), &ApiClient::apiError);
+    m_client->getPeers();
+    QVERIFY(errors.wait(TIMEOUT_MS));
+
+    QCOMPARE(m_server->requestsReceived(PEERS), 4);
+    QCOMPARE(loaded.size(), 0);
+    // Четыре отказа подряд: порог breaker (5) ещё не достигнут
+    QVERIFY(m_client->serverAvailable());
+
+    // Лишних повторов после ошибки нет
+    QTest::qWait(1000);
+    QCOMPARE(m_server->requestsReceived(PEERS), 4);
+}
+
+// POST не идемпотентен: один отказ сразу становится ошибкой
+void TestApiResilience::doesNotRetryPost() {
+    m_server->injectFaults(PEERS, 1, MockServer::Fault::Error, 503);
+
+    QSignalSpy failed(m_client.get(), &ApiClient::peerCreateError);
+    m_client->createPeer(QStringLiteral("laptop"), QString::fromLatin1(QByteArray(32, 'k').toBase64()));
+    QVERIFY(failed.wait(TIMEOUT_MS));
+
+    QTest::qWait(1000);
+    QCOMPARE(m_server->requestsReceived(PEERS), 1);
+}
+
+// Пять отказов подряд открывают цепь: следующие запросы падают сразу, не
+// доходя до сервера. Полуоткрытое состояние проверяет tst_resilience
+void TestApiResilience::breakerOpensAndFailsFast() {
+    m_server->injectFaults(PEERS, 5, MockServer::Fault::Error, 500);
+
+    QSignalSpy availability(m_client.get(), &ApiClient::serverAvailableChanged);
+    QSignalSpy failed(m_client.get(), &ApiClient::peerCreateError);
+    for (int i = 1; i <= 5; ++i) {
+        m_client->createPeer(QStringLiteral("device-%1").arg(i), QString::fromLatin1(QByteArray(32, 'k').toBase64()));
+        QVERIFY(failed.wait(TIMEOUT_MS));
+        QCOMPARE(failed.size(), i);
+    }
+    QCOMPARE(m_server->requestsReceived(PEERS), 5);
+    QVERIFY(!m_client->serverAvailable());
+    QCOMPARE(availability.size(), 1);
+
+    QSignalSpy errors(m_client.get(), &ApiClient::apiError);
+    m_client->getPeers();
+    QVERIFY(errors.wait(TIMEOUT_MS));
+    QCOMPARE(errors.first().first().toString(), QStringLiteral("Server unavailable"));
+    QCOMPARE(m_server->requestsReceived(PEERS), 5);
+}
+
+QTEST_GUILESS_MAIN(TestApiResilience)
+#include "tst_apiresilience.moc"
@@ -0,0 +1,124 @@
+// Приоритеты запросов ApiClient против MockServer с задержкой ответа:
+// фоновая работа (bulk-удаление без bulk-эндпоинта и синхронизация) забивает
+// свои слоты и очередь планировщика, а интерактивный запрос конфигурации
+// обслуживается раньше стоящих в очереди фоновых. Время ожидания в очереди
+// пишется по классам приоритета.
+
+#include "ApiClient.h"
+#include "MockServer.h"
+
+#include <QSignalSpy>
+#include <QTest>
+
+#include <memory>
+
+using namespace obsidian;
+
+namespace {
+
+constexpr int TIMEOUT_MS = 20000;
+constexpr int LATENCY_MS = 200;
+constexpr int BACKGROUND_DELETES = 12;
+
+} // anonymous namespace
+
+class TestApiScheduling : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void interactiveOvertakesBackground();
+
+private:
+    std::unique_ptr<MockServer> m_server;
+    std::unique_ptr<ApiClient> m_client;
+};
+
+void TestApiScheduling::init() {
+    MockServer::Options options;
+    options.latencyMs = LATENCY_MS;
+    options.peersPerUser = BACKGROUND_DELETES + 1;
+    options.bulkEndpoints = false;      // удаление идёт отдельными фоновыми запросами
+    m_server = std::make_unique<MockServer>(options);
+    QVERIFY(m_server->listen());
+
+    m_client = std::make_unique<ApiClient>();
+    m_client->setServerUrl(QStringLiteral("http://127.0.0.1:%1").arg(m_server->serverPort()));
+
+    QSignalSpy loggedIn(m_client.get(), &ApiClient::loginSuccess);
+    m_client->login(QStringLiteral("scheduling-user"), QStringLiteral("secret"));
+    QVERIFY(loggedIn.wait(TIMEOUT_MS));
+
+    QSignalSpy synced(m_client.get(), &ApiClient::peersSynced);
+    m_client->syncPeers();
+    QVERIFY(synced.wait(TIMEOUT_MS));
+    QCOMPARE(m_client->syncedPeers().size(), BACKGROUND_DELETES + 1);
+}
+
+void TestApiScheduling::cleanup() {
+    m_client.reset();
+    m_server.reset();
+}
+
+// Все удаления разом уходят в планировщик: два выполняются, остальные и
+// синхронизация за ними ждут. Конфигурация стартует сразу и приходит через
+// одну задержку сервера, пока фоновая очередь ещё не пуста
+void TestApiScheduling::interactiveOvertakesBackground() {
+    const QList<PeerInfo> peers = m_client->syncedPeers();
+    QStringList deleteIds;
+    for (int i = 1; i < peers.size(); ++i) {
+        deleteIds.append(peers[i].id);
+    }
+
+    m_client->setBulkConcurrency(BACKGROUND_DELETES);
+    m_client->resetMetrics();
+
+    QSignalSpy progress(m_client.get(), &ApiClient::bulkProgress);
+    QSignalSpy bulkDone(m_client.get(), &ApiClient::bulkFinished);
+    QSignalSpy synced(m_client.get(), &ApiClient::peersSynced);
+    QSignalSpy configLoaded(m_client.get(), &ApiClient::peerConfigLoaded);
+    QSignalSpy errors(m_client.get(), &ApiClient::apiError);
+
+    // bulk-delete отвечает 404, и удаления уходят в планировщик по одному
+    m_client->deletePeers(deleteIds);
+    QTRY_VERIFY_WITH_TIMEOUT(m_client->queueWaitSnapshot()
+                                 .value(QStringLiteral("background")).toMap()
+                                 .value(QStringLiteral("queued")).toInt() > 0, TIMEOUT_MS);
+    const int backgroundActive = m_client->queueWaitSnapshot()
+        .value(QStringLiteral("background")).toMap().value(QStringLiteral("active")).toInt();
+    QCOMPARE(backgroundActive, m_client->backgroundConcurrency());
+
+    m_client->syncPeers();
+    m_client->getPeerConfig(peers.first().id);
+    QVERIFY(configLoaded.wait(TIMEOUT_MS));
+
+    // Конфигурация обогнала очередь: фоновая работа ещё идёт
+    const QVariantMap background = m_client->queueWaitSnapshot().value(QStringLiteral("background")).toMap();
+    QVERIFY2(background.value(QStringLiteral("queued")).toInt() > 0,
+             qPrintable(QStringLiteral("%1 deletes done").arg(progress.size())));
+    QVERIFY(progress.size() < BACKGROUND_DELETES);
+    QCOMPARE(bulkDone.size(), 0);
+    QCOMPARE(synced.size(), 0);
+
+    QTRY_COMPARE_WITH_TIMEOUT(bulkDone.size(), 1, TIMEOUT_MS);
+    QTRY_COMPARE_WITH_TIMEOUT(synced.size(), 1, TIMEOUT_MS);
+    QCOMPARE(errors.size(), 0);
+
+    // Ожидание в очереди записано по классам: интерактивный запрос не ждал,
+    // фоновые стояли хотя бы одну задержку сервера
+    const QVariantMap waits = m_client->queueWaitSnapshot();
+    const QVariantMap interactive = waits.value(QStringLiteral("interactive")).toMap();
+    const QVariantMap backgroundWaits = waits.value(QStringLiteral("background")).toMap();
+    QCOMPARE(interactive.value(QStringLiteral("count")).toInt(), 1);
+    QVERIFY2(interactive.value(QStringLiteral("max")).toDouble() < LATENCY_MS / 2.0,
+             qPrintable(interactive.value(QStringLiteral("max")).toString()));
+    // bulk-delete с ответом 404, удаления и синхронизация
+    QCOMPARE(backgroundWaits.value(QStringLiteral("count")).toInt(), 1 + BACKGROUND_DELETES + 1);
+    QVERIFY2(backgroundWaits.value(QStringLiteral("max")).toDouble() >= LATENCY_MS / 2.0,
+             qPrintable(backgroundWaits.value(QStringLiteral("max")).toString()));
+}
+
+QTEST_GUILESS_MAIN(TestApiScheduling)
+#include "tst_apischeduling.moc"
@@ -0,0 +1,436 @@
+// Эталонные векторы obsidian_crypto. Без Qt: собирается вместе с
+// obsidian_crypto и запускается через ctest.
+
+#include "Blake2s.h"
+#include "ChaCha20Poly1305.h"
+#include "TestCheck.h"
+#include "WireGuardHandshake.h"
+#include "WireGuardKeys.h"
+#include "WireGuardResponder.h"
+
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace obsidian;
+using obsidian::test::arrayFromHex;
+using obsidian::test::fromHex;
+
+namespace {
+
+using Key = std::array<uint8_t, KEY_SIZE>;
+
+// RFC 7748, раздел 5.2: два отдельных вектора и итерации k = X25519(k, u)
+void testX25519Vectors() {
+    const auto first = WireGuardKeys::sharedSecret(
+        arrayFromHex<KEY_SIZE>("a546e36bf0527c9d3b16154b82465edd62144c0ac1fc5a18506a2244ba449ac4"),
+        arrayFromHex<KEY_SIZE>("e6db6867583030db3594c1a424b15f7c726624ec26b3353b10a903a6d0ab1c4c"));
+    if (CHECK(first.has_value())) {
+        CHECK_HEX(*first, "c3da55379de9c6908e94ea4df28d084f32eccf03491c71f754b4075577a28552");
+    }
+
+    // Старший бит u игнорируется (RFC 7748, раздел 5)
+    const auto second = WireGuardKeys::sharedSecret(
+        arrayFromHex<KEY_SIZE>("4b66e9d4d1b4673c5ad22691957d6af5c11b6421e0ea01d42ca4169e7918ba0d"),
+        arrayFromHex<KEY_SIZE>("e5210f12786811d3f4b7959d0538ae2c31dbe7106fc03c3efc4cd549c715a493"));
+    if (CHECK(second.has_value())) {
+        CHECK_HEX(*second, "95cbde9476e8907d7aade45cb4b873f88b595a68799fa152e6f8f7647aac7957");
+    }
+
+    Key k{9};
+    Key u{9};
+    for (int i = 1; i <= 1000; ++i) {
+        const auto next = WireGuardKeys::sharedSecret(k, u);
+        if (!CHECK(next.has_value())) {
+            return;
+        }
+        u = k;
+        k = *next;
+        if (i == 1) {
+            CHECK_HEX(k, "422c8e7a6227d7bca1350b3e2bb7279f7897b87bb6854b783c60e80311ae3079");
+        }
+    }
+    CHECK_HEX(k, "684cf59ba83309552800ef566f2f4d3c1c3887c49360e3875f2eb94d99532c51");
+}
+
+// RFC 7748, раздел 6.1: ключи Алисы и Боба через fixed-base путь и общий секрет
+void testX25519KeyExchange() {
+    const Key alice = arrayFromHex<KEY_SIZE>("77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a");
+    const Key bob = arrayFromHex<KEY_SIZE>("5dab087e624a8a4b79e17f8b83800ee66f3bb1292618b6fd1c2f8b27ff88e0eb");
+
+    const Key alicePublic = WireGuardKeys::derivePublicKey(alice);
+    const Key bobPublic = WireGuardKeys::derivePublicKey(bob);
+    CHECK_HEX(alicePublic, "8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a");
+    CHECK_HEX(bobPublic, "de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f");
+
+    const char* shared = "4a5d9d5ba4ce2de1728e3bf480350f25e07e21c947d19e3376f09b3c1e161742";
+    const auto aliceSecret = WireGuardKeys::sharedSecret(alice, bobPublic);
+    const auto bobSecret = WireGuardKeys::sharedSecret(bob, alicePublic);
+    if (CHECK(aliceSecret && bobSecret)) {
+        CHECK_HEX(*aliceSecret, shared);
+        CHECK_HEX(*bobSecret, shared);
+    }
+
+    // Пакетный вариант совпадает с одиночным
+    const std::vector<Key> publicKeys = {bobPublic, alicePublic};
+    std::vector<Key> out(publicKeys.size());
+    bool valid[2] = {};
+    CHECK(WireGuardKeys::sharedSecrets(alice, publicKeys, out, valid) == 2);
+    CHECK(valid[0] && valid[1]);
+    CHECK_HEX(out[0], shared);
+}
+
+// Fixed-base путь derivePublicKey (таблица на кривой Эдвардса) совпадает
+// с лестницей Монтгомери от u = 9 на случайных и крайних скалярах
+void testFixedBaseMatchesLadder() {
+    const Key basePoint{9};
+    std::vector<Key> scalars = {Key{}, Key{}};
+    scalars[1].fill(0xff);
+
+    std::mt19937_64 random(7748);
+    for (int i = 0; i < 2000; ++i) {
+        Key scalar;
+        for (uint8_t& byte : scalar) {
+            byte = static_cast<uint8_t>(random());
+        }
+        scalars.push_back(scalar);
+    }
+
+    int mismatches = 0;
+    for (const Key& scalar : scalars) {
+        const auto ladder = WireGuardKeys::sharedSecret(scalar, basePoint);
+        if (!ladder || *ladder != WireGuardKeys::derivePublicKey(scalar)) {
+            ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+// Точки малого порядка дают нулевой секрет и отвергаются
+void testX25519LowOrder() {
+    const Key privateKey = arrayFromHex<KEY_SIZE>("77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a");
+    const char* lowOrder[] = {
+        "0000000000000000000000000000000000000000000000000000000000000000",
+        "0100000000000000000000000000000000000000000000000000000000000000",
+        "e0eb7a7c3b41b8ae1656e3faf19fc46ada098deb9c32b1fd866205165f49b800",
+        "5f9c95bca3508c24b1d0b1559c83ef5b04445cc4581c8e86d8224eddd09f1157",
+        "ecffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+        "edffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+        "eeffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+    };
+    for (const char* point : lowOrder) {
+        CHECK(!WireGuardKeys::sharedSecret(privateKey, arrayFromHex<KEY_SIZE>(point)).has_value());
+    }
+}
+
+// Побитовый эталон RFC 4648 для сравнения с SIMD- и табличными ядрами
+std::string referenceBase64(const Key& key) {
+    static constexpr char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    uint32_t bits = 0;
+    int count = 0;
+    for (const uint8_t byte : key) {
+        bits = (bits << 8) | byte;
+        count += 8;
+        while (count >= 6) {
+            count -= 6;
+            out += ALPHABET[(bits >> count) & 0x3f];
+        }
+    }
+    out += ALPHABET[(bits << (6 - count)) & 0x3f];
+    return out + '=';
+}
+
+// Base64 ключей: известные значения, круговой путь через выбранное в
+// рантайме ядро (AVX2, SSSE3 или табличное) и сверка с эталоном
+void testBase64RoundTrip() {
+    Key counting;
+    for (size_t i = 0; i < counting.size(); ++i) {
+        counting[i] = static_cast<uint8_t>(i);
+    }
+    Key ones;
+    ones.fill(0xff);
+    CHECK(WireGuardKeys::toBase64(Key{}) == "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA=");
+    CHECK(WireGuardKeys::toBase64(counting) == "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8=");
+    CHECK(WireGuardKeys::toBase64(ones) == "//////////////////////////////////////////8=");
+
+    std::mt19937_64 random(4648);
+    int mismatches = 0;
+    for (int i = 0; i < 1000; ++i) {
+        Key key;
+        for (uint8_t& byte : key) {
+            byte = static_cast<uint8_t>(random());
+        }
+
+        const std::string encoded = WireGuardKeys::toBase64(key);
+        char buffer[KEY_BASE64_SIZE];
+        WireGuardKeys::toBase64(key, buffer);
+
+        Key decoded{};
+        const auto owned = WireGuardKeys::fromBase64(encoded);
+        if (encoded != referenceBase64(key) || std::string_view(buffer, sizeof(buffer)) != encoded
+            || !WireGuardKeys::fromBase64(std::string_view(encoded), decoded) || decoded != key
+            || !owned || *owned != key) {
+            ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+// Строгий разбор: только канонические 44 символа с одним '=' в конце.
+// Ошибка не меняет out
+void testBase64Rejects() {
+    const std::string valid = "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8=";
+    Key out;
+    out.fill(0x5a);
+    const Key untouched = out;
+
+    std::vector<std::string> rejected = {
+        "",
+        valid.substr(0, 43),                    // 43 символа, без '='
+        valid + "=",                            // 45 символов
+        valid.substr(0, 42) + "==",             // '=' на месте значащего символа
+        valid.substr(0, 43) + "A",              // нет '=' в конце
+        "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAB=",     // ненулевые младшие биты
+        "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAD=",
+    };
+    // Недопустимый символ в SIMD-части (0..31) и в табличном хвосте (32..42)
+    for (const size_t position : {size_t(0), size_t(5), size_t(16), size_t(31), size_t(32), size_t(39), size_t(42)}) {
+        for (const char bad : {'-', '_', '=', ' ', '\0', '\x80', '\xff'}) {
+            std::string corrupted = valid;
+            corrupted[position] = bad;
+            rejected.push_back(corrupted);
+        }
+    }
+
+    int accepted = 0;
+    for (const std::string& text : rejected) {
+        if (WireGuardKeys::fromBase64(std::string_view(text), out) || WireGuardKeys::fromBase64(text)) {
+            ++accepted;
+        }
+    }
+    CHECK(accepted == 0);
+    CHECK(out == untouched);
+
+    CHECK(WireGuardKeys::fromBase64(std::string_view(valid), out));
+    CHECK_HEX(out, "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f");
+}
+
+// Пакетное декодирование совпадает с поштучным: флаги, число успешных и
+// обнулённые ключи на месте невалидных
+void testBase64Batch() {
+    std::mt19937_64 random(32);
+    std::vector<std::string> texts;
+    for (int i = 0; i < 64; ++i) {
+        Key key;
+        for (uint8_t& byte : key) {
+            byte = static_cast<uint8_t>(random());
+        }
+        std::string text = WireGuardKeys::toBase64(key);
+        if (i % 5 == 1) {
+            text[static_cast<size_t>(i) % 43] = '*';
+        } else if (i % 5 == 3) {
+            text.pop_back();
+        }
+        texts.push_back(text);
+    }
+    const std::vector<std::string_view> views(texts.begin(), texts.end());
+
+    std::vector<Key> out(views.size());
+    bool valid[64];
+    const size_t decoded = WireGuardKeys::fromBase64(views, out, valid);
+
+    size_t expected = 0;
+    int mismatches = 0;
+    for (size_t i = 0; i < views.size(); ++i) {
+        Key single{};
+        const bool ok = WireGuardKeys::fromBase64(views[i], single);
+        expected += ok ? 1 : 0;
+        if (valid[i] != ok || out[i] != (ok ? single : Key{})) {
+            ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+    CHECK(decoded == expected);
+    CHECK(decoded == 38);
+
+    // Без флагов и с out короче входа: обрабатывается min(размеров)
+    std::vector<Key> shortOut(10);
+    CHECK(WireGuardKeys::fromBase64(views, shortOut) == 6);
+}
+
+std::vector<uint8_t> bytesOf(std::string_view text) {
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+constexpr std::string_view SUNSCREEN =
+    "Ladies and Gentlemen of the class of '99: If I could offer you only one tip "
+    "for the future, sunscreen would be it.";
+
+// RFC 8439, раздел 2.5.2
+void testPoly1305() {
+    const auto key = arrayFromHex<KEY_SIZE>("85d6be7857556d337f4452fe42d506a80103808afb0db2fd4abff6af4149f51b");
+    const std::vector<uint8_t> message = bytesOf("Cryptographic Forum Research Group");
+    CHECK_HEX(ChaCha20Poly1305::poly1305(message, key), "a8061dc1305136c6c22b8baf0c0127a9");
+}
+
+// RFC 8439, раздел 2.8.2: seal, open и отказ при испорченном теге
+void testChaCha20Poly1305() {
+    const auto key = arrayFromHex<KEY_SIZE>("808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f");
+    const auto nonce = arrayFromHex<ChaCha20Poly1305::NONCE_SIZE>("070000004041424344454647");
+    const std::vector<uint8_t> aad = fromHex("50515253c0c1c2c3c4c5c6c7");
+
+    std::vector<uint8_t> buffer = bytesOf(SUNSCREEN);
+    buffer.resize(buffer.size() + ChaCha20Poly1305::TAG_SIZE);
+    CHECK(ChaCha20Poly1305::seal(buffer, aad, nonce, key));
+
+    const std::span<const uint8_t> sealed(buffer);
+    CHECK_HEX(sealed.first(SUNSCREEN.size()),
+              "d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d63dbea45e8ca9671282fafb69da92728b"
+              "1a71de0a9e060b2905d6a5b67ecd3b3692ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc"
+              "3ff4def08e4b7a9de576d26586cec64b6116");
+    CHECK_HEX(sealed.last(ChaCha20Poly1305::TAG_SIZE), "1ae10b594f09e26a7e902ecbd0600691");
+
+    std::vector<uint8_t> tampered = buffer;
+    tampered.back() ^= 1;
+    CHECK(!ChaCha20Poly1305::open(tampered, aad, nonce, key));
+
+    CHECK(ChaCha20Poly1305::open(buffer, aad, nonce, key));
+    CHECK(std::equal(SUNSCREEN.begin(), SUNSCREEN.end(), buffer.begin()));
+}
+
+// draft-irtf-cfrg-xchacha-03: HChaCha20 (2.2.1) и XChaCha20-Poly1305 (A.3.1)
+void testXChaCha20Poly1305() {
+    Key key;
+    for (size_t i = 0; i < key.size(); ++i) {
+        key[i] = static_cast<uint8_t>(i);
+    }
+    const auto hnonce = arrayFromHex<16>("000000090000004a0000000031415927");
+    CHECK_HEX(ChaCha20Poly1305::hchacha20(key, hnonce),
+              "82413b4227b27bfed30e42508a877d73a0f9e4d58a74a853c12ec41326d3ecdc");
+
+    const auto xkey = arrayFromHex<KEY_SIZE>("808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f");
+    const auto xnonce = arrayFromHex<ChaCha20Poly1305::XNONCE_SIZE>("404142434445464748494a4b4c4d4e4f5051525354555657");
+    const std::vector<uint8_t> aad = fromHex("50515253c0c1c2c3c4c5c6c7");
+
+    std::vector<uint8_t> buffer = bytesOf(SUNSCREEN);
+    buffer.resize(buffer.size() + ChaCha20Poly1305::TAG_SIZE);
+    CHECK(ChaCha20Poly1305::xseal(buffer, aad, xnonce, xkey));
+
+    const std::span<const uint8_t> sealed(buffer);
+    CHECK_HEX(sealed.first(SUNSCREEN.size()),
+              "bd6d179d3e83d43b9576579493c0e939572a1700252bfaccbed2902c21396cbb731c7f1b0b4aa6440bf3a82f4eda7e39"
+              "ae64c6708c54c216cb96b72e1213b4522f8c9ba40db5d945b11b69b982c1bb9e3f3fac2bc369488f76b2383565d3fff9"
+              "21f9664c97637da9768812f615c68b13b52e");
+    CHECK_HEX(sealed.last(ChaCha20Poly1305::TAG_SIZE), "c0875924c1c7987947deafd8780acf49");
+
+    CHECK(ChaCha20Poly1305::xopen(buffer, aad, xnonce, xkey));
+    CHECK(std::equal(SUNSCREEN.begin(), SUNSCREEN.end(), buffer.begin()));
+}
+
+// RFC 7693, приложение B, и keyed-вектор из blake2s-kat.txt (ключ и
+// сообщение 00 01 02 ..., 64 байта сообщения)
+void testBlake2s() {
+    CHECK_HEX(Blake2s::hash(bytesOf("abc")),
+              "508c5e8c327c14e2e1a72ba34eeb452f37458b209ed63a294d999b4c86675982");
+    CHECK_HEX(Blake2s::hash({}),
+              "69217a3079908094e11121d042354a7c1f55b6482ca1a51e1b250dfd1ed0eef9");
+
+    std::vector<uint8_t> key(Blake2s::MAX_KEY_SIZE);
+    std::vector<uint8_t> message(64);
+    for (size_t i = 0; i < message.size(); ++i) {
+        message[i] = static_cast<uint8_t>(i);
+        if (i < key.size()) {
+            key[i] = static_cast<uint8_t>(i);
+        }
+    }
+    Blake2s::Hash keyed;
+    Blake2s::hash(keyed, message, key);
+    CHECK_HEX(keyed, "8975b0577fd35566d750b362b0897a26c399136df07bababbde6203ff2954ed4");
+
+    // Потоковый update по кускам разной длины даёт тот же хеш
+    Blake2s streaming(Blake2s::HASH_SIZE, key);
+    streaming.update(std::span(message).first(1));
+    streaming.update(std::span(message).subspan(1, 63));
+    Blake2s::Hash streamed;
+    streaming.final(streamed);
+    CHECK(streamed == keyed);
+}
+
+// Рукопожатие IKpsk2 против тестового ответчика: верный ответ, cookie
+// reply, чужой PSK и посторонние пакеты
+void testHandshake() {
+    const auto server = WireGuardKeys::generateKeyPair();
+    const auto client = WireGuardKeys::generateKeyPair();
+    if (!CHECK(server && client)) {
+        return;
+    }
+    Key psk{};
+    psk.fill(0x42);
+    const test::WireGuardResponder responder(server->privateKey, psk);
+
+    WireGuardHandshake handshake(client->privateKey, server->publicKey, psk);
+    std::array<uint8_t, WireGuardHandshake::INITIATION_SIZE> initiation;
+    CHECK(handshake.consumeResponse(std::vector<uint8_t>(WireGuardHandshake::RESPONSE_SIZE))
+          == WireGuardHandshake::ResponseStatus::Invalid);      // initiation ещё не было
+    if (!CHECK(handshake.createInitiation(0x11223344, initiation))) {
+        return;
+    }
+
+    const auto response = responder.respond(initiation, 0x55667788);
+    if (CHECK(response.has_value())) {
+        // Искажённый ответ отбрасывается и не портит состояние
+        auto corrupted = *response;
+        corrupted[50] ^= 1;
+        CHECK(handshake.consumeResponse(corrupted) == WireGuardHandshake::ResponseStatus::Invalid);
+        CHECK(handshake.consumeResponse(*response) == WireGuardHandshake::ResponseStatus::Valid);
+        CHECK(handshake.remoteIndex() == 0x55667788);
+    }
+
+    const auto cookie = responder.cookieReply(initiation);
+    if (CHECK(cookie.has_value())) {
+        CHECK(handshake.consumeResponse(*cookie) == WireGuardHandshake::ResponseStatus::CookieReply);
+        // Cookie reply для чужого sender index не наш
+        auto foreign = *cookie;
+        foreign[4] ^= 1;
+        CHECK(handshake.consumeResponse(foreign) == WireGuardHandshake::ResponseStatus::Invalid);
+    }
+
+    CHECK(handshake.consumeResponse(fromHex("deadbeef")) == WireGuardHandshake::ResponseStatus::Invalid);
+    CHECK(handshake.consumeResponse(std::vector<uint8_t>(WireGuardHandshake::RESPONSE_SIZE, 2))
+          == WireGuardHandshake::ResponseStatus::Invalid);
+
+    // Initiation к другому серверу не проходит mac1
+    const auto other = WireGuardKeys::generateKeyPair();
+    if (CHECK(other.has_value())) {
+        CHECK(!test::WireGuardResponder(other->privateKey).respond(initiation, 1).has_value());
+    }
+
+    // С другим PSK сервер отвечает, но ответ не сходится у клиента
+    WireGuardHandshake mismatched(client->privateKey, server->publicKey);
+    if (CHECK(mismatched.createInitiation(7, initiation))) {
+        const auto reply = responder.respond(initiation, 8);
+        if (CHECK(reply.has_value())) {
+            CHECK(mismatched.consumeResponse(*reply) == WireGuardHandshake::ResponseStatus::Invalid);
+        }
+    }
+}
+
+} // anonymous namespace
+
+int main() {
+    testX25519Vectors();
+    testX25519KeyExchange();
+    testFixedBaseMatchesLadder();
+    testX25519LowOrder();
+    testBase64RoundTrip();
+    testBase64Rejects();
+    testBase64Batch();
+    testPoly1305();
+    testChaCha20Poly1305();
+    testXChaCha20Poly1305();
+    testBlake2s();
+    testHandshake();
+    return TEST_RESULT("tst_crypto");
+}
@@ -0,0 +1,167 @@
+// HandshakeProbe против UDP-ответчика на loopback: ответ IKpsk2 даёт
+// успех, cookie reply - «сервер под нагрузкой», мусор - таймаут.
+
+#include "HandshakeProbe.h"
+#include "WireGuardResponder.h"
+
+#include <QElapsedTimer>
+#include <QNetworkDatagram>
+#include <QSignalSpy>
+#include <QTest>
+#include <QUdpSocket>
+
+#include <optional>
+
+using namespace obsidian;
+
+namespace {
+
+constexpr int TIMEOUT_MS = 5000;
+constexpr int PROBE_TIMEOUT_MS = 300;
+
+QString toBase64(const WireGuardHandshake::Key& key) {
+    return QString::fromStdString(WireGuardKeys::toBase64(key));
+}
+
+} // anonymous namespace
+
+class TestHandshakeProbe : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void succeedsOnResponse();
+    void reportsCookieReply();
+    void timesOutOnGarbage();
+
+private:
+    enum class Reply { Response, Cookie, Garbage };
+
+    // Отвечает на каждую датаграмму по m_reply
+    void onDatagram();
+    // Одна проба до probeFinished; его аргументы или пустой список по таймауту
+    QList<QVariant> runProbe(int timeoutMs);
+
+    std::optional<KeyPair> m_server;
+    std::optional<KeyPair> m_client;
+    WireGuardHandshake::Key m_psk{};
+    std::optional<test::WireGuardResponder> m_responder;
+    QUdpSocket* m_socket = nullptr;
+    Reply m_reply = Reply::Response;
+    int m_received = 0;
+    int m_invalid = 0;
+};
+
+void TestHandshakeProbe::init() {
+    m_server = WireGuardKeys::generateKeyPair();
+    m_client = WireGuardKeys::generateKeyPair();
+    QVERIFY(m_server && m_client);
+    m_psk.fill(0x5a);
+    m_responder.emplace(m_server->privateKey, m_psk);
+
+    m_socket = new QUdpSocket(this);
+    QVERIFY(m_socket->bind(QHostAddress::LocalHost, 0));
+    connect(m_socket, &QUdpSocket::readyRead, this, &TestHandshakeProbe::onDatagram);
+    m_reply = Reply::Response;
+    m_received = 0;
+    m_invalid = 0;
+}
+
+void TestHandshakeProbe::cleanup() {
+    delete m_socket;
+    m_socket = nullptr;
+    m_responder.reset();
+}
+
+void TestHandshakeProbe::onDatagram() {
+    while (m_socket->hasPendingDatagrams()) {
+        const QNetworkDatagram datagram = m_socket->receiveDatagram();
+        const QByteArray data = datagram.data();
+        const std::span<const uint8_t> initiation(reinterpret_cast<const uint8_t*>(data.constData()),
+                                                  static_cast<size_t>(data.size()));
+        ++m_received;
+
+        QByteArray reply;
+        switch (m_reply) {
+        case Reply::Response:
+            if (const auto response = m_responder->respond(initiation, 0x0badf00d)) {
+                reply = QByteArray(reinterpret_cast<const char*>(response->data()),
+                                   static_cast<qsizetype>(response->size()));
+            }
+            break;
+        case Reply::Cookie:
+            if (const auto cookie = m_responder->cookieReply(initiation)) {
+                reply = QByteArray(reinterpret_cast<const char*>(cookie->data()),
+                                   static_cast<qsizetype>(cookie->size()));
+            }
+            break;
+        case Reply::Garbage:
+            // Размер и тип как у ответа, содержимое - нет
+            reply = QByteArray(static_cast<qsizetype>(WireGuardHandshake::RESPONSE_SIZE), '\x02');
+            break;
+        }
+
+        if (reply.isEmpty()) {
+            ++m_invalid;
+            continue;
+        }
+        m_socket->writeDatagram(reply, datagram.senderAddress(), static_cast<quint16>(datagram.senderPort()));
+    }
+}
+
+QList<QVariant> TestHandshakeProbe::runProbe(int timeoutMs) {
+    HandshakeProbe probe;
+    QSignalSpy finished(&probe, &HandshakeProbe::probeFinished);
+    const int probeId = probe.probe(QStringLiteral("127.0.0.1:%1").arg(m_socket->localPort()),
+                                    toBase64(m_server->publicKey), toBase64(m_client->privateKey),
+                                    toBase64(m_psk), timeoutMs);
+    if (!finished.wait(TIMEOUT_MS) || finished.size() != 1) {
+        return {};
+    }
+    const QList<QVariant> arguments = finished.takeFirst();
+    if (arguments.at(0).toInt() != probeId || probe.pendingProbes() != 0) {
+        return {};
+    }
+    return arguments;
+}
+
+// Верный handshake response: успех и время ответа
+void TestHandshakeProbe::succeedsOnResponse() {
+    const QList<QVariant> result = runProbe(TIMEOUT_MS);
+    QCOMPARE(result.size(), 5);
+    QCOMPARE(result.at(2).toBool(), true);
+    QVERIFY(result.at(3).toDouble() >= 0.0);
+    QVERIFY(result.at(4).toString().isEmpty());
+    QCOMPARE(m_received, 1);
+    QCOMPARE(m_invalid, 0);
+}
+
+// Cookie reply: сервер доступен, но рукопожатие не завершено
+void TestHandshakeProbe::reportsCookieReply() {
+    m_reply = Reply::Cookie;
+    const QList<QVariant> result = runProbe(TIMEOUT_MS);
+    QCOMPARE(result.size(), 5);
+    QCOMPARE(result.at(2).toBool(), false);
+    QVERIFY(result.at(3).toDouble() >= 0.0);
+    QVERIFY(result.at(4).toString().contains(QLatin1String("cookie")));
+    QCOMPARE(m_invalid, 0);
+}
+
+// Посторонний пакет отбрасывается, проба ждёт до своего таймаута
+void TestHandshakeProbe::timesOutOnGarbage() {
+    m_reply = Reply::Garbage;
+    QElapsedTimer elapsed;
+    elapsed.start();
+    const QList<QVariant> result = runProbe(PROBE_TIMEOUT_MS);
+    QCOMPARE(result.size(), 5);
+    QCOMPARE(result.at(2).toBool(), false);
+    QVERIFY(result.at(3).toDouble() < 0.0);
+    QCOMPARE(result.at(4).toString(), QStringLiteral("Handshake timed out"));
+    QVERIFY(elapsed.elapsed() >= PROBE_TIMEOUT_MS);
+    QCOMPARE(m_received, 1);
+}
+
+QTEST_GUILESS_MAIN(TestHandshakeProbe)
+#include "tst_handshakeprobe.moc"
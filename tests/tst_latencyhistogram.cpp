@@ -0,0 +1,173 @@
+// LatencyHistogram: перцентили известных распределений в пределах ошибки
+// бакета, точный максимум, reset и запись из нескольких потоков без потерь.
+
+#include "LatencyHistogram.h"
+#include "TestCheck.h"
+
+#include <cstdint>
+#include <latch>
+#include <thread>
+#include <vector>
+
+using namespace obsidian;
+
+namespace {
+
+// Перцентиль не меньше истинного значения и больше него не более чем на
+// ширину бакета: 1/SUB_BUCKETS от значения, ниже SUB_BUCKETS — точно
+bool withinBucketError(uint64_t reported, uint64_t exact) {
+    return reported >= exact && reported - exact <= exact / LatencyHistogram::SUB_BUCKETS;
+}
+
+// Каждое значение попадает в бакет, верхняя граница которого не меньше
+// его и не дальше ошибки бакета; индексы не убывают
+void testBuckets() {
+    size_t previous = 0;
+    for (uint64_t micros = 0; micros < (uint64_t(1) << 20); ++micros) {
+        const size_t index = LatencyHistogram::bucketIndex(micros);
+        CHECK(index >= previous);
+        CHECK(withinBucketError(LatencyHistogram::bucketHighestValue(index), micros));
+        previous = index;
+    }
+
+    // Всё, что больше MAX_VALUE, попадает в последний бакет
+    const size_t last = LatencyHistogram::BUCKET_COUNT - 1;
+    CHECK(LatencyHistogram::bucketIndex(LatencyHistogram::MAX_VALUE) == last);
+    CHECK(LatencyHistogram::bucketIndex(LatencyHistogram::MAX_VALUE * 4) == last);
+    CHECK(LatencyHistogram::bucketHighestValue(last) == LatencyHistogram::MAX_VALUE);
+}
+
+// Ниже SUB_BUCKETS значения хранятся точно
+void testSmallValuesExact() {
+    LatencyHistogram histogram;
+    CHECK(histogram.percentile(0.5) == 0);      // пустая
+
+    for (uint64_t micros = 0; micros < LatencyHistogram::SUB_BUCKETS; ++micros) {
+        histogram.record(micros);
+    }
+    CHECK(histogram.count() == LatencyHistogram::SUB_BUCKETS);
+    CHECK(histogram.percentile(0.0) == 0);
+    CHECK(histogram.percentile(0.5) == 7);
+    CHECK(histogram.percentile(1.0) == 15);
+}
+
+// Равномерное 1..100000 мкс по одному разу: p50 = 50000, p99 = 99000
+void testUniform() {
+    constexpr uint64_t N = 100000;
+    LatencyHistogram histogram;
+    for (uint64_t micros = 1; micros <= N; ++micros) {
+        histogram.record(micros);
+    }
+
+    CHECK(histogram.count() == N);
+    CHECK(histogram.sumMicros() == N * (N + 1) / 2);
+    CHECK(histogram.maxMicros() == N);
+    CHECK(withinBucketError(histogram.percentile(0.50), 50000));
+    CHECK(withinBucketError(histogram.percentile(0.90), 90000));
+    CHECK(withinBucketError(histogram.percentile(0.99), 99000));
+    CHECK(histogram.percentile(1.0) == N);
+}
+
+// Два пика: 99% по 1 мс и 1% по 250 мс. p99 ещё в первом пике, p99.9 —
+// во втором и равен максимуму точно, без округления вверх до границы бакета
+void testBimodal() {
+    LatencyHistogram histogram;
+    for (int i = 0; i < 990; ++i) {
+        histogram.record(1000);
+    }
+    for (int i = 0; i < 10; ++i) {
+        histogram.record(250000);
+    }
+
+    CHECK(withinBucketError(histogram.percentile(0.50), 1000));
+    CHECK(withinBucketError(histogram.percentile(0.99), 1000));
+    CHECK(histogram.percentile(0.999) == 250000);
+    CHECK(histogram.maxMicros() == 250000);
+}
+
+// Максимум хранится точно, а не как граница своего бакета
+void testExactMax() {
+    LatencyHistogram histogram;
+    histogram.record(100);
+    histogram.record(123457);
+    histogram.record(5000);
+
+    CHECK(histogram.maxMicros() == 123457);
+    CHECK(histogram.percentile(1.0) == 123457);
+    CHECK(LatencyHistogram::bucketHighestValue(LatencyHistogram::bucketIndex(123457)) > 123457);
+}
+
+void testReset() {
+    LatencyHistogram histogram;
+    for (uint64_t micros = 1; micros <= 1000; ++micros) {
+        histogram.record(micros * 100);
+    }
+    histogram.reset();
+
+    CHECK(histogram.count() == 0);
+    CHECK(histogram.sumMicros() == 0);
+    CHECK(histogram.maxMicros() == 0);
+    CHECK(histogram.percentile(0.5) == 0);
+    CHECK(histogram.percentile(1.0) == 0);
+
+    // После reset старые бакеты не влияют на перцентили
+    histogram.record(42);
+    CHECK(histogram.count() == 1);
+    CHECK(histogram.percentile(0.5) == 42);
+    CHECK(histogram.percentile(1.0) == 42);
+}
+
+// Несколько потоков разом пишут одно и то же распределение в немногие
+// бакеты. Ни один отсчёт не потерян: счётчик, сумма и максимум точные, а
+// перцентили совпадают с гистограммой, записанной в одном потоке, —
+// пропавший отсчёт в бакете сдвинул бы какой-нибудь из них
+void testConcurrentRecord() {
+    constexpr int THREADS = 8;
+    constexpr uint64_t PER_THREAD = 500000;
+    constexpr uint64_t DISTINCT = 64;
+
+    LatencyHistogram shared;
+    LatencyHistogram reference;
+
+    std::latch start(THREADS);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&shared, &start]() {
+            start.arrive_and_wait();
+            for (uint64_t i = 0; i < PER_THREAD; ++i) {
+                shared.record(i % DISTINCT * 37);
+            }
+        });
+    }
+    uint64_t sum = 0;
+    for (int t = 0; t < THREADS; ++t) {
+        for (uint64_t i = 0; i < PER_THREAD; ++i) {
+            reference.record(i % DISTINCT * 37);
+            sum += i % DISTINCT * 37;
+        }
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    CHECK(shared.count() == THREADS * PER_THREAD);
+    CHECK(shared.sumMicros() == sum);
+    CHECK(shared.maxMicros() == (DISTINCT - 1) * 37);
+    for (int percent = 1; percent <= 100; ++percent) {
+        const double q = percent / 100.0;
+        CHECK(shared.percentile(q) == reference.percentile(q));
+    }
+}
+
+} // anonymous namespace
+
+int main() {
+    testBuckets();
+    testSmallValuesExact();
+    testUniform();
+    testBimodal();
+    testExactMax();
+    testReset();
+    testConcurrentRecord();
+    return TEST_RESULT("tst_latencyhistogram");
+}
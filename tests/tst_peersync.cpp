@@ -0,0 +1,233 @@
+// Дельта-синхронизация ApiClient против MockServer в том же процессе:
+// дельта после изменений, её размер независимо от длины списка, 304 для
+// снимка без /changes и полная пересинхронизация после 410 под тем же id
+// запроса.
+
+#include "ApiClient.h"
+#include "MockServer.h"
+
+#include <QRandomGenerator>
+#include <QSignalSpy>
+#include <QTest>
+
+#include <memory>
+
+using namespace obsidian;
+
+namespace {
+
+constexpr int TIMEOUT_MS = 5000;
+const QString CHANGES_PATH = QStringLiteral("/api/vpn/peers/changes");
+
+QString randomPublicKey() {
+    QByteArray key(32, Qt::Uninitialized);
+    for (char& byte : key) {
+        byte = static_cast<char>(QRandomGenerator::global()->bounded(256));
+    }
+    return QString::fromLatin1(key.toBase64());
+}
+
+} // anonymous namespace
+
+class TestPeerSync : public QObject {
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+
+    void deltaAfterChanges();
+    void deltaSizeIndependentOfList();
+    void snapshotNotModified();
+    void fullResyncAfterGone();
+    void cancelDuringResync();
+
+private:
+    // Свежий сервер и клиент, вошедший под новым пользователем
+    void start(const MockServer::Options& options);
+    PeerInfo createPeer(const QString& deviceName);
+    // Ждёт peersSynced и возвращает число изменений, -1 по таймауту
+    int sync();
+
+    std::unique_ptr<MockServer> m_server;
+    std::unique_ptr<ApiClient> m_client;
+};
+
+void TestPeerSync::cleanup() {
+    m_client.reset();
+    m_server.reset();
+}
+
+void TestPeerSync::start(const MockServer::Options& options) {
+    m_server = std::make_unique<MockServer>(options);
+    QVERIFY(m_server->listen());
+
+    m_client = std::make_unique<ApiClient>();
+    m_client->setServerUrl(QStringLiteral("http://127.0.0.1:%1").arg(m_server->serverPort()));
+
+    QSignalSpy loggedIn(m_client.get(), &ApiClient::loginSuccess);
+    m_client->login(QStringLiteral("sync-user"), QStringLiteral("secret"));
+    QVERIFY(loggedIn.wait(TIMEOUT_MS));
+}
+
+PeerInfo TestPeerSync::createPeer(const QString& deviceName) {
+    QSignalSpy created(m_client.get(), &ApiClient::peerCreated);
+    m_client->createPeer(deviceName, randomPublicKey());
+    if (!created.wait(TIMEOUT_MS)) {
+        return PeerInfo();
+    }
+    return qvariant_cast<PeerInfo>(created.first().first());
+}
+
+int TestPeerSync::sync() {
+    QSignalSpy synced(m_client.get(), &ApiClient::peersSynced);
+    m_client->syncPeers();
+    if (!synced.wait(TIMEOUT_MS)) {
+        return -1;
+    }
+    return synced.first().first().toInt();
+}
+
+// Первая синхронизация полная, следующая приносит только новое устройство
+void TestPeerSync::deltaAfterChanges() {
+    MockServer::Options options;
+    options.peersPerUser = 3;
+    start(options);
+
+    QCOMPARE(sync(), 3);
+    QCOMPARE(m_client->syncedPeers().size(), 3);
+    const QString revision = m_client->peerRevision();
+    QVERIFY(!revision.isEmpty());
+
+    const PeerInfo peer = createPeer(QStringLiteral("laptop"));
+    QVERIFY(!peer.id.isEmpty());
+
+    QSignalSpy added(m_client.get(), &ApiClient::peerAdded);
+    QSignalSpy updated(m_client.get(), &ApiClient::peerUpdated);
+    QCOMPARE(sync(), 1);
+    QCOMPARE(added.size(), 1);
+    QCOMPARE(qvariant_cast<PeerInfo>(added.first().first()).id, peer.id);
+    QCOMPARE(updated.size(), 0);
+    QCOMPARE(m_client->syncedPeers().size(), 4);
+    QVERIFY(m_client->peerRevision() != revision);
+
+    // Ничего не изменилось: пустая дельта
+    QCOMPARE(sync(), 0);
+}
+
+// Дельта из N изменений весит одинаково при 10 и 1000 устройствах; полный
+// список при этом вырастает в сотню раз
+void TestPeerSync::deltaSizeIndependentOfList() {
+    constexpr int CHANGES = 5;
+    const int listSizes[] = {10, 1000};
+    qint64 fullBytes[2] = {};
+    qint64 deltaBytes[2] = {};
+
+    for (int i = 0; i < 2; ++i) {
+        cleanup();
+        MockServer::Options options;
+        options.peersPerUser = listSizes[i];
+        start(options);
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+
+        QCOMPARE(sync(), listSizes[i]);
+        fullBytes[i] = m_server->bytesSent(CHANGES_PATH);
+        for (int change = 0; change < CHANGES; ++change) {
+            QVERIFY(!createPeer(QStringLiteral("device-new-%1").arg(change)).id.isEmpty());
+        }
+
+        const qint64 before = m_server->bytesSent(CHANGES_PATH);
+        QCOMPARE(sync(), CHANGES);
+        deltaBytes[i] = m_server->bytesSent(CHANGES_PATH) - before;
+    }
+
+    QVERIFY(fullBytes[1] > 50 * fullBytes[0]);
+    // Разнятся только число цифр в ревизии, Content-Length и адресах
+    // устройств и is_active: несколько байт на изменение
+    QVERIFY2(qAbs(deltaBytes[1] - deltaBytes[0]) <= 3 * CHANGES + 8,
+             qPrintable(QStringLiteral("%1 vs %2 bytes").arg(deltaBytes[0]).arg(deltaBytes[1])));
+}
+
+// Без /changes список берётся целиком; неизменный список приходит как 304
+void TestPeerSync::snapshotNotModified() {
+    MockServer::Options options;
+    options.peersPerUser = 3;
+    options.changesEndpoint = false;
+    start(options);
+
+    QCOMPARE(sync(), 3);
+    const int hits = m_client->cacheHits();
+
+    QSignalSpy errors(m_client.get(), &ApiClient::apiError);
+    QCOMPARE(sync(), 0);
+    QCOMPARE(m_client->cacheHits(), hits + 1);
+    QCOMPARE(m_client->syncedPeers().size(), 3);
+
+    createPeer(QStringLiteral("phone"));
+    QCOMPARE(sync(), 1);
+    QCOMPARE(m_client->syncedPeers().size(), 4);
+    QCOMPARE(errors.size(), 0);
+}
+
+// Ревизия вытеснена из журнала изменений: 410, затем полная синхронизация
+// внутри той же операции, без apiError
+void TestPeerSync::fullResyncAfterGone() {
+    MockServer::Options options;
+    options.peersPerUser = 3;
+    options.changeLogSize = 2;
+    start(options);
+
+    QCOMPARE(sync(), 3);
+    for (int i = 0; i < 3; ++i) {
+        QVERIFY(!createPeer(QStringLiteral("device-%1").arg(i)).id.isEmpty());
+    }
+
+    QSignalSpy errors(m_client.get(), &ApiClient::apiError);
+    QSignalSpy synced(m_client.get(), &ApiClient::peersSynced);
+    QSignalSpy added(m_client.get(), &ApiClient::peerAdded);
+    const qint64 served = m_server->requestsServed();
+    m_client->syncPeers();
+    QVERIFY(synced.wait(TIMEOUT_MS));
+
+    QCOMPARE(synced.size(), 1);
+    QCOMPARE(synced.first().first().toInt(), 3);
+    QCOMPARE(added.size(), 3);
+    QCOMPARE(errors.size(), 0);
+    QCOMPARE(m_server->requestsServed(), served + 2);   // 410 и полный список
+    QCOMPARE(m_client->syncedPeers().size(), 6);
+    QCOMPARE(m_client->pendingRequests(), 0);
+}
+
+// cancel() с id из syncPeers() останавливает и пересинхронизацию после 410
+void TestPeerSync::cancelDuringResync() {
+    MockServer::Options options;
+    options.peersPerUser = 3;
+    options.changeLogSize = 1;
+    options.latencyMs = 300;
+    start(options);
+
+    QCOMPARE(sync(), 3);
+    createPeer(QStringLiteral("a"));
+    createPeer(QStringLiteral("b"));
+
+    QSignalSpy synced(m_client.get(), &ApiClient::peersSynced);
+    QSignalSpy errors(m_client.get(), &ApiClient::apiError);
+    const qint64 served = m_server->requestsServed();
+    const int syncId = m_client->syncPeers();
+
+    // 410 отправлен; по loopback он доходит за миллисекунды, и полный
+    // запрос успевает уйти задолго до ответа с задержкой сервера
+    QTRY_COMPARE_WITH_TIMEOUT(m_server->requestsServed(), served + 1, TIMEOUT_MS);
+    QTest::qWait(options.latencyMs / 3);
+    QCOMPARE(m_client->pendingRequests(), 1);
+    m_client->cancel(syncId);
+    QCOMPARE(m_client->pendingRequests(), 0);
+
+    QTest::qWait(2 * options.latencyMs);
+    QCOMPARE(synced.size(), 0);
+    QCOMPARE(errors.size(), 0);
+}
+
+QTEST_GUILESS_MAIN(TestPeerSync)
+#include "tst_peersync.moc"
@@ -0,0 +1,112 @@
+// Backoff с full jitter и circuit breaker из Resilience. Без Qt: время
+// передаётся явно, ничего не ждём.
+
+#include "Resilience.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace obsidian;
+using namespace std::chrono_literals;
+
+namespace {
+
+using Clock = CircuitBreaker::Clock;
+
+// Задержка перед попыткой n равномерна в [0, min(max, base * 2^(n - 2)))
+void testBackoffBounds() {
+    const ResiliencePolicy policy{.backoffBaseMs = 250, .backoffMaxMs = 4000};
+    const int ceilings[] = {250, 500, 1000, 2000, 4000, 4000, 4000};
+
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for (int attempt = 2; attempt < 9; ++attempt) {
+        const int ceiling = ceilings[attempt - 2];
+        CHECK(policy.backoffDelayMs(attempt, 0.0) == 0);
+        CHECK(policy.backoffDelayMs(attempt, 0.999999) == ceiling - 1);
+
+        // Выборка покрывает весь интервал, а не прижимается к потолку
+        int low = ceiling;
+        int high = 0;
+        for (int i = 0; i < 2000; ++i) {
+            const int delay = policy.backoffDelayMs(attempt, uniform(rng));
+            CHECK(delay >= 0 && delay < ceiling);
+            low = std::min(low, delay);
+            high = std::max(high, delay);
+        }
+        CHECK(low < ceiling / 10);
+        CHECK(high > ceiling * 9 / 10);
+    }
+
+    // Большие номера попыток не переполняют сдвиг
+    CHECK(policy.backoffDelayMs(1000, 0.5) == 2000);
+    // Первая попытка и мусор на входе дают потолок base
+    CHECK(policy.backoffDelayMs(1, 0.5) == 125);
+    CHECK(policy.backoffDelayMs(2, 7.0) == 250);
+}
+
+// Closed -> Open после порога подряд, Open отказывает до openDuration
+void testBreakerOpens() {
+    CircuitBreaker breaker(3, 10s);
+    const Clock::time_point t0 = Clock::time_point{} + 1h;
+
+    breaker.recordFailure(t0);
+    breaker.recordFailure(t0);
+    breaker.recordSuccess();            // успех обнуляет счётчик
+    breaker.recordFailure(t0);
+    breaker.recordFailure(t0);
+    CHECK(breaker.state() == CircuitBreaker::State::Closed);
+    CHECK(breaker.allowRequest(t0));
+
+    breaker.recordFailure(t0);
+    CHECK(breaker.state() == CircuitBreaker::State::Open);
+    CHECK(!breaker.allowRequest(t0));
+    CHECK(!breaker.allowRequest(t0 + 9999ms));
+
+    // Поздние отказы запросов, ушедших до открытия, срок не продлевают
+    breaker.recordFailure(t0 + 5s);
+    CHECK(breaker.allowRequest(t0 + 10s));
+    CHECK(breaker.state() == CircuitBreaker::State::HalfOpen);
+}
+
+// HalfOpen пропускает одну пробу; её исход закрывает или снова открывает цепь
+void testBreakerHalfOpen() {
+    const Clock::time_point t0 = Clock::time_point{} + 1h;
+
+    CircuitBreaker closing(1, 10s);
+    closing.recordFailure(t0);
+    CHECK(closing.allowRequest(t0 + 10s));
+    CHECK(!closing.allowRequest(t0 + 10s));     // проба ещё в полёте
+    CHECK(!closing.allowRequest(t0 + 15s));
+    closing.recordSuccess();
+    CHECK(closing.state() == CircuitBreaker::State::Closed);
+    CHECK(closing.allowRequest(t0 + 15s));
+    CHECK(closing.allowRequest(t0 + 15s));
+
+    CircuitBreaker reopening(5, 10s);
+    for (int i = 0; i < 5; ++i) {
+        reopening.recordFailure(t0);
+    }
+    CHECK(reopening.allowRequest(t0 + 10s));
+    reopening.recordFailure(t0 + 11s);         // одной неудачной пробы достаточно
+    CHECK(reopening.state() == CircuitBreaker::State::Open);
+    CHECK(!reopening.allowRequest(t0 + 20s));
+    CHECK(reopening.allowRequest(t0 + 21s));
+
+    // Проба, исход которой так и не сообщили, не блокирует навсегда
+    CircuitBreaker lost(1, 10s);
+    lost.recordFailure(t0);
+    CHECK(lost.allowRequest(t0 + 10s));
+    CHECK(!lost.allowRequest(t0 + 19s));
+    CHECK(lost.allowRequest(t0 + 20s));
+}
+
+} // anonymous namespace
+
+int main() {
+    testBackoffBounds();
+    testBreakerOpens();
+    testBreakerHalfOpen();
+    return TEST_RESULT("tst_resilience");
+}
@@ -0,0 +1,196 @@
+// Порядок допуска запросов RequestScheduler: интерактивные идут первыми
+// при забитых слотах, менее срочные классы не голодают. Без Qt.
+
+#include "RequestScheduler.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace obsidian;
+using namespace std::chrono_literals;
+
+namespace {
+
+using Clock = RequestScheduler::Clock;
+
+// Планировщик и журнал запусков; запущенные запросы завершаются по одному
+// в порядке запуска, как ответы с одинаковой задержкой
+struct Harness {
+    struct Started {
+        RequestPriority priority;
+        int id;
+        Clock::duration waited;
+        int active;     // запущено запросов этого класса, включая этот
+    };
+
+    RequestScheduler scheduler;
+    std::map<int, RequestPriority> priorityOf;
+    std::vector<Started> started;
+    std::deque<RequestPriority> running;
+    Clock::time_point now = Clock::time_point{} + 1h;
+
+    Harness(int maxActive, int maxBackground)
+        : scheduler(maxActive, maxBackground)
+    {
+    }
+
+    RequestScheduler::Ticket submit(RequestPriority priority, int id) {
+        priorityOf[id] = priority;
+        return scheduler.submit(priority, [this, id](Clock::duration waited) {
+            const RequestPriority current = priorityOf[id];
+            started.push_back({current, id, waited, scheduler.active(current)});
+            running.push_back(current);
+        }, now);
+    }
+
+    // Класс меняется до promote, как в ApiClient: запрос может стартовать сразу
+    bool promote(RequestScheduler::Ticket ticket, int id, RequestPriority priority) {
+        const RequestPriority previous = std::exchange(priorityOf[id], priority);
+        if (!scheduler.promote(ticket, priority, now)) {
+            priorityOf[id] = previous;
+            return false;
+        }
+        return true;
+    }
+
+    void finishOldest() {
+        const RequestPriority priority = running.front();
+        running.pop_front();
+        scheduler.finished(priority, now);
+    }
+
+    int startedCount(RequestPriority priority) const {
+        return static_cast<int>(std::count_if(started.begin(), started.end(),
+                                              [priority](const Started& s) { return s.priority == priority; }));
+    }
+};
+
+// Слоты заняты normal и background, очереди обоих классов не пусты:
+// интерактивный запрос стартует сразу, продвинутый из очереди тоже
+void testInteractiveFirst() {
+    Harness h(6, 2);
+    std::vector<RequestScheduler::Ticket> backgroundTickets;
+    for (int i = 0; i < 10; ++i) {
+        backgroundTickets.push_back(h.submit(RequestPriority::Background, 100 + i));
+    }
+    for (int i = 0; i < 10; ++i) {
+        h.submit(RequestPriority::Normal, 200 + i);
+    }
+    CHECK(h.scheduler.active(RequestPriority::Background) == 2);
+    CHECK(h.scheduler.active(RequestPriority::Normal) == 4);
+    CHECK(h.scheduler.queued(RequestPriority::Background) == 8);
+    CHECK(h.scheduler.queued(RequestPriority::Normal) == 6);
+
+    h.now += 5ms;
+    CHECK(h.submit(RequestPriority::Interactive, 1) == 0);
+    CHECK(h.started.back().id == 1);
+    CHECK(h.started.back().waited == Clock::duration::zero());
+
+    // Фоновый запрос, который пользователь открыл, обгоняет всю очередь normal
+    const RequestScheduler::Ticket last = backgroundTickets.back();
+    CHECK(last != 0);
+    CHECK(h.promote(last, 109, RequestPriority::Interactive));
+    CHECK(h.started.back().id == 109);
+    CHECK(h.started.back().priority == RequestPriority::Interactive);
+    CHECK(h.started.back().waited == 5ms);
+    CHECK(!h.scheduler.cancel(last));
+
+    // Освободившиеся слоты достаются normal; background получает слот, только
+    // когда у него не осталось ни одного запущенного запроса
+    const size_t before = h.started.size();
+    while (h.scheduler.queued(RequestPriority::Normal) > 0) {
+        h.finishOldest();
+    }
+    CHECK(h.scheduler.queued(RequestPriority::Background) > 0);
+    for (size_t i = before; i < h.started.size(); ++i) {
+        CHECK(h.started[i].priority == RequestPriority::Normal || h.started[i].active == 1);
+    }
+    while (!h.running.empty()) {
+        h.finishOldest();
+    }
+    CHECK(h.startedCount(RequestPriority::Background) == 9);
+    CHECK(h.scheduler.queued(RequestPriority::Background) == 0);
+    CHECK(h.scheduler.active(RequestPriority::Background) == 0);
+}
+
+// Поток normal не иссякает, но фоновые запросы всё равно проходят: у класса
+// без запущенных запросов всегда есть один слот
+void testBackgroundNotStarved() {
+    Harness h(6, 2);
+    int nextId = 0;
+    for (int i = 0; i < 12; ++i) {
+        h.submit(RequestPriority::Normal, nextId++);
+    }
+    for (int i = 0; i < 5; ++i) {
+        h.submit(RequestPriority::Background, 1000 + i);
+    }
+    CHECK(h.scheduler.active(RequestPriority::Background) == 1);
+
+    for (int step = 0; step < 200; ++step) {
+        h.finishOldest();
+        h.submit(RequestPriority::Normal, nextId++);
+        CHECK(h.scheduler.active(RequestPriority::Background) <= 1);
+    }
+    CHECK(h.scheduler.queued(RequestPriority::Normal) > 0);
+    CHECK(h.startedCount(RequestPriority::Background) == 5);
+
+    // Фоновые шли по очереди, в порядке поступления
+    int expected = 1000;
+    for (const Harness::Started& s : h.started) {
+        if (s.priority == RequestPriority::Background) {
+            CHECK(s.id == expected++);
+        }
+    }
+}
+
+// Интерактивные запросы держат все слоты, normal и background продвигаются
+void testNormalNotStarvedByInteractive() {
+    Harness h(6, 2);
+    for (int i = 0; i < 8; ++i) {
+        h.submit(RequestPriority::Interactive, i);
+    }
+    for (int i = 0; i < 3; ++i) {
+        h.submit(RequestPriority::Normal, 100 + i);
+        h.submit(RequestPriority::Background, 200 + i);
+    }
+    CHECK(h.scheduler.active(RequestPriority::Normal) == 1);
+    CHECK(h.scheduler.active(RequestPriority::Background) == 1);
+
+    int nextId = 8;
+    for (int step = 0; step < 50; ++step) {
+        if (h.running.front() == RequestPriority::Interactive) {
+            h.submit(RequestPriority::Interactive, nextId++);
+        }
+        h.finishOldest();
+    }
+    CHECK(h.startedCount(RequestPriority::Normal) == 3);
+    CHECK(h.startedCount(RequestPriority::Background) == 3);
+}
+
+// Отменённый запрос не стартует, остальные сохраняют порядок
+void testCancel() {
+    Harness h(1, 1);
+    h.submit(RequestPriority::Normal, 1);
+    const RequestScheduler::Ticket second = h.submit(RequestPriority::Normal, 2);
+    h.submit(RequestPriority::Normal, 3);
+    CHECK(h.scheduler.cancel(second));
+    CHECK(!h.scheduler.cancel(second));
+    h.finishOldest();
+    h.finishOldest();
+    CHECK(h.started.size() == 2);
+    CHECK(h.started.back().id == 3);
+}
+
+} // anonymous namespace
+
+int main() {
+    testInteractiveFirst();
+    testBackgroundNotStarved();
+    testNormalNotStarvedByInteractive();
+    testCancel();
+    return TEST_RESULT("tst_scheduler");
+}